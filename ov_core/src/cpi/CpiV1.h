@@ -167,8 +167,8 @@ namespace ov_core {
             Eigen::Matrix<double, 3, 3> Beta_arg = (delta_t * eye3 + f_3 * w_x + f_4 * w_x_2);
 
             // Matrices that will multiply the a_hat in the update expressions
-            Eigen::MatrixXd H_al = R_tau12k * alpha_arg;
-            Eigen::MatrixXd H_be = R_tau12k * Beta_arg;
+            Eigen::Matrix<double, 3, 3> H_al = R_tau12k * alpha_arg;
+            Eigen::Matrix<double, 3, 3> H_be = R_tau12k * Beta_arg;
 
             // Update the measurement means
             alpha_tau += beta_tau * delta_t + H_al * a_hat;
@@ -193,9 +193,9 @@ namespace ov_core {
             H_b -= H_be;
 
             // Derivatives of R_tau12k wrt bias_w entries
-            Eigen::MatrixXd d_R_bw_1 = -R_tau12k * skew_x(J_q * e_1);
-            Eigen::MatrixXd d_R_bw_2 = -R_tau12k * skew_x(J_q * e_2);
-            Eigen::MatrixXd d_R_bw_3 = -R_tau12k * skew_x(J_q * e_3);
+            Eigen::Matrix<double, 3, 3> d_R_bw_1 = -R_tau12k * skew_x(J_q * e_1);
+            Eigen::Matrix<double, 3, 3> d_R_bw_2 = -R_tau12k * skew_x(J_q * e_2);
+            Eigen::Matrix<double, 3, 3> d_R_bw_3 = -R_tau12k * skew_x(J_q * e_3);
 
             // Now compute the gyro bias Jacobian terms
             double df_1_dbw_1;
@@ -290,80 +290,12 @@ namespace ov_core {
 
 
             //Compute covariance (in this implementation, we use RK4)
-            //k1-------------------------------------------------------------------------------------------------
-
-            // Build state Jacobian
-            Eigen::Matrix<double, 15, 15> F_k1 = Eigen::Matrix<double, 15, 15>::Zero();
-            F_k1.block(0, 0, 3, 3) = -w_x;
-            F_k1.block(0, 3, 3, 3) = -eye3;
-            F_k1.block(6, 0, 3, 3) = -R_k2tau.transpose() * a_x;
-            F_k1.block(6, 9, 3, 3) = -R_k2tau.transpose();
-            F_k1.block(12, 6, 3, 3) = eye3;
-
-            // Build noise Jacobian
-            Eigen::Matrix<double, 15, 12> G_k1 = Eigen::Matrix<double, 15, 12>::Zero();
-            G_k1.block(0, 0, 3, 3) = -eye3;
-            G_k1.block(3, 3, 3, 3) = eye3;
-            G_k1.block(6, 6, 3, 3) = -R_k2tau.transpose();
-            G_k1.block(9, 9, 3, 3) = eye3;
-
-            // Get covariance derivative
-            Eigen::Matrix<double, 15, 15> P_dot_k1 = F_k1 * P_meas + P_meas * F_k1.transpose() + G_k1 * Q_c * G_k1.transpose();
-
-
-            //k2-------------------------------------------------------------------------------------------------
-
-            // Build state Jacobian
-            Eigen::Matrix<double, 15, 15> F_k2 = Eigen::Matrix<double, 15, 15>::Zero();
-            F_k2.block(0, 0, 3, 3) = -w_x;
-            F_k2.block(0, 3, 3, 3) = -eye3;
-            F_k2.block(6, 0, 3, 3) = -R_mid.transpose() * a_x;
-            F_k2.block(6, 9, 3, 3) = -R_mid.transpose();
-            F_k2.block(12, 6, 3, 3) = eye3;
-
-            // Build noise Jacobian
-            Eigen::Matrix<double, 15, 12> G_k2 = Eigen::Matrix<double, 15, 12>::Zero();
-            G_k2.block(0, 0, 3, 3) = -eye3;
-            G_k2.block(3, 3, 3, 3) = eye3;
-            G_k2.block(6, 6, 3, 3) = -R_mid.transpose();
-            G_k2.block(9, 9, 3, 3) = eye3;
-
-            // Get covariance derivative
-            Eigen::Matrix<double, 15, 15> P_k2 = P_meas + P_dot_k1 * delta_t / 2.0;
-            Eigen::Matrix<double, 15, 15> P_dot_k2 = F_k2 * P_k2 + P_k2 * F_k2.transpose() + G_k2 * Q_c * G_k2.transpose();
-
-            //k3-------------------------------------------------------------------------------------------------
-
-            // Our state and noise Jacobians are the same as k2
-            // Since k2 and k3 correspond to the same estimates for the midpoint
-            Eigen::Matrix<double, 15, 15> F_k3 = F_k2;
-            Eigen::Matrix<double, 15, 12> G_k3 = G_k2;
-
-            // Get covariance derivative
-            Eigen::Matrix<double, 15, 15> P_k3 = P_meas + P_dot_k2 * delta_t / 2.0;
-            Eigen::Matrix<double, 15, 15> P_dot_k3 = F_k3 * P_k3 + P_k3 * F_k3.transpose() + G_k3 * Q_c * G_k3.transpose();
-
-            //k4-------------------------------------------------------------------------------------------------
-
-            // Build state Jacobian
-            Eigen::Matrix<double, 15, 15> F_k4 = Eigen::Matrix<double, 15, 15>::Zero();
-            F_k4.block(0, 0, 3, 3) = -w_x;
-            F_k4.block(0, 3, 3, 3) = -eye3;
-            F_k4.block(6, 0, 3, 3) = -R_k2tau1.transpose() * a_x;
-            F_k4.block(6, 9, 3, 3) = -R_k2tau1.transpose();
-            F_k4.block(12, 6, 3, 3) = eye3;
-
-            // Build noise Jacobian
-            Eigen::Matrix<double, 15, 12> G_k4 = Eigen::Matrix<double, 15, 12>::Zero();
-            G_k4.block(0, 0, 3, 3) = -eye3;
-            G_k4.block(3, 3, 3, 3) = eye3;
-            G_k4.block(6, 6, 3, 3) = -R_k2tau1.transpose();
-            G_k4.block(9, 9, 3, 3) = eye3;
-
-            // Get covariance derivative
-            Eigen::Matrix<double, 15, 15> P_k4 = P_meas + P_dot_k3 * delta_t;
-            Eigen::Matrix<double, 15, 15> P_dot_k4 = F_k4 * P_k4 + P_k4 * F_k4.transpose() + G_k4 * Q_c * G_k4.transpose();
-
+            //Note that k2 and k3 correspond to the same estimates for the midpoint
+            Eigen::Matrix<double, 15, 15> P_dot_k1, P_dot_k2, P_dot_k3, P_dot_k4;
+            compute_P_dot(P_meas, w_x, a_x, R_k2tau, P_dot_k1);
+            compute_P_dot(P_meas + P_dot_k1 * delta_t / 2.0, w_x, a_x, R_mid, P_dot_k2);
+            compute_P_dot(P_meas + P_dot_k2 * delta_t / 2.0, w_x, a_x, R_mid, P_dot_k3);
+            compute_P_dot(P_meas + P_dot_k3 * delta_t, w_x, a_x, R_k2tau1, P_dot_k4);
 
             //done-------------------------------------------------------------------------------------------------
 
@@ -381,6 +313,54 @@ namespace ov_core {
         }
 
 
+    private:
+
+
+        /**
+         * @brief Computes the derivative of the measurement covariance at a given orientation
+         *
+         * This is P_dot = F*P + P*F^T + G*Q_c*G^T, but our state Jacobian only has five non-zero 3x3 blocks and our noise Jacobian is block diagonal.
+         * Thus we only compute the three non-zero block rows of F*P and the noise blocks, instead of full 15x15 products.
+         * The state is ordered (theta, b_w, beta, b_a, alpha).
+         *
+         * @param[in] P Measurement covariance we evaluate the derivative at
+         * @param[in] w_x Skew of the bias corrected angular velocity
+         * @param[in] a_x Skew of the bias corrected linear acceleration
+         * @param[in] R_k2t Orientation at the time we evaluate the derivative at
+         * @param[out] P_dot Derivative of the measurement covariance
+         */
+        void compute_P_dot(const Eigen::Matrix<double, 15, 15> &P, const Eigen::Matrix<double, 3, 3> &w_x,
+                           const Eigen::Matrix<double, 3, 3> &a_x, const Eigen::Matrix<double, 3, 3> &R_k2t,
+                           Eigen::Matrix<double, 15, 15> &P_dot) {
+
+            // Noise Jacobian diagonal blocks (-I, I, -R^T, I)
+            Eigen::Matrix<double, 3, 3> G_blocks[4] = {-eye3, eye3, -R_k2t.transpose(), eye3};
+
+            // Noise G*Q_c*G^T (only the top left 12x12 is non-zero)
+            P_dot.setZero();
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    P_dot.block<3, 3>(3 * i, 3 * j).noalias() = G_blocks[i] * Q_c.block<3, 3>(3 * i, 3 * j) * G_blocks[j].transpose();
+                }
+            }
+
+            // Non-zero block rows of F*P
+            Eigen::Matrix<double, 9, 15> FP;
+            FP.block<3, 15>(0, 0).noalias() = -w_x * P.block<3, 15>(0, 0) - P.block<3, 15>(3, 0);
+            FP.block<3, 15>(3, 0).noalias() = -R_k2t.transpose() * (a_x * P.block<3, 15>(0, 0) + P.block<3, 15>(9, 0));
+            FP.block<3, 15>(6, 0) = P.block<3, 15>(6, 0);
+
+            // Add F*P and its transpose P*F^T
+            P_dot.block<3, 15>(0, 0) += FP.block<3, 15>(0, 0);
+            P_dot.block<3, 15>(6, 0) += FP.block<3, 15>(3, 0);
+            P_dot.block<3, 15>(12, 0) += FP.block<3, 15>(6, 0);
+            P_dot.block<15, 3>(0, 0) += FP.block<3, 15>(0, 0).transpose();
+            P_dot.block<15, 3>(0, 6) += FP.block<3, 15>(3, 0).transpose();
+            P_dot.block<15, 3>(0, 12) += FP.block<3, 15>(6, 0).transpose();
+
+        }
+
+
     };
 
 }
@@ -26,7 +26,7 @@ using namespace ov_core;
 
 
 
-void Feature::clean_old_measurements(std::vector<double> valid_times) {
+void Feature::clean_old_measurements(const std::vector<double> &valid_times) {
 
 
     // Loop through each of the cameras we have
@@ -76,7 +76,7 @@ namespace ov_core {
          *
          * @param valid_times Vector of timestamps that our measurements must occur at
          */
-        void clean_old_measurements(std::vector<double> valid_times);
+        void clean_old_measurements(const std::vector<double> &valid_times);
 
         /**
          * @brief Remove measurements that are older then the specified timestamp.
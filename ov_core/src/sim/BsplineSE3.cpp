@@ -41,10 +41,17 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
 
     // convert all our trajectory points into SE(3) matrices
     // we are given [timestamp, p_IinG, q_GtoI]
+    // we convert all the orientations at once since there can be many thousands of them
+    QuatBatch q_GtoI(4,traj_points.size()-1);
+    for(size_t i=0; i<traj_points.size()-1; i++) {
+        q_GtoI.col(i) = traj_points.at(i).block(4,0,4,1);
+    }
+    Mat3Batch R_GtoI;
+    quat_2_Rot_batch(q_GtoI, R_GtoI);
     std::map<double,Eigen::MatrixXd> trajectory_points;
     for(size_t i=0; i<traj_points.size()-1; i++) {
         Eigen::Matrix4d T_IinG = Eigen::Matrix4d::Identity();
-        T_IinG.block(0,0,3,3) = quat_2_Rot(traj_points.at(i).block(4,0,4,1)).transpose();
+        T_IinG.block(0,0,3,3) = mat3_from_batch(R_GtoI,(int)i).transpose();
         T_IinG.block(0,3,3,1) = traj_points.at(i).block(1,0,3,1);
         trajectory_points.insert({traj_points.at(i)(0),T_IinG});
     }
@@ -65,6 +72,9 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
 
 
     // then create spline control points
+    control_points.clear();
+    control_omegas.clear();
+    control_start = timestamp_min;
     double timestamp_curr = timestamp_min;
     while(true) {
 
@@ -82,12 +92,17 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
         // Linear interpolation and append to our control points
         double lambda = (timestamp_curr-t0)/(t1-t0);
         Eigen::Matrix4d pose_interp = exp_se3(lambda*log_se3(pose1*Inv_se3(pose0)))*pose0;
-        control_points.insert({timestamp_curr, pose_interp});
-        timestamp_curr += dt;
+        control_points.push_back(pose_interp);
+        timestamp_curr = control_start+control_points.size()*dt;
         //std::cout << pose_interp(0,3) << "," << pose_interp(1,3) << "," << pose_interp(2,3) << std::endl;
 
     }
 
+    // Cache the relative twist between each control point and the next
+    for(size_t i=0; i+1<control_points.size(); i++) {
+        control_omegas.push_back(log_se3(Inv_se3(control_points.at(i))*control_points.at(i+1)));
+    }
+
     // The start time of the system is two dt in since we need at least two older control points
     timestamp_start = timestamp_min + 2*dt;
     printf("[B-SPLINE]: start trajectory time of %.6f\n",timestamp_start);
@@ -101,10 +116,9 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
 bool BsplineSE3::get_pose(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG) {
 
     // Get the bounding poses for the desired timestamp
-    double t0, t1, t2, t3;
-    Eigen::Matrix4d pose0, pose1, pose2, pose3;
-    bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-    //printf("[SIM]: time curr = %.6f | dt1 = %.3f | dt2 = %.3f | dt3 = %.3f | dt4 = %.3f | success = %d\n",timestamp,t0-timestamp,t1-timestamp,t2-timestamp,t3-timestamp,(int)success);
+    size_t idx;
+    double u;
+    bool success = find_bounding_control_points(timestamp, idx, u);
 
     // Return failure if we can't get bounding poses
     if(!success) {
@@ -113,22 +127,9 @@ bool BsplineSE3::get_pose(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vect
         return false;
     }
 
-    // Our De Boor-Cox matrix scalars
-    double DT = (t2-t1);
-    double u = (timestamp-t1)/DT;
-    double b0 = 1.0/6.0*(5+3*u-3*u*u+u*u*u);
-    double b1 = 1.0/6.0*(1+3*u+3*u*u-2*u*u*u);
-    double b2 = 1.0/6.0*(u*u*u);
-
-    // Calculate interpolated poses
-    Eigen::Matrix4d A0 = exp_se3(b0*log_se3(Inv_se3(pose0)*pose1));
-    Eigen::Matrix4d A1 = exp_se3(b1*log_se3(Inv_se3(pose1)*pose2));
-    Eigen::Matrix4d A2 = exp_se3(b2*log_se3(Inv_se3(pose2)*pose3));
-
-    // Finally get the interpolated pose
-    Eigen::Matrix4d pose_interp = pose0*A0*A1*A2;
-    R_GtoI = pose_interp.block(0,0,3,3).transpose();
-    p_IinG = pose_interp.block(0,3,3,1);
+    // Evaluate the pose only
+    Eigen::Vector3d w_IinI, v_IinG, alpha_IinI, a_IinG;
+    evaluate(idx, u, 0, R_GtoI, p_IinG, w_IinI, v_IinG, alpha_IinI, a_IinG);
     return true;
 
 }
@@ -139,10 +140,9 @@ bool BsplineSE3::get_pose(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vect
 bool BsplineSE3::get_velocity(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI, Eigen::Vector3d &v_IinG) {
 
     // Get the bounding poses for the desired timestamp
-    double t0, t1, t2, t3;
-    Eigen::Matrix4d pose0, pose1, pose2, pose3;
-    bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-    //printf("[SIM]: time curr = %.6f | dt1 = %.3f | dt2 = %.3f | dt3 = %.3f | dt4 = %.3f | success = %d\n",timestamp,t0-timestamp,t1-timestamp,t2-timestamp,t3-timestamp,(int)success);
+    size_t idx;
+    double u;
+    bool success = find_bounding_control_points(timestamp, idx, u);
 
     // Return failure if we can't get bounding poses
     if(!success) {
@@ -151,39 +151,9 @@ bool BsplineSE3::get_velocity(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::
         return false;
     }
 
-    // Our De Boor-Cox matrix scalars
-    double DT = (t2-t1);
-    double u = (timestamp-t1)/DT;
-    double b0 = 1.0/6.0*(5+3*u-3*u*u+u*u*u);
-    double b1 = 1.0/6.0*(1+3*u+3*u*u-2*u*u*u);
-    double b2 = 1.0/6.0*(u*u*u);
-    double b0dot = 1.0/(6.0*DT)*(3-6*u+3*u*u);
-    double b1dot = 1.0/(6.0*DT)*(3+6*u-6*u*u);
-    double b2dot = 1.0/(6.0*DT)*(3*u*u);
-
-    // Cache some values we use alot
-    Eigen::Matrix<double,6,1> omega_10 = log_se3(Inv_se3(pose0)*pose1);
-    Eigen::Matrix<double,6,1> omega_21 = log_se3(Inv_se3(pose1)*pose2);
-    Eigen::Matrix<double,6,1> omega_32 = log_se3(Inv_se3(pose2)*pose3);
-
-    // Calculate interpolated poses
-    Eigen::Matrix4d A0 = exp_se3(b0*omega_10);
-    Eigen::Matrix4d A1 = exp_se3(b1*omega_21);
-    Eigen::Matrix4d A2 = exp_se3(b2*omega_32);
-    Eigen::Matrix4d A0dot = b0dot*hat_se3(omega_10)*A0;
-    Eigen::Matrix4d A1dot = b1dot*hat_se3(omega_21)*A1;
-    Eigen::Matrix4d A2dot = b2dot*hat_se3(omega_32)*A2;
-
-    // Get the interpolated pose
-    Eigen::Matrix4d pose_interp = pose0*A0*A1*A2;
-    R_GtoI = pose_interp.block(0,0,3,3).transpose();
-    p_IinG = pose_interp.block(0,3,3,1);
-
-    // Finally get the interpolated velocities
-    // NOTE: Rdot = R*skew(omega) => R^T*Rdot = skew(omega)
-    Eigen::Matrix4d vel_interp = pose0*(A0dot*A1*A2+A0*A1dot*A2+A0*A1*A2dot);
-    w_IinI = vee(pose_interp.block(0,0,3,3).transpose()*vel_interp.block(0,0,3,3));
-    v_IinG = vel_interp.block(0,3,3,1);
+    // Evaluate the pose and velocity
+    Eigen::Vector3d alpha_IinI, a_IinG;
+    evaluate(idx, u, 1, R_GtoI, p_IinG, w_IinI, v_IinG, alpha_IinI, a_IinG);
     return true;
 
 }
@@ -196,9 +166,9 @@ bool BsplineSE3::get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eig
                                     Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG) {
 
     // Get the bounding poses for the desired timestamp
-    double t0, t1, t2, t3;
-    Eigen::Matrix4d pose0, pose1, pose2, pose3;
-    bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
+    size_t idx;
+    double u;
+    bool success = find_bounding_control_points(timestamp, idx, u);
 
     // Return failure if we can't get bounding poses
     if(!success) {
@@ -207,55 +177,215 @@ bool BsplineSE3::get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eig
         return false;
     }
 
+    // Evaluate everything
+    evaluate(idx, u, 2, R_GtoI, p_IinG, w_IinI, v_IinG, alpha_IinI, a_IinG);
+    return true;
+
+}
+
+
+
+
+void BsplineSE3::get_pose_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI,
+                                std::vector<Eigen::Vector3d> &p_IinG, std::vector<bool> &valid) {
+
+    // Allocate our outputs once
+    R_GtoI.assign(timestamps.size(), Eigen::Matrix3d::Identity());
+    p_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    valid.assign(timestamps.size(), false);
+
+    // Get the exponentials of all segments at once, and then evaluate each timestamp
+    std::vector<size_t> idx;
+    std::vector<double> u;
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> A;
+    get_segment_exponentials(timestamps, idx, u, A, valid);
+    Eigen::Vector3d w_IinI, v_IinG, alpha_IinI, a_IinG;
+    for(size_t i=0; i<timestamps.size(); i++) {
+        if(!valid.at(i))
+            continue;
+        evaluate(idx.at(i), u.at(i), 0, A.at(3*i), A.at(3*i+1), A.at(3*i+2), R_GtoI.at(i), p_IinG.at(i), w_IinI, v_IinG, alpha_IinI, a_IinG);
+    }
+
+}
+
+
+
+
+void BsplineSE3::get_velocity_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI, std::vector<Eigen::Vector3d> &p_IinG,
+                                    std::vector<Eigen::Vector3d> &w_IinI, std::vector<Eigen::Vector3d> &v_IinG, std::vector<bool> &valid) {
+
+    // Allocate our outputs once
+    R_GtoI.assign(timestamps.size(), Eigen::Matrix3d::Identity());
+    p_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    w_IinI.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    v_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    valid.assign(timestamps.size(), false);
+
+    // Get the exponentials of all segments at once, and then evaluate each timestamp
+    std::vector<size_t> idx;
+    std::vector<double> u;
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> A;
+    get_segment_exponentials(timestamps, idx, u, A, valid);
+    Eigen::Vector3d alpha_IinI, a_IinG;
+    for(size_t i=0; i<timestamps.size(); i++) {
+        if(!valid.at(i))
+            continue;
+        evaluate(idx.at(i), u.at(i), 1, A.at(3*i), A.at(3*i+1), A.at(3*i+2), R_GtoI.at(i), p_IinG.at(i), w_IinI.at(i), v_IinG.at(i), alpha_IinI, a_IinG);
+    }
+
+}
+
+
+
+
+void BsplineSE3::get_acceleration_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI, std::vector<Eigen::Vector3d> &p_IinG,
+                                        std::vector<Eigen::Vector3d> &w_IinI, std::vector<Eigen::Vector3d> &v_IinG,
+                                        std::vector<Eigen::Vector3d> &alpha_IinI, std::vector<Eigen::Vector3d> &a_IinG, std::vector<bool> &valid) {
+
+    // Allocate our outputs once
+    R_GtoI.assign(timestamps.size(), Eigen::Matrix3d::Identity());
+    p_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    w_IinI.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    v_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    alpha_IinI.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    a_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+    valid.assign(timestamps.size(), false);
+
+    // Get the exponentials of all segments at once, and then evaluate each timestamp
+    std::vector<size_t> idx;
+    std::vector<double> u;
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> A;
+    get_segment_exponentials(timestamps, idx, u, A, valid);
+    for(size_t i=0; i<timestamps.size(); i++) {
+        if(!valid.at(i))
+            continue;
+        evaluate(idx.at(i), u.at(i), 2, A.at(3*i), A.at(3*i+1), A.at(3*i+2), R_GtoI.at(i), p_IinG.at(i), w_IinI.at(i), v_IinG.at(i), alpha_IinI.at(i), a_IinG.at(i));
+    }
+
+}
+
+
+
+
+void BsplineSE3::get_segment_exponentials(const std::vector<double> &timestamps, std::vector<size_t> &idx, std::vector<double> &u,
+                                          std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> &A, std::vector<bool> &valid) {
+
+    // Find the segment of each timestamp
+    idx.assign(timestamps.size(), 0);
+    u.assign(timestamps.size(), 0.0);
+    A.assign(3*timestamps.size(), Eigen::Matrix4d::Identity());
+    valid.assign(timestamps.size(), false);
+    for(size_t i=0; i<timestamps.size(); i++) {
+        valid.at(i) = find_bounding_control_points(timestamps.at(i), idx.at(i), u.at(i));
+    }
+
+    // Stack the scaled twists b0*omega_10, b1*omega_21, b2*omega_32 of each timestamp
+    Vec3Batch w(3, 3*timestamps.size()), v(3, 3*timestamps.size());
+    for(size_t i=0; i<timestamps.size(); i++) {
+        if(!valid.at(i)) {
+            w.block(0,3*i,3,3).setZero();
+            v.block(0,3*i,3,3).setZero();
+            continue;
+        }
+        double ui = u.at(i);
+        double b[3] = {1.0/6.0*(5+3*ui-3*ui*ui+ui*ui*ui), 1.0/6.0*(1+3*ui+3*ui*ui-2*ui*ui*ui), 1.0/6.0*(ui*ui*ui)};
+        for(size_t k=0; k<3; k++) {
+            const Eigen::Matrix<double,6,1> &omega = control_omegas.at(idx.at(i)+k);
+            w.col(3*i+k) = b[k]*omega.head(3);
+            v.col(3*i+k) = b[k]*omega.tail(3);
+        }
+    }
+
+    // The SE(3) exponential is [exp(w), Jl(w)*v], so we get the rotation and its left Jacobian of all twists at once
+    Mat3Batch R, Jl;
+    exp_so3_batch(w, R);
+    Jl_so3_batch(w, Jl);
+    for(size_t i=0; i<timestamps.size(); i++) {
+        if(!valid.at(i))
+            continue;
+        for(size_t k=0; k<3; k++) {
+            A.at(3*i+k).block(0,0,3,3) = mat3_from_batch(R,(int)(3*i+k));
+            A.at(3*i+k).block(0,3,3,1) = mat3_from_batch(Jl,(int)(3*i+k))*v.col(3*i+k);
+        }
+    }
+
+}
+
+
+
+
+void BsplineSE3::evaluate(size_t idx, double u, int order, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG,
+                          Eigen::Vector3d &w_IinI, Eigen::Vector3d &v_IinG, Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG) {
+
     // Our De Boor-Cox matrix scalars
-    double DT = (t2-t1);
-    double u = (timestamp-t1)/DT;
     double b0 = 1.0/6.0*(5+3*u-3*u*u+u*u*u);
     double b1 = 1.0/6.0*(1+3*u+3*u*u-2*u*u*u);
     double b2 = 1.0/6.0*(u*u*u);
-    double b0dot = 1.0/(6.0*DT)*(3-6*u+3*u*u);
-    double b1dot = 1.0/(6.0*DT)*(3+6*u-6*u*u);
-    double b2dot = 1.0/(6.0*DT)*(3*u*u);
-    double b0dotdot = 1.0/(6.0*DT*DT)*(-6+6*u);
-    double b1dotdot = 1.0/(6.0*DT*DT)*(6-12*u);
-    double b2dotdot = 1.0/(6.0*DT*DT)*(6*u);
-
-    // Cache some values we use alot
-    Eigen::Matrix<double,6,1> omega_10 = log_se3(Inv_se3(pose0)*pose1);
-    Eigen::Matrix<double,6,1> omega_21 = log_se3(Inv_se3(pose1)*pose2);
-    Eigen::Matrix<double,6,1> omega_32 = log_se3(Inv_se3(pose2)*pose3);
 
     // Calculate interpolated poses
-    Eigen::Matrix4d A0 = exp_se3(b0*omega_10);
-    Eigen::Matrix4d A1 = exp_se3(b1*omega_21);
-    Eigen::Matrix4d A2 = exp_se3(b2*omega_32);
-    Eigen::Matrix4d A0dot = b0dot*hat_se3(omega_10)*A0;
-    Eigen::Matrix4d A1dot = b1dot*hat_se3(omega_21)*A1;
-    Eigen::Matrix4d A2dot = b2dot*hat_se3(omega_32)*A2;
-    Eigen::Matrix4d A0dotdot = b0dot*hat_se3(omega_10)*A0dot+b0dotdot*hat_se3(omega_10)*A0;
-    Eigen::Matrix4d A1dotdot = b1dot*hat_se3(omega_21)*A1dot+b1dotdot*hat_se3(omega_21)*A1;
-    Eigen::Matrix4d A2dotdot = b2dot*hat_se3(omega_32)*A2dot+b2dotdot*hat_se3(omega_32)*A2;
+    Eigen::Matrix4d A0 = exp_se3(b0*control_omegas.at(idx));
+    Eigen::Matrix4d A1 = exp_se3(b1*control_omegas.at(idx+1));
+    Eigen::Matrix4d A2 = exp_se3(b2*control_omegas.at(idx+2));
+    evaluate(idx, u, order, A0, A1, A2, R_GtoI, p_IinG, w_IinI, v_IinG, alpha_IinI, a_IinG);
+
+}
+
+
+
+
+void BsplineSE3::evaluate(size_t idx, double u, int order, const Eigen::Matrix4d &A0, const Eigen::Matrix4d &A1, const Eigen::Matrix4d &A2,
+                          Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI, Eigen::Vector3d &v_IinG,
+                          Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG) {
+
+    // Our control points and the cached twists between them
+    const Eigen::Matrix4d &pose0 = control_points.at(idx);
+    const Eigen::Matrix<double,6,1> &omega_10 = control_omegas.at(idx);
+    const Eigen::Matrix<double,6,1> &omega_21 = control_omegas.at(idx+1);
+    const Eigen::Matrix<double,6,1> &omega_32 = control_omegas.at(idx+2);
+    double DT = dt;
 
     // Get the interpolated pose
     Eigen::Matrix4d pose_interp = pose0*A0*A1*A2;
     R_GtoI = pose_interp.block(0,0,3,3).transpose();
     p_IinG = pose_interp.block(0,3,3,1);
+    if(order < 1)
+        return;
+
+    // Velocity scalars and derivatives
+    double b0dot = 1.0/(6.0*DT)*(3-6*u+3*u*u);
+    double b1dot = 1.0/(6.0*DT)*(3+6*u-6*u*u);
+    double b2dot = 1.0/(6.0*DT)*(3*u*u);
+    Eigen::Matrix4d hat_10 = hat_se3(omega_10);
+    Eigen::Matrix4d hat_21 = hat_se3(omega_21);
+    Eigen::Matrix4d hat_32 = hat_se3(omega_32);
+    Eigen::Matrix4d A0dot = b0dot*hat_10*A0;
+    Eigen::Matrix4d A1dot = b1dot*hat_21*A1;
+    Eigen::Matrix4d A2dot = b2dot*hat_32*A2;
 
     // Get the interpolated velocities
     // NOTE: Rdot = R*skew(omega) => R^T*Rdot = skew(omega)
     Eigen::Matrix4d vel_interp = pose0*(A0dot*A1*A2+A0*A1dot*A2+A0*A1*A2dot);
-    w_IinI = vee(pose_interp.block(0,0,3,3).transpose()*vel_interp.block(0,0,3,3));
+    Eigen::Matrix3d omegaskew = pose_interp.block(0,0,3,3).transpose()*vel_interp.block(0,0,3,3);
+    w_IinI = vee(omegaskew);
     v_IinG = vel_interp.block(0,3,3,1);
+    if(order < 2)
+        return;
+
+    // Acceleration scalars and derivatives
+    double b0dotdot = 1.0/(6.0*DT*DT)*(-6+6*u);
+    double b1dotdot = 1.0/(6.0*DT*DT)*(6-12*u);
+    double b2dotdot = 1.0/(6.0*DT*DT)*(6*u);
+    Eigen::Matrix4d A0dotdot = b0dot*hat_10*A0dot+b0dotdot*hat_10*A0;
+    Eigen::Matrix4d A1dotdot = b1dot*hat_21*A1dot+b1dotdot*hat_21*A1;
+    Eigen::Matrix4d A2dotdot = b2dot*hat_32*A2dot+b2dotdot*hat_32*A2;
 
     // Finally get the interpolated velocities
     // NOTE: Rdot = R*skew(omega)
     // NOTE: Rdotdot = Rdot*skew(omega) + R*skew(alpha) => R^T*(Rdotdot-Rdot*skew(omega))=skew(alpha)
     Eigen::Matrix4d acc_interp = pose0*(A0dotdot*A1*A2+A0*A1dotdot*A2+A0*A1*A2dotdot
                                         +2*A0dot*A1dot*A2+2*A0*A1dot*A2dot+2*A0dot*A1*A2dot);
-    Eigen::Matrix3d omegaskew = pose_interp.block(0,0,3,3).transpose()*vel_interp.block(0,0,3,3);
     alpha_IinI = vee(pose_interp.block(0,0,3,3).transpose()*(acc_interp.block(0,0,3,3)-vel_interp.block(0,0,3,3)*omegaskew));
     a_IinG = acc_interp.block(0,3,3,1);
-    return true;
 
 }
 
@@ -315,64 +445,31 @@ bool BsplineSE3::find_bounding_poses(double timestamp, std::map<double,Eigen::Ma
 
 
 
-bool BsplineSE3::find_bounding_control_points(double timestamp, std::map<double,Eigen::MatrixXd> &poses,
-                                              double &t0, Eigen::Matrix4d &pose0, double &t1, Eigen::Matrix4d &pose1,
-                                              double &t2, Eigen::Matrix4d &pose2, double &t3, Eigen::Matrix4d &pose3) {
+bool BsplineSE3::find_bounding_control_points(double timestamp, size_t &idx, double &u) {
 
     // Set the default values
-    t0 = -1;
-    t1 = -1;
-    t2 = -1;
-    t3 = -1;
-    pose0 = Eigen::Matrix4d::Identity();
-    pose1 = Eigen::Matrix4d::Identity();
-    pose2 = Eigen::Matrix4d::Identity();
-    pose3 = Eigen::Matrix4d::Identity();
-
-    // Get the two bounding poses
-    bool success = find_bounding_poses(timestamp, poses, t1, pose1, t2, pose2);
-
-    // Return false if this was a failure
-    if (!success)
-        return false;
+    idx = 0;
+    u = 0;
 
-    // Now find the poses that are below and above
-    auto iter_t1 = poses.find(t1);
-    auto iter_t2 = poses.find(t2);
-
-    // Check that t1 is not the first timestamp
-    if(iter_t1 == poses.begin()) {
+    // Return if we do not have enough control points, or are before the first one
+    if(control_points.size() < 4 || !(timestamp >= control_start))
         return false;
-    }
 
-    // Move the older pose backwards in time
-    // Move the newer one forwards in time
-    auto iter_t0 = --iter_t1;
-    auto iter_t3 = ++iter_t2;
+    // Directly compute the segment we are in, since our control points are uniformly spaced
+    // We want t1 <= timestamp < t2, so correct for any floating point error in the division
+    size_t idx1 = (size_t)std::floor((timestamp-control_start)/dt);
+    if(idx1 > 0 && timestamp < control_start+idx1*dt)
+        idx1--;
+    else if(timestamp >= control_start+(idx1+1)*dt)
+        idx1++;
 
-    // Check that it is valid
-    if (iter_t3 == poses.end()) {
+    // Need one older control point, and two newer
+    if(idx1 < 1 || idx1+2 >= control_points.size())
         return false;
-    }
-
-    // Set the oldest one
-    t0 = iter_t0->first;
-    pose0 = iter_t0->second;
 
-    // Set the newest one
-    t3 = iter_t3->first;
-    pose3 = iter_t3->second;
-
-    // Assert the timestamps
-    if (success) {
-        assert(t0 < t1);
-        assert(t1 < t2);
-        assert(t2 < t3);
-    }
+    // Success, set our segment
+    idx = idx1-1;
+    u = (timestamp-(control_start+idx1*dt))/dt;
+    return true;
 
-    // Return true if we found all four bounding poses
-    return success;
- 
 }
-
-
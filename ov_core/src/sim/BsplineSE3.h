@@ -22,7 +22,10 @@
 #define OV_CORE_BSPLINESE3_H
 
 
+#include <map>
+#include <vector>
 #include <Eigen/Eigen>
+#include <Eigen/StdVector>
 
 #include "utils/quat_ops.h"
 
@@ -158,6 +161,58 @@ namespace ov_core {
                                 Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG);
 
 
+        /**
+         * @brief Gets the orientation and position at many timestamps
+         *
+         * This is the same as calling get_pose() for each timestamp.
+         * Outputs are resized to the number of timestamps, and invalid entries (outside of the spline) are set to identity/zero.
+         *
+         * @param timestamps Desired times to get the pose at
+         * @param R_GtoI SO(3) orientation of the poses in the global frame
+         * @param p_IinG Position of the poses in the global
+         * @param valid If we were able to get each pose
+         */
+        void get_pose_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI,
+                            std::vector<Eigen::Vector3d> &p_IinG, std::vector<bool> &valid);
+
+
+        /**
+         * @brief Gets the pose and velocities at many timestamps
+         *
+         * This is the same as calling get_velocity() for each timestamp.
+         * Outputs are resized to the number of timestamps, and invalid entries (outside of the spline) are set to identity/zero.
+         *
+         * @param timestamps Desired times to get the velocity at
+         * @param R_GtoI SO(3) orientation of the poses in the global frame
+         * @param p_IinG Position of the poses in the global
+         * @param w_IinI Angular velocities in the inertial frame
+         * @param v_IinG Linear velocities in the global frame
+         * @param valid If we were able to get each velocity
+         */
+        void get_velocity_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI, std::vector<Eigen::Vector3d> &p_IinG,
+                                std::vector<Eigen::Vector3d> &w_IinI, std::vector<Eigen::Vector3d> &v_IinG, std::vector<bool> &valid);
+
+
+        /**
+         * @brief Gets the pose, velocities, and accelerations at many timestamps
+         *
+         * This is the same as calling get_acceleration() for each timestamp.
+         * Outputs are resized to the number of timestamps, and invalid entries (outside of the spline) are set to identity/zero.
+         *
+         * @param timestamps Desired times to get the acceleration at
+         * @param R_GtoI SO(3) orientation of the poses in the global frame
+         * @param p_IinG Position of the poses in the global
+         * @param w_IinI Angular velocities in the inertial frame
+         * @param v_IinG Linear velocities in the global frame
+         * @param alpha_IinI Angular accelerations in the inertial frame
+         * @param a_IinG Linear accelerations in the global frame
+         * @param valid If we were able to get each acceleration
+         */
+        void get_acceleration_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI, std::vector<Eigen::Vector3d> &p_IinG,
+                                    std::vector<Eigen::Vector3d> &w_IinI, std::vector<Eigen::Vector3d> &v_IinG,
+                                    std::vector<Eigen::Vector3d> &alpha_IinI, std::vector<Eigen::Vector3d> &a_IinG, std::vector<bool> &valid);
+
+
         /// Returns the simulation start time that we should start simulating from
         double get_start_time() {
             return timestamp_start;
@@ -166,14 +221,21 @@ namespace ov_core {
 
     protected:
 
+
         /// Uniform sampling time for our control points
         double dt;
 
         /// Start time of the system
         double timestamp_start;
 
-        /// Our control SE3 control poses (R_ItoG, p_IinG)
-        std::map<double,Eigen::MatrixXd> control_points;
+        /// Timestamp of the first control point (the i'th control point is at control_start+i*dt)
+        double control_start;
+
+        /// Our control SE3 control poses (R_ItoG, p_IinG) uniformly spaced by dt
+        std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> control_points;
+
+        /// Relative SE3 twist between each control point and the next, log(T_i^-1*T_i+1)
+        std::vector<Eigen::Matrix<double,6,1>, Eigen::aligned_allocator<Eigen::Matrix<double,6,1>>> control_omegas;
 
 
         /**
@@ -195,23 +257,61 @@ namespace ov_core {
 
 
         /**
-         * @brief Will find two older poses and two newer poses for the current timestamp
+         * @brief Will find two older control points and two newer control points for the current timestamp
          *
-         * @param timestamp Desired timestamp we want to get four bounding poses of
-         * @param poses Map of poses and timestamps
-         * @param t0 Timestamp of the first pose
-         * @param pose0 SE(3) pose of the first pose
-         * @param t1 Timestamp of the second pose
-         * @param pose1 SE(3) pose of the second pose
-         * @param t2 Timestamp of the third pose
-         * @param pose2 SE(3) pose of the third pose
-         * @param t3 Timestamp of the fourth pose
-         * @param pose3 SE(3) pose of the fourth pose
-         * @return False if we are unable to find bounding poses
+         * Since our control points are uniformly spaced we can directly compute the index of the segment.
+         * The four control points are then idx, idx+1, idx+2, idx+3 where the timestamp is between idx+1 and idx+2.
+         *
+         * @param timestamp Desired timestamp we want to get four bounding control points of
+         * @param idx Index of the oldest of the four control points
+         * @param u Normalized time of the timestamp between the second and third control points, in [0,1)
+         * @return False if we are unable to find bounding control points
+         */
+        bool find_bounding_control_points(double timestamp, size_t &idx, double &u);
+
+
+        /**
+         * @brief Evaluates the spline and its derivatives on a given segment
+         *
+         * @param idx Index of the oldest of the four control points
+         * @param u Normalized time in the segment
+         * @param order Highest derivative we want (0=pose, 1=velocity, 2=acceleration)
+         * @param R_GtoI SO(3) orientation of the pose in the global frame
+         * @param p_IinG Position of the pose in the global
+         * @param w_IinI Angular velocity in the inertial frame (only if order>=1)
+         * @param v_IinG Linear velocity in the global frame (only if order>=1)
+         * @param alpha_IinI Angular acceleration in the inertial frame (only if order>=2)
+         * @param a_IinG Linear acceleration in the global frame (only if order>=2)
+         */
+        void evaluate(size_t idx, double u, int order, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG,
+                      Eigen::Vector3d &w_IinI, Eigen::Vector3d &v_IinG, Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG);
+
+
+        /**
+         * @brief Evaluates the spline and its derivatives on a given segment with already computed exponentials
+         *
+         * The exponentials are A_k = exp(b_k(u)*omega_k) of the three twists of the segment (see get_segment_exponentials()).
+         * All other arguments are the same as evaluate().
+         */
+        void evaluate(size_t idx, double u, int order, const Eigen::Matrix4d &A0, const Eigen::Matrix4d &A1, const Eigen::Matrix4d &A2,
+                      Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI, Eigen::Vector3d &v_IinG,
+                      Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG);
+
+
+        /**
+         * @brief Finds the segment of many timestamps, and the exponentials of the scaled twists of each
+         *
+         * Each SE(3) exponential is [exp_so3(w), Jl_so3(w)*v], so we compute the rotations and left Jacobians of all
+         * twists with exp_so3_batch() and Jl_so3_batch() instead of calling exp_se3() three times for each timestamp.
+         *
+         * @param timestamps Desired times we want to evaluate the spline at
+         * @param idx Index of the oldest of the four control points of each timestamp
+         * @param u Normalized time of each timestamp in its segment
+         * @param A Exponentials of the three scaled twists of each timestamp (3*i to 3*i+2 are those of the i'th)
+         * @param valid If we were able to find the segment of each timestamp
          */
-        bool find_bounding_control_points(double timestamp, std::map<double,Eigen::MatrixXd> &poses,
-                                          double &t0, Eigen::Matrix4d &pose0, double &t1, Eigen::Matrix4d &pose1,
-                                          double &t2, Eigen::Matrix4d &pose2, double &t3, Eigen::Matrix4d &pose3);
+        void get_segment_exponentials(const std::vector<double> &timestamps, std::vector<size_t> &idx, std::vector<double> &u,
+                                      std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> &A, std::vector<bool> &valid);
 
     };
 
@@ -36,73 +36,13 @@ void TrackAruco::feed_monocular(double timestamp, cv::Mat &imgin, size_t cam_id)
     cv::Mat img;
     cv::equalizeHist(imgin, img);
 
-    // Clear the old data from the last timestep
-    ids_aruco[cam_id].clear();
-    corners[cam_id].clear();
-    rejects[cam_id].clear();
-
-    // If we are downsizing, then downsize
-    cv::Mat img0;
-    if(do_downsizing) {
-        cv::pyrDown(img,img0,cv::Size(img.cols/2,img.rows/2));
-    } else {
-        img0 = img;
-    }
-
-
-    //===================================================================================
-    //===================================================================================
-
-    // Perform extraction
-    cv::aruco::detectMarkers(img0,aruco_dict,corners[cam_id],ids_aruco[cam_id],aruco_params,rejects[cam_id]);
+    // Perform extraction (or tracking of the tags from the last frame)
+    perform_detection(img, cam_id);
     rT2 =  boost::posix_time::microsec_clock::local_time();
 
-
-    //===================================================================================
-    //===================================================================================
-
-    // If we downsized, scale all our u,v measurements by a factor of two
-    // Note: we do this so we can use these results for visulization later
-    // Note: and so that the uv added is in the same image size
-    if(do_downsizing) {
-        for(size_t i=0; i<corners[cam_id].size(); i++) {
-            for(size_t j=0; j<corners[cam_id].at(i).size(); j++) {
-                corners[cam_id].at(i).at(j).x *= 2;
-                corners[cam_id].at(i).at(j).y *= 2;
-            }
-        }
-        for(size_t i=0; i<rejects[cam_id].size(); i++) {
-            for(size_t j=0; j<rejects[cam_id].at(i).size(); j++) {
-                rejects[cam_id].at(i).at(j).x *= 2;
-                rejects[cam_id].at(i).at(j).y *= 2;
-            }
-        }
-    }
-
-
-    //===================================================================================
-    //===================================================================================
-
-
-    // ID vectors, of all currently tracked IDs
-    std::vector<size_t> ids_new;
-
     // Append to our feature database this new information
-    for(size_t i=0; i<ids_aruco[cam_id].size(); i++) {
-        // Skip if ID is greater then our max
-        if(ids_aruco[cam_id].at(i) > max_tag_id)
-            continue;
-        // Assert we have 4 points (we will only use one of them)
-        assert(corners[cam_id].at(i).size()==4);
-        // Try to undistort the point
-        cv::Point2f npt_l = undistort_point(corners[cam_id].at(i).at(0), cam_id);
-        // Append to the ids vector and database
-        ids_new.push_back((size_t)ids_aruco[cam_id].at(i));
-        database->update_feature((size_t)ids_aruco[cam_id].at(i), timestamp, cam_id,
-                                 corners[cam_id].at(i).at(0).x, corners[cam_id].at(i).at(0).y,
-                                 npt_l.x, npt_l.y);
-    }
-
+    std::vector<size_t> ids_new;
+    update_database(timestamp, cam_id, ids_new);
 
     // Move forward in time
     img_last[cam_id] = img.clone();
@@ -131,118 +71,160 @@ void TrackAruco::feed_stereo(double timestamp, cv::Mat &img_leftin, cv::Mat &img
     cv::equalizeHist(img_leftin, img_left);
     cv::equalizeHist(img_rightin, img_right);
 
+    // Perform extraction (doing this in parallel is actually slower on my machine -pgeneva)
+    perform_detection(img_left, cam_id_left);
+    perform_detection(img_right, cam_id_right);
+    rT2 =  boost::posix_time::microsec_clock::local_time();
+
+    // Append to our feature database this new information
+    std::vector<size_t> ids_left_new, ids_right_new;
+    update_database(timestamp, cam_id_left, ids_left_new);
+    update_database(timestamp, cam_id_right, ids_right_new);
+
+    // Move forward in time
+    img_last[cam_id_left] = img_left.clone();
+    img_last[cam_id_right] = img_right.clone();
+    ids_last[cam_id_left] = ids_left_new;
+    ids_last[cam_id_right] = ids_right_new;
+    rT3 =  boost::posix_time::microsec_clock::local_time();
+
+    // Timing information
+    //printf("[TIME-ARUCO]: %.4f seconds for detection\n",(rT2-rT1).total_microseconds() * 1e-6);
+    //printf("[TIME-ARUCO]: %.4f seconds for feature DB update (%d features)\n",(rT3-rT2).total_microseconds() * 1e-6, (int)good_left.size());
+    //printf("[TIME-ARUCO]: %.4f seconds for total\m",(rT3-rT1).total_microseconds() * 1e-6);
+
+}
+
+
+void TrackAruco::perform_detection(const cv::Mat &img, size_t cam_id) {
+
+    // Get the tags from the last timestep
+    std::vector<int> ids_old = ids_aruco[cam_id];
+    std::vector<std::vector<cv::Point2f>> corners_old = corners[cam_id];
+
     // Clear the old data from the last timestep
-    ids_aruco[cam_id_left].clear();
-    ids_aruco[cam_id_right].clear();
-    corners[cam_id_left].clear();
-    corners[cam_id_right].clear();
-    rejects[cam_id_left].clear();
-    rejects[cam_id_right].clear();
+    ids_aruco[cam_id].clear();
+    corners[cam_id].clear();
+    rejects[cam_id].clear();
+
+    // If we have tags from the last image, and it is not time for a full detection, then just track them
+    bool can_track = (!ids_old.empty() && img_last.find(cam_id) != img_last.end() && img_last[cam_id].size() == img.size());
+    if(can_track && frames_since_detect[cam_id]+1 < detect_interval) {
+        perform_tracking(img, cam_id, ids_old, corners_old);
+        frames_since_detect[cam_id]++;
+        return;
+    }
+    frames_since_detect[cam_id] = 0;
 
     // If we are downsizing, then downsize
-    cv::Mat img0, img1;
+    cv::Mat img0;
     if(do_downsizing) {
-        cv::pyrDown(img_left,img0,cv::Size(img_left.cols/2,img_left.rows/2));
-        cv::pyrDown(img_right,img1,cv::Size(img_right.cols/2,img_right.rows/2));
+        cv::pyrDown(img,img0,cv::Size(img.cols/2,img.rows/2));
     } else {
-        img0 = img_left;
-        img1 = img_right;
+        img0 = img;
     }
 
-
-    //===================================================================================
-    //===================================================================================
-
-    // Perform extraction (doing this in parallel is actually slower on my machine -pgeneva)
-    cv::aruco::detectMarkers(img0,aruco_dict,corners[cam_id_left],ids_aruco[cam_id_left],aruco_params,rejects[cam_id_left]);
-    cv::aruco::detectMarkers(img1,aruco_dict,corners[cam_id_right],ids_aruco[cam_id_right],aruco_params,rejects[cam_id_right]);
-    rT2 =  boost::posix_time::microsec_clock::local_time();
-
-
-    //===================================================================================
-    //===================================================================================
+    // Perform extraction
+    cv::aruco::detectMarkers(img0,aruco_dict,corners[cam_id],ids_aruco[cam_id],aruco_params,rejects[cam_id]);
 
     // If we downsized, scale all our u,v measurements by a factor of two
     // Note: we do this so we can use these results for visulization later
     // Note: and so that the uv added is in the same image size
     if(do_downsizing) {
-        for(size_t i=0; i<corners[cam_id_left].size(); i++) {
-            for(size_t j=0; j<corners[cam_id_left].at(i).size(); j++) {
-                corners[cam_id_left].at(i).at(j).x *= 2;
-                corners[cam_id_left].at(i).at(j).y *= 2;
+        for(size_t i=0; i<corners[cam_id].size(); i++) {
+            for(size_t j=0; j<corners[cam_id].at(i).size(); j++) {
+                corners[cam_id].at(i).at(j).x *= 2;
+                corners[cam_id].at(i).at(j).y *= 2;
             }
         }
-        for(size_t i=0; i<corners[cam_id_right].size(); i++) {
-            for(size_t j=0; j<corners[cam_id_right].at(i).size(); j++) {
-                corners[cam_id_right].at(i).at(j).x *= 2;
-                corners[cam_id_right].at(i).at(j).y *= 2;
+        for(size_t i=0; i<rejects[cam_id].size(); i++) {
+            for(size_t j=0; j<rejects[cam_id].at(i).size(); j++) {
+                rejects[cam_id].at(i).at(j).x *= 2;
+                rejects[cam_id].at(i).at(j).y *= 2;
             }
         }
-        for(size_t i=0; i<rejects[cam_id_left].size(); i++) {
-            for(size_t j=0; j<rejects[cam_id_left].at(i).size(); j++) {
-                rejects[cam_id_left].at(i).at(j).x *= 2;
-                rejects[cam_id_left].at(i).at(j).y *= 2;
-            }
+    }
+
+}
+
+
+void TrackAruco::perform_tracking(const cv::Mat &img, size_t cam_id, const std::vector<int> &ids_old,
+                                  const std::vector<std::vector<cv::Point2f>> &corners_old) {
+
+    // Stack all the corners of all our tags
+    std::vector<cv::Point2f> pts0, pts1;
+    for(size_t i=0; i<corners_old.size(); i++) {
+        assert(corners_old.at(i).size()==4);
+        pts0.insert(pts0.end(), corners_old.at(i).begin(), corners_old.at(i).end());
+    }
+
+    // Do KLT tracking of all the corners into the new image
+    std::vector<uchar> mask;
+    std::vector<float> error;
+    cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 15, 0.01);
+    cv::calcOpticalFlowPyrLK(img_last[cam_id], img, pts0, pts1, mask, error, cv::Size(21,21), 3, term_crit);
+
+    // Loop through each tag, and refine its tracked location by detecting only in the region around it
+    cv::Rect bounds(0, 0, img.cols, img.rows);
+    for(size_t i=0; i<ids_old.size(); i++) {
+
+        // Skip this tag if any of its corners where lost
+        bool good = true;
+        std::vector<cv::Point2f> corners_new;
+        for(size_t j=0; j<4; j++) {
+            const cv::Point2f &pt = pts1.at(4*i+j);
+            good = good && mask.at(4*i+j) && bounds.contains(cv::Point((int)pt.x,(int)pt.y));
+            corners_new.push_back(pt);
         }
-        for(size_t i=0; i<rejects[cam_id_right].size(); i++) {
-            for(size_t j=0; j<rejects[cam_id_right].at(i).size(); j++) {
-                rejects[cam_id_right].at(i).at(j).x *= 2;
-                rejects[cam_id_right].at(i).at(j).y *= 2;
+        if(!good)
+            continue;
+
+        // Our predicted region, which is the tag with a margin of half its size on each side
+        cv::Rect box = cv::boundingRect(corners_new);
+        int margin = std::max(box.width, box.height)/2 + 5;
+        cv::Rect roi = cv::Rect(box.x-margin, box.y-margin, box.width+2*margin, box.height+2*margin) & bounds;
+
+        // Detect in this region, and if we find this tag use its detected corners
+        // Else we will just use the KLT tracked corners of the tag
+        std::vector<int> ids_roi;
+        std::vector<std::vector<cv::Point2f>> corners_roi, rejects_roi;
+        cv::aruco::detectMarkers(img(roi),aruco_dict,corners_roi,ids_roi,aruco_params,rejects_roi);
+        for(size_t k=0; k<ids_roi.size(); k++) {
+            if(ids_roi.at(k) != ids_old.at(i))
+                continue;
+            for(size_t j=0; j<corners_roi.at(k).size() && j<4; j++) {
+                corners_new.at(j) = corners_roi.at(k).at(j) + cv::Point2f((float)roi.x,(float)roi.y);
             }
+            break;
         }
-    }
 
+        // Append this tag
+        ids_aruco[cam_id].push_back(ids_old.at(i));
+        corners[cam_id].push_back(corners_new);
 
-    //===================================================================================
-    //===================================================================================
+    }
 
+}
 
-    // ID vectors, of all currently tracked IDs
-    std::vector<size_t> ids_left_new, ids_right_new;
+
+void TrackAruco::update_database(double timestamp, size_t cam_id, std::vector<size_t> &ids_new) {
 
     // Append to our feature database this new information
-    for(size_t i=0; i<ids_aruco[cam_id_left].size(); i++) {
-        // Skip if ID is greater then our max
-        if(ids_aruco[cam_id_left].at(i) > max_tag_id)
-            continue;
-        // Assert we have 4 points (we will only use one of them)
-        assert(corners[cam_id_left].at(i).size()==4);
-        // Try to undistort the point (could fail undistortion!)
-        cv::Point2f npt_l = undistort_point(corners[cam_id_left].at(i).at(0), cam_id_left);
-        // Append to the ids vector and database
-        ids_left_new.push_back((size_t)ids_aruco[cam_id_left].at(i));
-        database->update_feature((size_t)ids_aruco[cam_id_left].at(i), timestamp, cam_id_left,
-                                 corners[cam_id_left].at(i).at(0).x, corners[cam_id_left].at(i).at(0).y,
-                                 npt_l.x, npt_l.y);
-    }
-    for(size_t i=0; i<ids_aruco[cam_id_right].size(); i++) {
+    for(size_t i=0; i<ids_aruco[cam_id].size(); i++) {
         // Skip if ID is greater then our max
-        if(ids_aruco[cam_id_right].at(i) > max_tag_id)
+        if(ids_aruco[cam_id].at(i) > max_tag_id)
             continue;
         // Assert we have 4 points (we will only use one of them)
-        assert(corners[cam_id_right].at(i).size()==4);
+        assert(corners[cam_id].at(i).size()==4);
         // Try to undistort the point (could fail undistortion!)
-        cv::Point2f npt_l = undistort_point(corners[cam_id_right].at(i).at(0), cam_id_right);
+        cv::Point2f npt_l = undistort_point(corners[cam_id].at(i).at(0), cam_id);
         // Append to the ids vector and database
-        ids_right_new.push_back((size_t)ids_aruco[cam_id_right].at(i));
-        database->update_feature((size_t)ids_aruco[cam_id_right].at(i), timestamp, cam_id_right,
-                                 corners[cam_id_right].at(i).at(0).x, corners[cam_id_right].at(i).at(0).y,
+        ids_new.push_back((size_t)ids_aruco[cam_id].at(i));
+        database->update_feature((size_t)ids_aruco[cam_id].at(i), timestamp, cam_id,
+                                 corners[cam_id].at(i).at(0).x, corners[cam_id].at(i).at(0).y,
                                  npt_l.x, npt_l.y);
     }
 
-
-    // Move forward in time
-    img_last[cam_id_left] = img_left.clone();
-    img_last[cam_id_right] = img_right.clone();
-    ids_last[cam_id_left] = ids_left_new;
-    ids_last[cam_id_right] = ids_right_new;
-    rT3 =  boost::posix_time::microsec_clock::local_time();
-
-    // Timing information
-    //printf("[TIME-ARUCO]: %.4f seconds for detection\n",(rT2-rT1).total_microseconds() * 1e-6);
-    //printf("[TIME-ARUCO]: %.4f seconds for feature DB update (%d features)\n",(rT3-rT2).total_microseconds() * 1e-6, (int)good_left.size());
-    //printf("[TIME-ARUCO]: %.4f seconds for total\m",(rT3-rT1).total_microseconds() * 1e-6);
-
 }
 
 
@@ -251,6 +233,7 @@ void TrackAruco::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2
     // Cache the images to prevent other threads from editing while we viz (which can be slow)
     std::map<size_t, cv::Mat> img_last_cache;
     for(auto const& pair : img_last) {
+        std::unique_lock<std::mutex> lck(mtx_feeds.at(pair.first));
         img_last_cache.insert({pair.first,pair.second.clone()});
     }
 
@@ -42,7 +42,7 @@ namespace ov_core {
         /**
          * @brief Public default constructor
          */
-        TrackAruco() : TrackBase(), max_tag_id(1024), do_downsizing(false) {
+        TrackAruco() : TrackBase(), max_tag_id(1024), do_downsizing(false), detect_interval(1) {
             aruco_dict = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250);
             aruco_params = cv::aruco::DetectorParameters::create();
             //aruco_params->cornerRefinementMethod = cv::aruco::CornerRefineMethod::CORNER_REFINE_SUBPIX; // people with newer opencv might fail here
@@ -52,8 +52,10 @@ namespace ov_core {
          * @brief Public constructor with configuration variables
          * @param numaruco the max id of the arucotags, we don't use any tags greater than this value even if we extract them
          * @param do_downsizing we can scale the image by 1/2 to increase Aruco tag extraction speed
+         * @param detectinterval we will do a full detection every this many frames, and track the tags in between (1 will detect every frame)
          */
-        explicit TrackAruco(int numaruco, bool do_downsizing) : TrackBase(0, numaruco), max_tag_id(numaruco), do_downsizing(do_downsizing) {
+        explicit TrackAruco(int numaruco, bool do_downsizing, int detectinterval = 1) : TrackBase(0, numaruco), max_tag_id(numaruco),
+                                                                                        do_downsizing(do_downsizing), detect_interval(detectinterval) {
             aruco_dict = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_250);
             aruco_params = cv::aruco::DetectorParameters::create();
             //aruco_params->cornerRefinementMethod = cv::aruco::CornerRefineMethod::CORNER_REFINE_SUBPIX; // people with newer opencv might fail here
@@ -89,6 +91,37 @@ namespace ov_core {
 
     protected:
 
+        /**
+         * @brief Extracts the tags in the current image
+         * @param img equalized image we will detect in
+         * @param cam_id the camera id that this image corresponds too
+         *
+         * A full detection (on the downsized image if enabled) is done every detect_interval frames.
+         * In between, we track the tags from the last frame using perform_tracking().
+         */
+        void perform_detection(const cv::Mat &img, size_t cam_id);
+
+        /**
+         * @brief Tracks the tags from the last frame into the current image
+         * @param img equalized image we will track into
+         * @param cam_id the camera id that this image corresponds too
+         * @param ids_old tag ids from the last image
+         * @param corners_old tag corners from the last image
+         *
+         * We KLT track the four corners of each tag, and then run the detector only in the region around the tracked tag.
+         * If the tag is detected there, we use its detected corners, otherwise we fall back to the KLT corners.
+         */
+        void perform_tracking(const cv::Mat &img, size_t cam_id, const std::vector<int> &ids_old,
+                              const std::vector<std::vector<cv::Point2f>> &corners_old);
+
+        /**
+         * @brief Appends the current tags of this camera to our feature database
+         * @param timestamp timestamp the image occurred at
+         * @param cam_id the camera id that this image corresponds too
+         * @param ids_new ids of all tags that we have added
+         */
+        void update_database(double timestamp, size_t cam_id, std::vector<size_t> &ids_new);
+
         // Timing variables
         boost::posix_time::ptime rT1, rT2, rT3, rT4, rT5, rT6, rT7;
 
@@ -98,6 +131,12 @@ namespace ov_core {
         // If we should downsize the image
         bool do_downsizing;
 
+        // We do a full detection every this many frames, and track the tags in between
+        int detect_interval;
+
+        // Number of frames since our last full detection for each camera
+        std::unordered_map<size_t, int> frames_since_detect;
+
         // Our dictionary that we will extract aruco tags with
         cv::Ptr<cv::aruco::Dictionary> aruco_dict;
 
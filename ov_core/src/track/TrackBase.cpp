@@ -27,8 +27,10 @@ using namespace ov_core;
 void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2) {
 
     // Cache the images to prevent other threads from editing while we viz (which can be slow)
+    // Lock each feed while copying, since a tracking thread might be replacing the image
     std::map<size_t, cv::Mat> img_last_cache;
     for(auto const& pair : img_last) {
+        std::unique_lock<std::mutex> lck(mtx_feeds.at(pair.first));
         img_last_cache.insert({pair.first,pair.second.clone()});
     }
 
@@ -85,8 +87,10 @@ void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2,
 void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2) {
 
     // Cache the images to prevent other threads from editing while we viz (which can be slow)
+    // Lock each feed while copying, since a tracking thread might be replacing the image
     std::map<size_t, cv::Mat> img_last_cache;
     for(auto const& pair : img_last) {
+        std::unique_lock<std::mutex> lck(mtx_feeds.at(pair.first));
         img_last_cache.insert({pair.first,pair.second.clone()});
     }
 
@@ -38,6 +38,7 @@
 #include "Grider_DOG.h"
 #include "feat/FeatureDatabase.h"
 #include "utils/colors.h"
+#include "utils/ThreadPool.h"
 
 
 namespace ov_core {
@@ -243,6 +244,20 @@ namespace ov_core {
             return database;
         }
 
+        /// Gets the next feature ID this tracker will assign
+        size_t get_currid() {
+            return currid;
+        }
+
+        /**
+         * @brief Overwrites the next feature ID this tracker will assign
+         * This is used when restoring a tracker, so new features will not collide with the restored ones.
+         * @param id Next ID that should be assigned
+         */
+        void set_currid(size_t id) {
+            currid = id;
+        }
+
         /**
          * @brief Changes the ID of an actively tracked feature to another one
          * @param id_old Old id we want to change
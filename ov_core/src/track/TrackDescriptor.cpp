@@ -59,7 +59,7 @@ void TrackDescriptor::feed_monocular(double timestamp, cv::Mat &imgin, size_t ca
     std::vector<cv::DMatch> matches_ll;
 
     // Lets match temporally
-    robust_match(pts_last[cam_id],pts_new,desc_last[cam_id],desc_new,cam_id,cam_id,matches_ll);
+    robust_match(pts_last[cam_id],pts_new,desc_last[cam_id],desc_new,cam_id,cam_id,matches_ll,match_window);
     rT3 =  boost::posix_time::microsec_clock::local_time();
 
 
@@ -184,14 +184,16 @@ void TrackDescriptor::feed_stereo(double timestamp, cv::Mat &img_leftin, cv::Mat
     std::vector<cv::DMatch> matches_ll, matches_rr;
 
     // Lets match temporally
-    boost::thread t_ll = boost::thread(&TrackDescriptor::robust_match, this, boost::ref(pts_last[cam_id_left]), boost::ref(pts_left_new),
-                                       boost::ref(desc_last[cam_id_left]), boost::ref(desc_left_new), cam_id_left, cam_id_left, boost::ref(matches_ll));
-    boost::thread t_rr = boost::thread(&TrackDescriptor::robust_match, this, boost::ref(pts_last[cam_id_right]), boost::ref(pts_right_new),
-                                       boost::ref(desc_last[cam_id_right]), boost::ref(desc_right_new), cam_id_right, cam_id_right, boost::ref(matches_rr));
-
-    // Wait till both threads finish
-    t_ll.join();
-    t_rr.join();
+    std::future<void> t_ll = ThreadPool::instance()->enqueue([&]{
+        robust_match(pts_last[cam_id_left], pts_left_new, desc_last[cam_id_left], desc_left_new, cam_id_left, cam_id_left, matches_ll, match_window);
+    });
+    std::future<void> t_rr = ThreadPool::instance()->enqueue([&]{
+        robust_match(pts_last[cam_id_right], pts_right_new, desc_last[cam_id_right], desc_right_new, cam_id_right, cam_id_right, matches_rr, match_window);
+    });
+
+    // Wait till both tasks finish
+    t_ll.get();
+    t_rr.get();
     rT3 =  boost::posix_time::microsec_clock::local_time();
 
 
@@ -340,27 +342,29 @@ void TrackDescriptor::perform_detection_stereo(const cv::Mat &img0, const cv::Ma
 
     // Extract our features (use FAST with griding)
     std::vector<cv::KeyPoint> pts0_ext, pts1_ext;
-    boost::thread t_0 = boost::thread(&Grider_FAST::perform_griding, boost::cref(img0), boost::ref(pts0_ext),
-                                      num_features, grid_x, grid_y, threshold, true);
-    boost::thread t_1 = boost::thread(&Grider_FAST::perform_griding, boost::cref(img1), boost::ref(pts1_ext),
-                                      num_features, grid_x, grid_y, threshold, true);
+    std::future<void> t_0 = ThreadPool::instance()->enqueue([&]{
+        Grider_FAST::perform_griding(img0, pts0_ext, num_features, grid_x, grid_y, threshold, true);
+    });
+    std::future<void> t_1 = ThreadPool::instance()->enqueue([&]{
+        Grider_FAST::perform_griding(img1, pts1_ext, num_features, grid_x, grid_y, threshold, true);
+    });
 
-    // Wait till both threads finish
-    t_0.join();
-    t_1.join();
+    // Wait till both tasks finish
+    t_0.get();
+    t_1.get();
 
     // For all new points, extract their descriptors
     cv::Mat desc0_ext, desc1_ext;
 
     // Use C++11 lamdas so we can pass all theses variables by reference
-    std::thread t_desc0 = std::thread([this,&img0,&pts0_ext,&desc0_ext]{this->orb0->compute(img0, pts0_ext, desc0_ext);});
-    std::thread t_desc1 = std::thread([this,&img1,&pts1_ext,&desc1_ext]{this->orb1->compute(img1, pts1_ext, desc1_ext);});
-    //std::thread t_desc0 = std::thread([this,&img0,&pts0_ext,&desc0_ext]{this->freak0->compute(img0, pts0_ext, desc0_ext);});
-    //std::thread t_desc1 = std::thread([this,&img1,&pts1_ext,&desc1_ext]{this->freak1->compute(img1, pts1_ext, desc1_ext);});
+    std::future<void> t_desc0 = ThreadPool::instance()->enqueue([this,&img0,&pts0_ext,&desc0_ext]{this->orb0->compute(img0, pts0_ext, desc0_ext);});
+    std::future<void> t_desc1 = ThreadPool::instance()->enqueue([this,&img1,&pts1_ext,&desc1_ext]{this->orb1->compute(img1, pts1_ext, desc1_ext);});
+    //std::future<void> t_desc0 = ThreadPool::instance()->enqueue([this,&img0,&pts0_ext,&desc0_ext]{this->freak0->compute(img0, pts0_ext, desc0_ext);});
+    //std::future<void> t_desc1 = ThreadPool::instance()->enqueue([this,&img1,&pts1_ext,&desc1_ext]{this->freak1->compute(img1, pts1_ext, desc1_ext);});
 
-    // Wait till both threads finish
-    t_desc0.join();
-    t_desc1.join();
+    // Wait till both tasks finish
+    t_desc0.get();
+    t_desc1.get();
 
     // Do matching from the left to the right image
     std::vector<cv::DMatch> matches;
@@ -385,14 +389,20 @@ void TrackDescriptor::perform_detection_stereo(const cv::Mat &img0, const cv::Ma
 }
 
 void TrackDescriptor::robust_match(std::vector<cv::KeyPoint>& pts0, std::vector<cv::KeyPoint> pts1,
-                                   cv::Mat& desc0, cv::Mat& desc1, size_t id0, size_t id1, std::vector<cv::DMatch>& matches) {
+                                   cv::Mat& desc0, cv::Mat& desc1, size_t id0, size_t id1, std::vector<cv::DMatch>& matches, int window) {
 
     // Our 1to2 and 2to1 match vectors
     std::vector<std::vector<cv::DMatch> > matches0to1, matches1to0;
 
     // Match descriptors (return 2 nearest neighbours)
-    matcher->knnMatch(desc0, desc1, matches0to1, 2);
-    matcher->knnMatch(desc1, desc0, matches1to0, 2);
+    // If we have a window, we only compare against the descriptors close to our keypoint
+    if(window > 0) {
+        guided_knn_match(pts0, pts1, desc0, desc1, window, matches0to1);
+        guided_knn_match(pts1, pts0, desc1, desc0, window, matches1to0);
+    } else {
+        matcher->knnMatch(desc0, desc1, matches0to1, 2);
+        matcher->knnMatch(desc1, desc0, matches1to0, 2);
+    }
 
     // Do a ratio test for both matches
     robust_ratio_test(matches0to1);
@@ -444,6 +454,60 @@ void TrackDescriptor::robust_match(std::vector<cv::KeyPoint>& pts0, std::vector<
 
 }
 
+void TrackDescriptor::guided_knn_match(const std::vector<cv::KeyPoint> &pts_query, const std::vector<cv::KeyPoint> &pts_train,
+                                       const cv::Mat &desc_query, const cv::Mat &desc_train, int window,
+                                       std::vector<std::vector<cv::DMatch>> &matches) {
+
+    // Bucket our train keypoints into a grid, where each cell is the size of our window
+    // Thus all train points within the window of a query will be in the 3x3 neighboring cells
+    std::unordered_map<uint64_t, std::vector<int>> grid;
+    auto cell_key = [](int cx, int cy) { return ((uint64_t)(uint32_t)cx << 32) | (uint64_t)(uint32_t)cy; };
+    for(size_t i=0; i<pts_train.size(); i++) {
+        int cx = (int)std::floor(pts_train.at(i).pt.x/window);
+        int cy = (int)std::floor(pts_train.at(i).pt.y/window);
+        grid[cell_key(cx,cy)].push_back((int)i);
+    }
+
+    // For each query, find the two closest descriptors in the window (hamming distance)
+    matches.clear();
+    matches.resize(pts_query.size());
+    for(size_t i=0; i<pts_query.size(); i++) {
+        const cv::Point2f &pt = pts_query.at(i).pt;
+        int cx = (int)std::floor(pt.x/window);
+        int cy = (int)std::floor(pt.y/window);
+        cv::DMatch best((int)i,-1,INFINITY), second((int)i,-1,INFINITY);
+        for(int dx=-1; dx<=1; dx++) {
+            for(int dy=-1; dy<=1; dy++) {
+                auto cell = grid.find(cell_key(cx+dx,cy+dy));
+                if(cell == grid.end())
+                    continue;
+                for(int j : cell->second) {
+                    const cv::Point2f &pt_train = pts_train.at(j).pt;
+                    if(std::abs(pt_train.x-pt.x) > window || std::abs(pt_train.y-pt.y) > window)
+                        continue;
+                    float dist = (float)cv::norm(desc_query.row(i), desc_train.row(j), cv::NORM_HAMMING);
+                    if(dist < best.distance) {
+                        second = best;
+                        best = cv::DMatch((int)i,j,dist);
+                    } else if(dist < second.distance) {
+                        second = cv::DMatch((int)i,j,dist);
+                    }
+                }
+            }
+        }
+        // Append the two nearest neighbours
+        // If there is only a single candidate in our window it is unambiguous, so we pass it as the second neighbour
+        // having the largest possible hamming distance (the ratio test then only rejects it if it is a terrible match)
+        if(best.trainIdx == -1)
+            continue;
+        if(second.trainIdx == -1)
+            second = cv::DMatch((int)i,-1,(float)(8*desc_train.cols));
+        matches.at(i).push_back(best);
+        matches.at(i).push_back(second);
+    }
+
+}
+
 void TrackDescriptor::robust_ratio_test(std::vector<std::vector<cv::DMatch> >& matches) {
 
     // Loop through all matches
@@ -473,19 +537,20 @@ void TrackDescriptor::robust_symmetry_test(std::vector<std::vector<cv::DMatch> >
         if (matchIterator1->empty() || matchIterator1->size() < 2)
             continue;
 
-        // for all matches image 2 -> image 1
-        for (auto matchIterator2 = matches2.begin(); matchIterator2 != matches2.end(); ++matchIterator2) {
-            // ignore deleted matches
-            if (matchIterator2->empty() || matchIterator2->size() < 2)
-                continue;
-
-            // Match symmetry test
-            if ((*matchIterator1)[0].queryIdx == (*matchIterator2)[0].trainIdx && (*matchIterator2)[0].queryIdx == (*matchIterator1)[0].trainIdx) {
-                // add symmetrical match
-                good_matches.emplace_back(cv::DMatch((*matchIterator1)[0].queryIdx,(*matchIterator1)[0].trainIdx,(*matchIterator1)[0].distance));
-                // next match in image 1 -> image 2
-                break;
-            }
+        // the matches image 2 -> image 1 are indexed by their query, so we can directly look up the reverse match
+        int index2 = (*matchIterator1)[0].trainIdx;
+        if (index2 < 0 || index2 >= (int)matches2.size())
+            continue;
+        const std::vector<cv::DMatch> &match2 = matches2.at(index2);
+
+        // ignore deleted matches
+        if (match2.empty() || match2.size() < 2)
+            continue;
+
+        // Match symmetry test
+        if ((*matchIterator1)[0].queryIdx == match2[0].trainIdx && match2[0].queryIdx == (*matchIterator1)[0].trainIdx) {
+            // add symmetrical match
+            good_matches.emplace_back(cv::DMatch((*matchIterator1)[0].queryIdx,(*matchIterator1)[0].trainIdx,(*matchIterator1)[0].distance));
         }
     }
 
@@ -54,9 +54,11 @@ namespace ov_core {
          * @param gridx size of grid in the x-direction / u-direction
          * @param gridy size of grid in the y-direction / v-direction
          * @param knnratio matching ratio needed (smaller value forces top two descriptors during match to be more different)
+         * @param matchwindow half size in pixels of the window we search for temporal matches in (non-positive will brute force match)
          */
-        explicit TrackDescriptor(int numfeats, int numaruco, int fast_threshold, int gridx, int gridy, double knnratio) :
-                                 TrackBase(numfeats, numaruco), threshold(fast_threshold), grid_x(gridx), grid_y(gridy), knn_ratio(knnratio) {}
+        explicit TrackDescriptor(int numfeats, int numaruco, int fast_threshold, int gridx, int gridy, double knnratio, int matchwindow = -1) :
+                                 TrackBase(numfeats, numaruco), threshold(fast_threshold), grid_x(gridx), grid_y(gridy), knn_ratio(knnratio),
+                                 match_window(matchwindow) {}
 
         /**
          * @brief Process a new monocular image
@@ -126,14 +128,34 @@ namespace ov_core {
          * @param id0 id of the first camera
          * @param id1 id of the second camera
          * @param matches vector of matches that we have found
+         * @param window half size in pixels of the search window around each keypoint (non-positive will brute force match)
          *
          * This will perform a "robust match" between the two sets of points (slow but has great results).
          * First we do a simple KNN match from 1to2 and 2to1, which is followed by a ratio check and symmetry check.
+         * If a window is given, then the KNN match only compares descriptors of keypoints which are close in the image (see guided_knn_match()).
          * Original code is from the "RobustMatcher" in the opencv examples, and seems to give very good results in the matches.
          * https://github.com/opencv/opencv/blob/master/samples/cpp/tutorial_code/calib3d/real_time_pose_estimation/src/RobustMatcher.cpp
          */
         void robust_match(std::vector<cv::KeyPoint> &pts0, std::vector<cv::KeyPoint> pts1,
-                          cv::Mat &desc0, cv::Mat &desc1, size_t id0, size_t id1, std::vector<cv::DMatch> &matches);
+                          cv::Mat &desc0, cv::Mat &desc1, size_t id0, size_t id1, std::vector<cv::DMatch> &matches, int window = -1);
+
+        /**
+         * @brief Finds the two nearest descriptors for each query keypoint, only searching in a window around it.
+         * @param pts_query keypoints we want to find matches for
+         * @param pts_train keypoints we will search over
+         * @param desc_query descriptors of the query keypoints
+         * @param desc_train descriptors of the train keypoints
+         * @param window half size in pixels of the search window
+         * @param matches for each query, the two closest matches (same format as cv::DescriptorMatcher::knnMatch)
+         *
+         * The train keypoints are bucketed into a grid with cells the size of the window.
+         * Thus each query only needs to look at its neighboring cells, and the cost is linear in the number of features.
+         * A query with a single candidate in its window gets a second match with the largest possible hamming distance (and no train index),
+         * so that this unique match passes the ratio test. Queries without candidates have no matches.
+         */
+        void guided_knn_match(const std::vector<cv::KeyPoint> &pts_query, const std::vector<cv::KeyPoint> &pts_train,
+                              const cv::Mat &desc_query, const cv::Mat &desc_train, int window,
+                              std::vector<std::vector<cv::DMatch>> &matches);
 
         // Helper functions for the robust_match function
         // Original code is from the "RobustMatcher" in the opencv examples
@@ -162,6 +184,9 @@ namespace ov_core {
         // then the two features are too close, so should be considered ambiguous/bad match
         double knn_ratio;
 
+        // Half size in pixels of the window we search for temporal matches in (non-positive will brute force match)
+        int match_window;
+
         // Descriptor matrices
         std::unordered_map<size_t, cv::Mat> desc_last;
 
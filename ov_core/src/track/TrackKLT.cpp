@@ -141,21 +141,21 @@ void TrackKLT::feed_stereo(double timestamp, cv::Mat &img_leftin, cv::Mat &img_r
 
     // Histogram equalize
     cv::Mat img_left, img_right;
-    boost::thread t_lhe = boost::thread(cv::equalizeHist, boost::cref(img_leftin), boost::ref(img_left));
-    boost::thread t_rhe = boost::thread(cv::equalizeHist, boost::cref(img_rightin), boost::ref(img_right));
-    t_lhe.join();
-    t_rhe.join();
+    std::future<void> t_lhe = ThreadPool::instance()->enqueue([&]{ cv::equalizeHist(img_leftin, img_left); });
+    std::future<void> t_rhe = ThreadPool::instance()->enqueue([&]{ cv::equalizeHist(img_rightin, img_right); });
+    t_lhe.get();
+    t_rhe.get();
 
-    // Extract image pyramids (boost seems to require us to put all the arguments even if there are defaults....)
+    // Extract image pyramids
     std::vector<cv::Mat> imgpyr_left, imgpyr_right;
-    boost::thread t_lp = boost::thread(cv::buildOpticalFlowPyramid, boost::cref(img_left),
-                                       boost::ref(imgpyr_left), boost::ref(win_size), boost::ref(pyr_levels), false,
-                                       cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, true);
-    boost::thread t_rp = boost::thread(cv::buildOpticalFlowPyramid, boost::cref(img_right),
-                                       boost::ref(imgpyr_right), boost::ref(win_size), boost::ref(pyr_levels),
-                                       false, cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, true);
-    t_lp.join();
-    t_rp.join();
+    std::future<void> t_lp = ThreadPool::instance()->enqueue([&]{
+        cv::buildOpticalFlowPyramid(img_left, imgpyr_left, win_size, pyr_levels, false, cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, true);
+    });
+    std::future<void> t_rp = ThreadPool::instance()->enqueue([&]{
+        cv::buildOpticalFlowPyramid(img_right, imgpyr_right, win_size, pyr_levels, false, cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, true);
+    });
+    t_lp.get();
+    t_rp.get();
     rT2 =  boost::posix_time::microsec_clock::local_time();
 
     // If we didn't have any successful tracks last time, just extract this time
@@ -188,14 +188,16 @@ void TrackKLT::feed_stereo(double timestamp, cv::Mat &img_leftin, cv::Mat &img_r
     std::vector<cv::KeyPoint> pts_right_new = pts_last[cam_id_right];
 
     // Lets track temporally
-    boost::thread t_ll = boost::thread(&TrackKLT::perform_matching, this, boost::cref(img_pyramid_last[cam_id_left]), boost::cref(imgpyr_left),
-                                       boost::ref(pts_last[cam_id_left]), boost::ref(pts_left_new), cam_id_left, cam_id_left, boost::ref(mask_ll));
-    boost::thread t_rr = boost::thread(&TrackKLT::perform_matching, this, boost::cref(img_pyramid_last[cam_id_right]), boost::cref(imgpyr_right),
-                                       boost::ref(pts_last[cam_id_right]), boost::ref(pts_right_new), cam_id_right, cam_id_right, boost::ref(mask_rr));
-
-    // Wait till both threads finish
-    t_ll.join();
-    t_rr.join();
+    std::future<void> t_ll = ThreadPool::instance()->enqueue([&]{
+        perform_matching(img_pyramid_last[cam_id_left], imgpyr_left, pts_last[cam_id_left], pts_left_new, cam_id_left, cam_id_left, mask_ll);
+    });
+    std::future<void> t_rr = ThreadPool::instance()->enqueue([&]{
+        perform_matching(img_pyramid_last[cam_id_right], imgpyr_right, pts_last[cam_id_right], pts_right_new, cam_id_right, cam_id_right, mask_rr);
+    });
+
+    // Wait till both tasks finish
+    t_ll.get();
+    t_rr.get();
     rT4 =  boost::posix_time::microsec_clock::local_time();
 
 
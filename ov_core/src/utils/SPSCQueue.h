@@ -0,0 +1,154 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_SPSC_QUEUE_H
+#define OV_CORE_SPSC_QUEUE_H
+
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+namespace ov_core {
+
+
+    /**
+     * @brief Bounded lock-free queue for a single producer and a single consumer thread.
+     *
+     * This is used to hand sensor measurements from the ROS callbacks to the estimator thread without either side ever blocking.
+     * The producer only writes the tail index and the consumer only writes the head index, thus no locks are needed.
+     * All slots are allocated on construction, so pushing a measurement does not allocate (beyond what copying the element needs).
+     * If the queue is full the new element is rejected and counted as dropped, so a slow consumer can never stall the producer.
+     *
+     * Only push() may be called from the producer thread, while front(), pop() may only be called from the consumer thread.
+     * The size() and dropped() counters can be read from any thread.
+     */
+    template<typename T>
+    class SPSCQueue {
+
+    public:
+
+        /**
+         * @brief Default constructor
+         * @param capacity Max number of elements in the queue (will be rounded up to a power of two)
+         */
+        explicit SPSCQueue(size_t capacity) : head(0), tail(0), num_dropped(0) {
+            size_t size = 1;
+            while(size < capacity)
+                size *= 2;
+            buffer.resize(size);
+            mask = size-1;
+        }
+
+        /**
+         * @brief Appends an element to the queue (producer thread only)
+         * @param value Element we want to push
+         * @return False if the queue was full and the element was dropped
+         */
+        bool push(const T &value) {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if(t-head.load(std::memory_order_acquire) >= buffer.size()) {
+                num_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            buffer[t & mask] = value;
+            tail.store(t+1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Gets the oldest element without removing it (consumer thread only)
+         * @return Pointer to the element, or nullptr if the queue is empty
+         */
+        T *front() {
+            const size_t h = head.load(std::memory_order_relaxed);
+            if(h == tail.load(std::memory_order_acquire))
+                return nullptr;
+            return &buffer[h & mask];
+        }
+
+        /**
+         * @brief Removes the oldest element (consumer thread only)
+         * @param value Will be set to the removed element
+         * @return False if the queue was empty
+         */
+        bool pop(T &value) {
+            T *elem = front();
+            if(elem == nullptr)
+                return false;
+            value = std::move(*elem);
+            head.store(head.load(std::memory_order_relaxed)+1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest element and discards it (consumer thread only)
+         * @return False if the queue was empty
+         */
+        bool pop() {
+            T *elem = front();
+            if(elem == nullptr)
+                return false;
+            *elem = T();
+            head.store(head.load(std::memory_order_relaxed)+1, std::memory_order_release);
+            return true;
+        }
+
+        /// Current number of elements in the queue
+        size_t size() const {
+            const size_t h = head.load(std::memory_order_acquire);
+            return tail.load(std::memory_order_acquire)-h;
+        }
+
+        /// Max number of elements the queue can hold
+        size_t capacity() const {
+            return buffer.size();
+        }
+
+        /// Total number of elements which have been dropped since the queue was full
+        size_t dropped() const {
+            return num_dropped.load(std::memory_order_relaxed);
+        }
+
+    protected:
+
+        /// Storage for all our elements
+        std::vector<T> buffer;
+
+        /// Mask to convert an index into a slot in the buffer
+        size_t mask;
+
+        /// Index of the next element to be popped (only written by the consumer)
+        alignas(64) std::atomic<size_t> head;
+
+        /// Index of the next element to be pushed (only written by the producer)
+        alignas(64) std::atomic<size_t> tail;
+
+        /// Number of dropped elements
+        alignas(64) std::atomic<size_t> num_dropped;
+
+    };
+
+
+}
+
+#endif //OV_CORE_SPSC_QUEUE_H
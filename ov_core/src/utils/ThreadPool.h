@@ -0,0 +1,203 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_THREAD_POOL_H
+#define OV_CORE_THREAD_POOL_H
+
+
+#include <queue>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <future>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "colors.h"
+
+
+namespace ov_core {
+
+
+    /**
+     * @brief Persistent pool of worker threads shared between the trackers and estimator.
+     *
+     * Spawning threads for each image at camera rate has a noticeable cost on embedded platforms.
+     * Instead all stages submit their work to this single long-lived pool and wait on the returned future.
+     * The pool is a process wide singleton which should be configured once before any work is submitted (e.g. by the VioManager).
+     * It is handed out as a shared pointer, so a caller which is still using the old pool when it is reconfigured keeps it alive.
+     * If the pool is configured with zero threads, all submitted tasks are run inline on the calling thread.
+     *
+     * Note that a task should not itself block on a task submitted to the same pool, since with a small pool this can deadlock.
+     * Thus only the top level stages (e.g. per-camera feeds or the per-image stereo steps) should submit work.
+     */
+    class ThreadPool {
+
+    public:
+
+        /**
+         * @brief Gets the global thread pool, will create it with the default size if not configured
+         * @return Pointer to the pool
+         */
+        static std::shared_ptr<ThreadPool> instance() {
+            std::lock_guard<std::mutex> lck(mtx_instance());
+            if(pool() == nullptr) {
+                pool().reset(new ThreadPool(default_size(), false));
+            }
+            return pool();
+        }
+
+        /**
+         * @brief Will (re)create the global pool with the given size
+         *
+         * Should be called before any work is submitted.
+         * The old pool will finish its queued tasks and join its workers once the last user of it has released it.
+         *
+         * @param num_threads Number of workers (negative will use the hardware concurrency)
+         * @param pin_threads If each worker should be pinned to a single core (linux only)
+         */
+        static void configure(int num_threads, bool pin_threads) {
+            std::lock_guard<std::mutex> lck(mtx_instance());
+            pool().reset(new ThreadPool((num_threads<0)? default_size() : (size_t)num_threads, pin_threads));
+        }
+
+        /**
+         * @brief Submit a task to be run by one of the workers
+         * @param task Function which will be called with no arguments
+         * @return Future which will be ready once the task has been run
+         */
+        std::future<void> enqueue(std::function<void()> task) {
+            auto ptask = std::make_shared<std::packaged_task<void()>>(task);
+            std::future<void> result = ptask->get_future();
+            if(workers.empty()) {
+                (*ptask)();
+                return result;
+            }
+            {
+                std::lock_guard<std::mutex> lck(mtx_tasks);
+                tasks.emplace([ptask]() { (*ptask)(); });
+            }
+            cv_tasks.notify_one();
+            return result;
+        }
+
+        /// Number of worker threads this pool has
+        size_t size() const {
+            return workers.size();
+        }
+
+        /// Destructor, will finish all queued tasks and join the workers
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lck(mtx_tasks);
+                stop = true;
+            }
+            cv_tasks.notify_all();
+            for(std::thread &worker : workers) {
+                worker.join();
+            }
+        }
+
+
+    private:
+
+        /**
+         * @brief Creates our workers, which will wait for tasks until we are destroyed
+         * @param num_threads Number of workers
+         * @param pin_threads If each worker should be pinned to a single core
+         */
+        ThreadPool(size_t num_threads, bool pin_threads) {
+            for(size_t i=0; i<num_threads; i++) {
+                workers.emplace_back([this]() { worker_loop(); });
+#if defined(__linux__)
+                if(pin_threads) {
+                    cpu_set_t cpuset;
+                    CPU_ZERO(&cpuset);
+                    CPU_SET(i % std::max(1u, std::thread::hardware_concurrency()), &cpuset);
+                    if(pthread_setaffinity_np(workers.back().native_handle(), sizeof(cpu_set_t), &cpuset) != 0) {
+                        printf(YELLOW "[THREADPOOL]: unable to pin worker %d to a core\n" RESET, (int)i);
+                    }
+                }
+#else
+                (void)pin_threads;
+#endif
+            }
+        }
+
+        /// Main loop of each worker, runs tasks until the pool is stopped and the queue is empty
+        void worker_loop() {
+            while(true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lck(mtx_tasks);
+                    cv_tasks.wait(lck, [this]() { return stop || !tasks.empty(); });
+                    if(stop && tasks.empty())
+                        return;
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        }
+
+        /// Default number of workers (all hardware threads)
+        static size_t default_size() {
+            return std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        /// Storage of the global pool
+        static std::shared_ptr<ThreadPool> &pool() {
+            static std::shared_ptr<ThreadPool> ptr;
+            return ptr;
+        }
+
+        /// Mutex for creating or reconfiguring the global pool
+        static std::mutex &mtx_instance() {
+            static std::mutex mtx;
+            return mtx;
+        }
+
+        /// Our worker threads
+        std::vector<std::thread> workers;
+
+        /// Queue of tasks waiting for a worker
+        std::queue<std::function<void()>> tasks;
+
+        /// Mutex protecting the task queue and stop flag
+        std::mutex mtx_tasks;
+
+        /// Condition used to wake workers when there is a new task
+        std::condition_variable cv_tasks;
+
+        /// If we are shutting down
+        bool stop = false;
+
+    };
+
+
+}
+
+#endif /* OV_CORE_THREAD_POOL_H */
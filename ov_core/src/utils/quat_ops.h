@@ -66,6 +66,7 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <type_traits>
 #include <Eigen/Eigen>
 
 
@@ -167,7 +168,7 @@ namespace ov_core {
      */
     inline Eigen::Matrix<double, 3, 3> quat_2_Rot(const Eigen::Matrix<double, 4, 1> &q) {
         Eigen::Matrix<double, 3, 3> q_x = skew_x(q.block(0, 0, 3, 1));
-        Eigen::MatrixXd Rot = (2 * std::pow(q(3, 0), 2) - 1) * Eigen::MatrixXd::Identity(3, 3)
+        Eigen::Matrix<double, 3, 3> Rot = (2 * std::pow(q(3, 0), 2) - 1) * Eigen::Matrix<double, 3, 3>::Identity()
                               - 2 * q(3, 0) * q_x +
                               2 * q.block(0, 0, 3, 1) * (q.block(0, 0, 3, 1).transpose());
         return Rot;
@@ -199,7 +200,7 @@ namespace ov_core {
         Eigen::Matrix<double, 4, 1> q_t;
         Eigen::Matrix<double, 4, 4> Qm;
         // create big L matrix
-        Qm.block(0, 0, 3, 3) = q(3, 0) * Eigen::MatrixXd::Identity(3, 3) - skew_x(q.block(0, 0, 3, 1));
+        Qm.block(0, 0, 3, 3) = q(3, 0) * Eigen::Matrix<double, 3, 3>::Identity() - skew_x(q.block(0, 0, 3, 1));
         Qm.block(0, 3, 3, 1) = q.block(0, 0, 3, 1);
         Qm.block(3, 0, 1, 3) = -q.block(0, 0, 3, 1).transpose();
         Qm(3, 3) = q(3, 0);
@@ -264,9 +265,9 @@ namespace ov_core {
         // compute so(3) rotation
         Eigen::Matrix<double, 3, 3> R;
         if (theta == 0) {
-            R = Eigen::MatrixXd::Identity(3, 3);
+            R = Eigen::Matrix<double, 3, 3>::Identity();
         } else {
-            R = Eigen::MatrixXd::Identity(3, 3) + A*w_x + B*w_x*w_x;
+            R = Eigen::Matrix<double, 3, 3>::Identity() + A*w_x + B*w_x*w_x;
         }
         return R;
     }
@@ -299,7 +300,7 @@ namespace ov_core {
         // calculate the skew symetric matrix
         Eigen::Matrix<double, 3, 3> w_x = D*(R-R.transpose());
         // check if we are near the identity
-        if (R != Eigen::MatrixXd::Identity(3, 3)) {
+        if (R != Eigen::Matrix<double, 3, 3>::Identity()) {
             Eigen::Vector3d vec;
             vec << w_x(2, 1), w_x(0, 2), w_x(1, 0);
             return vec;
@@ -328,7 +329,7 @@ namespace ov_core {
      * @param vec 6x1 in the se(3) space [omega, u]
      * @return 4x4 SE(3) matrix
      */
-    inline Eigen::Matrix4d exp_se3(Eigen::Matrix<double,6,1> vec) {
+    inline Eigen::Matrix4d exp_se3(const Eigen::Matrix<double,6,1> &vec) {
 
         // Precompute our values
         Eigen::Vector3d w = vec.head(3);
@@ -380,7 +381,7 @@ namespace ov_core {
      * @param mat 4x4 SE(3) matrix
      * @return 6x1 in the se(3) space [omega, u]
      */
-    inline Eigen::Matrix<double,6,1> log_se3(Eigen::Matrix4d mat) {
+    inline Eigen::Matrix<double,6,1> log_se3(const Eigen::Matrix4d &mat) {
 
         // Get sub-matrices
         Eigen::Matrix3d R = mat.block(0,0,3,3);
@@ -466,7 +467,7 @@ namespace ov_core {
      * @param[in] q quaternion we want to change
      * @return inversed quaternion
      */
-    inline Eigen::Matrix<double, 4, 1> Inv(Eigen::Matrix<double, 4, 1> q) {
+    inline Eigen::Matrix<double, 4, 1> Inv(const Eigen::Matrix<double, 4, 1> &q) {
         Eigen::Matrix<double, 4, 1> qinv;
         qinv.block(0, 0, 3, 1) = -q.block(0, 0, 3, 1);
         qinv(3, 0) = q(3, 0);
@@ -479,7 +480,7 @@ namespace ov_core {
      * See equation (48) of trawny tech report [Indirect Kalman Filter for 3D Attitude Estimation](http://mars.cs.umn.edu/tr/reports/Trawny05b.pdf).
      *
      */
-    inline Eigen::Matrix<double, 4, 4> Omega(Eigen::Matrix<double, 3, 1> w) {
+    inline Eigen::Matrix<double, 4, 4> Omega(const Eigen::Matrix<double, 3, 1> &w) {
         Eigen::Matrix<double, 4, 4> mat;
         mat.block(0, 0, 3, 3) = -skew_x(w);
         mat.block(3, 0, 1, 3) = -w.transpose();
@@ -493,9 +494,9 @@ namespace ov_core {
      * @param q_t Quaternion to normalized
      * @return Normalized quaterion
      */
-    inline Eigen::Matrix<double, 4, 1> quatnorm(Eigen::Matrix<double, 4, 1> q_t) {
+    inline Eigen::Matrix<double, 4, 1> quatnorm(const Eigen::Matrix<double, 4, 1> &q_t) {
         if (q_t(3, 0) < 0) {
-            q_t *= -1;
+            return -q_t / q_t.norm();
         }
         return q_t / q_t.norm();
     }
@@ -512,13 +513,13 @@ namespace ov_core {
      * @param w axis-angle
      * @return The left Jacobian of SO(3)
      */
-    inline Eigen::Matrix<double, 3, 3> Jl_so3(Eigen::Matrix<double, 3, 1> w) {
+    inline Eigen::Matrix<double, 3, 3> Jl_so3(const Eigen::Matrix<double, 3, 1> &w) {
         double theta = w.norm();
         if (theta < 1e-12) {
-            return Eigen::MatrixXd::Identity(3, 3);
+            return Eigen::Matrix<double, 3, 3>::Identity();
         } else {
             Eigen::Matrix<double, 3, 1> a = w / theta;
-            Eigen::Matrix<double, 3, 3> J = sin(theta) / theta * Eigen::MatrixXd::Identity(3, 3) +
+            Eigen::Matrix<double, 3, 3> J = sin(theta) / theta * Eigen::Matrix<double, 3, 3>::Identity() +
                                             (1 - sin(theta) / theta) * a * a.transpose() +
                                             ((1 - cos(theta)) / theta) * skew_x(a);
             return J;
@@ -536,11 +537,182 @@ namespace ov_core {
      * @param w axis-angle
      * @return The right Jacobian of SO(3)
      */
-    inline Eigen::Matrix<double, 3, 3> Jr_so3(Eigen::Matrix<double, 3, 1> w) {
+    inline Eigen::Matrix<double, 3, 3> Jr_so3(const Eigen::Matrix<double, 3, 1> &w) {
         return Jl_so3(-w);
     }
 
 
+    //==========================================================================
+    // BATCHED OPERATIONS
+    //==========================================================================
+
+    /**
+     * @brief Batch of 3x1 vectors stored as structure of arrays
+     *
+     * Each column is a single vector, but the storage is row major so that all x, all y and all z values are contiguous.
+     * This allows for the batched functions below to operate on whole rows at a time which the compiler can vectorize.
+     */
+    typedef Eigen::Matrix<double, 3, Eigen::Dynamic, Eigen::RowMajor> Vec3Batch;
+
+    /**
+     * @brief Batch of JPL quaternions stored as structure of arrays
+     *
+     * Each column is a single quaternion [q_1,q_2,q_3,q_4], with each of the four elements being contiguous.
+     */
+    typedef Eigen::Matrix<double, 4, Eigen::Dynamic, Eigen::RowMajor> QuatBatch;
+
+    /**
+     * @brief Batch of 3x3 matrices stored as structure of arrays
+     *
+     * Each column is a single matrix, where row 3*i+j holds the (i,j) element of each matrix.
+     * Use mat3_from_batch() to get a single column as a 3x3 matrix.
+     */
+    typedef Eigen::Matrix<double, 9, Eigen::Dynamic, Eigen::RowMajor> Mat3Batch;
+
+
+    /**
+     * @brief Contiguous array view of a single row of a batch (i.e. all x values)
+     *
+     * This is used internally by the batched functions so that each element-wise expression works directly on the batch memory.
+     */
+    template<typename BatchType>
+    struct BatchRows : public Eigen::Map<typename std::conditional<std::is_const<BatchType>::value, const Eigen::ArrayXd, Eigen::ArrayXd>::type> {
+        typedef Eigen::Map<typename std::conditional<std::is_const<BatchType>::value, const Eigen::ArrayXd, Eigen::ArrayXd>::type> Base;
+        BatchRows(BatchType &batch, int row) : Base(batch.row(row).data(), batch.cols()) {}
+        using Base::operator=;
+    };
+
+
+    /**
+     * @brief Gets a single 3x3 matrix from a batch
+     * @param[in] batch Batch of 3x3 matrices
+     * @param[in] i Index of the matrix we want
+     * @return 3x3 matrix
+     */
+    inline Eigen::Matrix<double, 3, 3> mat3_from_batch(const Mat3Batch &batch, int i) {
+        Eigen::Matrix<double, 3, 3> mat;
+        mat << batch(0, i), batch(1, i), batch(2, i),
+                batch(3, i), batch(4, i), batch(5, i),
+                batch(6, i), batch(7, i), batch(8, i);
+        return mat;
+    }
+
+
+    /**
+     * @brief Batched version of quat_2_Rot()
+     *
+     * Each element is expanded from the quaternion directly:
+     * \f{align*}{
+     *  \mathbf{R} = (2q_4^2-1)\mathbf{I}_3-2q_4\lfloor\mathbf{q}\times\rfloor+2\mathbf{q}^\top\mathbf{q}
+     * @f}
+     *
+     * @param[in] q Batch of JPL quaternions
+     * @param[out] R Batch of SO(3) rotation matrices
+     */
+    inline void quat_2_Rot_batch(const QuatBatch &q, Mat3Batch &R) {
+        R.resize(9, q.cols());
+        BatchRows<const QuatBatch> q1(q, 0), q2(q, 1), q3(q, 2), q4(q, 3);
+        BatchRows<Mat3Batch> R00(R, 0), R01(R, 1), R02(R, 2), R10(R, 3), R11(R, 4), R12(R, 5), R20(R, 6), R21(R, 7), R22(R, 8);
+        R00 = 2 * q4 * q4 - 1 + 2 * q1 * q1;
+        R01 = 2 * q4 * q3 + 2 * q1 * q2;
+        R02 = -2 * q4 * q2 + 2 * q1 * q3;
+        R10 = -2 * q4 * q3 + 2 * q1 * q2;
+        R11 = 2 * q4 * q4 - 1 + 2 * q2 * q2;
+        R12 = 2 * q4 * q1 + 2 * q2 * q3;
+        R20 = 2 * q4 * q2 + 2 * q1 * q3;
+        R21 = -2 * q4 * q1 + 2 * q2 * q3;
+        R22 = 2 * q4 * q4 - 1 + 2 * q3 * q3;
+    }
+
+
+    /**
+     * @brief Batched version of exp_so3()
+     *
+     * Using that \f$\lfloor\mathbf{v}\times\rfloor^2 = \mathbf{v}\mathbf{v}^\top-\theta^2\mathbf{I}\f$ each element is:
+     * \f{align*}{
+     * \exp(\mathbf{v}) &=
+     * \mathbf{I}
+     * +\frac{\sin{\theta}}{\theta}\lfloor\mathbf{v}\times\rfloor
+     * +\frac{1-\cos{\theta}}{\theta^2}(\mathbf{v}\mathbf{v}^\top-\theta^2\mathbf{I})
+     * @f}
+     *
+     * @param[in] w Batch of 3x1 vectors we will take the exponential of
+     * @param[out] R Batch of SO(3) rotation matrices
+     */
+    inline void exp_so3_batch(const Vec3Batch &w, Mat3Batch &R) {
+        R.resize(9, w.cols());
+        BatchRows<const Vec3Batch> x(w, 0), y(w, 1), z(w, 2);
+        BatchRows<Mat3Batch> R00(R, 0), R01(R, 1), R02(R, 2), R10(R, 3), R11(R, 4), R12(R, 5), R20(R, 6), R21(R, 7), R22(R, 8);
+        Eigen::ArrayXd theta2 = x * x + y * y + z * z;
+        // Handle small angle values (only the trig is done per element)
+        Eigen::ArrayXd A(w.cols()), B(w.cols());
+        for (int i = 0; i < (int)w.cols(); i++) {
+            double theta = std::sqrt(theta2(i));
+            A(i) = (theta < 1e-12) ? 1 : sin(theta) / theta;
+            B(i) = (theta < 1e-12) ? 0.5 : (1 - cos(theta)) / theta2(i);
+        }
+        R00 = 1 + B * (x * x - theta2);
+        R01 = -A * z + B * x * y;
+        R02 = A * y + B * x * z;
+        R10 = A * z + B * x * y;
+        R11 = 1 + B * (y * y - theta2);
+        R12 = -A * x + B * y * z;
+        R20 = -A * y + B * x * z;
+        R21 = A * x + B * y * z;
+        R22 = 1 + B * (z * z - theta2);
+    }
+
+
+    /**
+     * @brief Batched version of Jl_so3()
+     *
+     * Each element is expanded as:
+     * \f{align*}{
+     * J_l(\boldsymbol\theta) = \frac{\sin\theta}{\theta}\mathbf I + \frac{1}{\theta^2}\Big(1-\frac{\sin\theta}{\theta}\Big)\boldsymbol\theta \boldsymbol\theta^\top + \frac{1-\cos\theta}{\theta^2}\lfloor \boldsymbol\theta \times\rfloor
+     * \f}
+     *
+     * @param[in] w Batch of axis-angles
+     * @param[out] J Batch of left Jacobians of SO(3)
+     */
+    inline void Jl_so3_batch(const Vec3Batch &w, Mat3Batch &J) {
+        J.resize(9, w.cols());
+        BatchRows<const Vec3Batch> x(w, 0), y(w, 1), z(w, 2);
+        BatchRows<Mat3Batch> J00(J, 0), J01(J, 1), J02(J, 2), J10(J, 3), J11(J, 4), J12(J, 5), J20(J, 6), J21(J, 7), J22(J, 8);
+        Eigen::ArrayXd theta2 = x * x + y * y + z * z;
+        // Handle small angle values, these are the identity (only the trig is done per element)
+        Eigen::ArrayXd A(w.cols()), B(w.cols()), C(w.cols());
+        for (int i = 0; i < (int)w.cols(); i++) {
+            double theta = std::sqrt(theta2(i));
+            A(i) = (theta < 1e-12) ? 1 : sin(theta) / theta;
+            B(i) = (theta < 1e-12) ? 0 : (1 - A(i)) / theta2(i);
+            C(i) = (theta < 1e-12) ? 0 : (1 - cos(theta)) / theta2(i);
+        }
+        J00 = A + B * x * x;
+        J01 = B * x * y - C * z;
+        J02 = B * x * z + C * y;
+        J10 = B * x * y + C * z;
+        J11 = A + B * y * y;
+        J12 = B * y * z - C * x;
+        J20 = B * x * z - C * y;
+        J21 = B * y * z + C * x;
+        J22 = A + B * z * z;
+    }
+
+
+    /**
+     * @brief Batched version of Jr_so3()
+     *
+     * The right Jacobian of SO(3) is related to the left by Jl(-w)=Jr(w).
+     *
+     * @param[in] w Batch of axis-angles
+     * @param[out] J Batch of right Jacobians of SO(3)
+     */
+    inline void Jr_so3_batch(const Vec3Batch &w, Mat3Batch &J) {
+        Vec3Batch w_neg = -w;
+        Jl_so3_batch(w_neg, J);
+    }
+
+
 }
 
 
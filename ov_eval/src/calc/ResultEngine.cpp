@@ -0,0 +1,115 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ResultEngine.h"
+
+
+using namespace ov_eval;
+
+
+
+
+size_t ResultEngine::add_job(const std::string &path_est, const std::string &path_gt) {
+
+    // Only evaluate each unique run once
+    auto key = std::make_pair(path_est, path_gt);
+    if(_run_lookup.find(key) == _run_lookup.end()) {
+        RunResult result;
+        result.path_est = path_est;
+        result.path_gt = path_gt;
+        _run_lookup.insert({key, _results.size()});
+        _results.push_back(result);
+    }
+
+    // Record which run this job uses
+    _job_to_result.push_back(_run_lookup.at(key));
+    return _job_to_result.size()-1;
+
+}
+
+
+
+
+void ResultEngine::run() {
+
+    // Return if nothing to do
+    if(_num_computed >= _results.size())
+        return;
+
+    // Number of threads we will use
+    size_t num_jobs = _results.size()-_num_computed;
+    size_t num_threads = (_num_threads > 0)? (size_t)_num_threads : std::max((unsigned int)1, boost::thread::hardware_concurrency());
+    size_t num_threads_runs = std::min(num_threads, num_jobs);
+    printf("[ENGINE]: evaluating %d runs with %d threads\n",(int)num_jobs,(int)num_threads_runs);
+
+    // Split our thread budget between the runs and the RPE computation inside of each run
+    // NOTE: this way we never have more than our number of threads running at once
+    _num_threads_rpe = (int)std::max((size_t)1, num_threads/num_threads_runs);
+
+    // Each thread will grab the next run which has not been evaluated
+    // NOTE: each run only writes into its own result, so no locking is needed
+    std::atomic<size_t> next_job(_num_computed);
+    auto worker = [&]() {
+        size_t idx;
+        while((idx = next_job++) < _results.size()) {
+            evaluate(_results.at(idx));
+        }
+    };
+
+    // Start our pool and wait for it to finish
+    boost::thread_group threads;
+    for(size_t i=1; i<num_threads_runs; i++) {
+        threads.create_thread(worker);
+    }
+    worker();
+    threads.join_all();
+    _num_computed = _results.size();
+
+}
+
+
+
+
+void ResultEngine::evaluate(RunResult &result) {
+
+    // Create our trajectory object (this will associate and align it)
+    ResultTrajectory traj(result.path_est, result.path_gt, _alignment_method);
+
+    // Calculate ATE error for this run
+    if(_do_ate) {
+        traj.calculate_ate(result.ate_ori, result.ate_pos);
+    }
+
+    // Calculate ATE 2D error for this run
+    if(_do_ate_2d) {
+        traj.calculate_ate_2d(result.ate_2d_ori, result.ate_2d_pos);
+    }
+
+    // NEES error for this run
+    if(_do_nees) {
+        traj.calculate_nees(result.nees_ori, result.nees_pos);
+    }
+
+    // Calculate RPE error for this run
+    if(_do_rpe) {
+        traj.calculate_rpe(_segments, result.rpe, _num_threads_rpe);
+    }
+
+}
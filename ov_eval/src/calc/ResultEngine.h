@@ -0,0 +1,164 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_ENGINE_H
+#define OV_EVAL_ENGINE_H
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include "calc/ResultTrajectory.h"
+#include "utils/Statistics.h"
+#include "utils/Colors.h"
+
+
+namespace ov_eval {
+
+
+
+    /**
+     * @brief Evaluates many runs in parallel.
+     *
+     * Each job is a single estimated trajectory file and its groundtruth.
+     * Jobs are first all queued with add_job(), and then computed on a pool of threads with run().
+     * For each job the trajectory is associated and aligned once, and all the requested errors are computed from that alignment.
+     * If the same run is queued more than once, it is only evaluated once and the results are shared.
+     * The results are stored in the order the jobs were added, thus the caller can merge them in a deterministic order independent of scheduling.
+     */
+    class ResultEngine {
+
+    public:
+
+        /**
+         * @brief Results for a single run
+         */
+        struct RunResult {
+
+            /// Path to the estimate text file
+            std::string path_est;
+
+            /// Path to the groundtruth text file
+            std::string path_gt;
+
+            /// Absolute trajectory error (orientation and position)
+            Statistics ate_ori, ate_pos;
+
+            /// Absolute trajectory error in the x-y plane (yaw and position)
+            Statistics ate_2d_ori, ate_2d_pos;
+
+            /// Normalized estimation error squared (orientation and position)
+            Statistics nees_ori, nees_pos;
+
+            /// Relative pose error for each segment length (orientation and position)
+            std::map<double,std::pair<Statistics,Statistics>> rpe;
+
+        };
+
+
+        /**
+         * @brief Default constructor
+         * @param alignment_method The alignment method used to align the trajectories (see AlignTrajectory)
+         * @param segments Segment lengths we want to calculate the relative pose error for
+         * @param num_threads Number of threads to evaluate with (-1 will use the number of cores)
+         */
+        ResultEngine(std::string alignment_method, std::vector<double> segments, int num_threads = -1) :
+                _alignment_method(alignment_method), _segments(segments), _num_threads(num_threads) {}
+
+        /**
+         * @brief Selects which errors should be computed for each run (all by default)
+         * @param ate If we should compute the absolute trajectory error
+         * @param ate_2d If we should compute the 2d absolute trajectory error
+         * @param nees If we should compute the normalized estimation error squared
+         * @param rpe If we should compute the relative pose error
+         */
+        void set_errors(bool ate, bool ate_2d, bool nees, bool rpe) {
+            _do_ate = ate;
+            _do_ate_2d = ate_2d;
+            _do_nees = nees;
+            _do_rpe = rpe;
+        }
+
+        /**
+         * @brief Queues a run to be evaluated
+         * @param path_est Path to the estimate text file
+         * @param path_gt Path to the groundtruth text file
+         * @return Index of this job to get its results with get_result()
+         */
+        size_t add_job(const std::string &path_est, const std::string &path_gt);
+
+        /**
+         * @brief Evaluates all queued jobs which have not been computed yet, will block till finished
+         */
+        void run();
+
+        /**
+         * @brief Gets the results of a job
+         * @param job_id Index returned by add_job()
+         * @return Errors of this run
+         */
+        const RunResult &get_result(size_t job_id) {
+            return _results.at(_job_to_result.at(job_id));
+        }
+
+
+    protected:
+
+        /// Will evaluate a single run
+        void evaluate(RunResult &result);
+
+        /// Alignment method we will use
+        std::string _alignment_method;
+
+        /// Segment lengths for the relative pose error
+        std::vector<double> _segments;
+
+        /// Number of threads we will use
+        int _num_threads;
+
+        /// Number of threads each run can use to compute its RPE (set in run())
+        int _num_threads_rpe = 1;
+
+        /// What errors we should compute
+        bool _do_ate = true;
+        bool _do_ate_2d = true;
+        bool _do_nees = true;
+        bool _do_rpe = true;
+
+        /// Unique runs we will evaluate, and how many of them have already been computed
+        std::vector<RunResult> _results;
+        size_t _num_computed = 0;
+
+        /// Maps each job to its unique run
+        std::vector<size_t> _job_to_result;
+
+        /// Lookup of unique runs (estimate and groundtruth path) to their index
+        std::map<std::pair<std::string,std::string>,size_t> _run_lookup;
+
+    };
+
+
+}
+
+
+#endif //OV_EVAL_ENGINE_H
@@ -142,7 +142,7 @@ void ResultTrajectory::calculate_ate_2d(Statistics &error_ori, Statistics &error
 
 
 
-void ResultTrajectory::calculate_rpe(const std::vector<double> &segment_lengths, std::map<double,std::pair<Statistics,Statistics>> &error_rpe) {
+void ResultTrajectory::calculate_rpe(const std::vector<double> &segment_lengths, std::map<double,std::pair<Statistics,Statistics>> &error_rpe, int num_threads) {
 
     // Distance at each point along the trajectory
     std::vector<double> accum_distances(gt_poses.size());
@@ -151,73 +151,80 @@ void ResultTrajectory::calculate_rpe(const std::vector<double> &segment_lengths,
         accum_distances[i] = accum_distances[i - 1] + (gt_poses[i].block(0,0,3,1) - gt_poses[i - 1].block(0,0,3,1)).norm();
     }
 
+    // Get T I to world for both EST and GT at every pose, so we only do this once for all segments
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> T_c(est_poses_aignedtoGT.size());
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> T_m(gt_poses.size());
+    for (size_t i = 0; i < T_c.size(); i++) {
+        T_c[i] = Eigen::Matrix4d::Identity();
+        T_c[i].block(0, 0, 3, 3) = Math::quat_2_Rot(est_poses_aignedtoGT.at(i).block(3,0,4,1)).transpose();
+        T_c[i].block(0, 3, 3, 1) = est_poses_aignedtoGT.at(i).block(0,0,3,1);
+    }
+    for (size_t i = 0; i < T_m.size(); i++) {
+        T_m[i] = Eigen::Matrix4d::Identity();
+        T_m[i].block(0, 0, 3, 3) = Math::quat_2_Rot(gt_poses.at(i).block(3,0,4,1)).transpose();
+        T_m[i].block(0, 3, 3, 1) = gt_poses.at(i).block(0,0,3,1);
+    }
+
+    // Number of threads we will split our segments over
+    if(num_threads < 1)
+        num_threads = (int)std::max((unsigned int)1, boost::thread::hardware_concurrency());
+
     // Loop through each segment length
     for(const double &distance : segment_lengths) {
 
-        // Our stats for this length
-        Statistics error_ori, error_pos;
-
         // Get end of subtrajectories for each possible starting point
         std::vector<size_t> comparisons = compute_comparison_indices_length(accum_distances, distance, 0.4*distance);
 
-        // Loop through each relative comparison
-        for (size_t id_start = 0; id_start < comparisons.size(); id_start++) {
-
-            // Get the end id
-            size_t id_end = comparisons[id_start];
-
-            //===============================================================================
-            // Get T I1 to world EST at beginning of subtrajectory (at state idx)
-            Eigen::Matrix4d T_c1 = Eigen::Matrix4d::Identity();
-            T_c1.block(0, 0, 3, 3) = Math::quat_2_Rot(est_poses_aignedtoGT.at(id_start).block(3,0,4,1)).transpose();
-            T_c1.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_start).block(0,0,3,1);
+        // Errors for each relative comparison
+        // NOTE: each thread writes into its own range so the order is the same as a serial loop
+        std::vector<double> values_ori(comparisons.size()), values_pos(comparisons.size());
+        auto compute_errors = [&](size_t id_from, size_t id_to) {
+            for (size_t id_start = id_from; id_start < id_to; id_start++) {
 
-            // Get T I2 to world EST at end of subtrajectory starting (at state comparisons[idx])
-            Eigen::Matrix4d T_c2 = Eigen::Matrix4d::Identity();
-            T_c2.block(0, 0, 3, 3) = Math::quat_2_Rot(est_poses_aignedtoGT.at(id_end).block(3,0,4,1)).transpose();
-            T_c2.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_end).block(0,0,3,1);
+                // Get the end id
+                size_t id_end = comparisons[id_start];
 
-            // Get T I2 to I1 EST
-            Eigen::Matrix4d T_c1_c2 = T_c1.inverse() * T_c2;
+                // Get T I2 to I1 for EST and GT
+                Eigen::Matrix4d T_c1_c2 = T_c[id_start].inverse() * T_c[id_end];
+                Eigen::Matrix4d T_m1_m2 = T_m[id_start].inverse() * T_m[id_end];
 
-            //===============================================================================
-            // Get T I1 to world GT at beginning of subtrajectory (at state idx)
-            Eigen::Matrix4d T_m1 = Eigen::Matrix4d::Identity();
-            T_m1.block(0, 0, 3, 3) = Math::quat_2_Rot(gt_poses.at(id_start).block(3,0,4,1)).transpose();
-            T_m1.block(0, 3, 3, 1) = gt_poses.at(id_start).block(0,0,3,1);
+                // Compute error transform between EST and GT start-end transform
+                Eigen::Matrix4d T_error_in_c2 = T_m1_m2.inverse() * T_c1_c2;
 
-            // Get T I2 to world GT at end of subtrajectory starting (at state comparisons[idx])
-            Eigen::Matrix4d T_m2 = Eigen::Matrix4d::Identity();
-            T_m2.block(0, 0, 3, 3) = Math::quat_2_Rot(gt_poses.at(id_end).block(3,0,4,1)).transpose();
-            T_m2.block(0, 3, 3, 1) = gt_poses.at(id_end).block(0,0,3,1);
+                Eigen::Matrix4d T_c2_rot = Eigen::Matrix4d::Identity();
+                T_c2_rot.block(0, 0, 3, 3) = T_c[id_end].block(0, 0, 3, 3);
 
-            // Get T I2 to I1 GT
-            Eigen::Matrix4d T_m1_m2 = T_m1.inverse() * T_m2;
+                Eigen::Matrix4d T_c2_rot_inv = Eigen::Matrix4d::Identity();
+                T_c2_rot_inv.block(0, 0, 3, 3) = T_c[id_end].block(0, 0, 3, 3).transpose();
 
-            //===============================================================================
-            // Compute error transform between EST and GT start-end transform
-            Eigen::Matrix4d T_error_in_c2 = T_m1_m2.inverse() * T_c1_c2;
+                // Rotate rotation so that rotation error is in the global frame (allows us to look at yaw error)
+                Eigen::Matrix4d T_error_in_w = T_c2_rot * T_error_in_c2 * T_c2_rot_inv;
 
-            Eigen::Matrix4d T_c2_rot = Eigen::Matrix4d::Identity();
-            T_c2_rot.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3);
-
-            Eigen::Matrix4d T_c2_rot_inv = Eigen::Matrix4d::Identity();
-            T_c2_rot_inv.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3).transpose();
-
-            // Rotate rotation so that rotation error is in the global frame (allows us to look at yaw error)
-            Eigen::Matrix4d T_error_in_w = T_c2_rot * T_error_in_c2 * T_c2_rot_inv;
-
-            //===============================================================================
-            // Compute error for position
-            error_pos.timestamps.push_back(est_times.at(id_start));
-            error_pos.values.push_back(T_error_in_w.block(0, 3, 3, 1).norm());
-
-            // Calculate orientation error
-            double ori_err = 180.0/M_PI*Math::log_so3(T_error_in_w.block(0, 0, 3, 3)).norm();
-            error_ori.timestamps.push_back(est_times.at(id_start));
-            error_ori.values.push_back(ori_err);
+                // Compute error for position and orientation
+                values_pos[id_start] = T_error_in_w.block(0, 3, 3, 1).norm();
+                values_ori[id_start] = 180.0/M_PI*Math::log_so3(T_error_in_w.block(0, 0, 3, 3)).norm();
 
+            }
+        };
+
+        // Split the segments over our threads (only worth it if we have a lot of them)
+        size_t num_chunks = (comparisons.size() < 1000)? 1 : (size_t)num_threads;
+        size_t chunk_size = (comparisons.size()+num_chunks-1)/num_chunks;
+        boost::thread_group threads;
+        for (size_t c = 1; c < num_chunks; c++) {
+            size_t id_from = std::min(c*chunk_size, comparisons.size());
+            size_t id_to = std::min((c+1)*chunk_size, comparisons.size());
+            threads.create_thread([&compute_errors, id_from, id_to]() { compute_errors(id_from, id_to); });
         }
+        compute_errors(0, std::min(chunk_size, comparisons.size()));
+        threads.join_all();
+
+        // Our stats for this length
+        Statistics error_ori, error_pos;
+        error_ori.timestamps.assign(est_times.begin(), est_times.begin()+comparisons.size());
+        error_ori.values = values_ori;
+        error_pos.timestamps.assign(est_times.begin(), est_times.begin()+comparisons.size());
+        error_pos.values = values_pos;
 
         // Update stat information
         error_ori.calculate();
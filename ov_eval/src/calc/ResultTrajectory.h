@@ -21,6 +21,7 @@
 #ifndef OV_EVAL_TRAJECTORY_H
 #define OV_EVAL_TRAJECTORY_H
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <random>
@@ -29,6 +30,7 @@
 
 #include <Eigen/Eigen>
 #include <Eigen/StdVector>
+#include <boost/thread.hpp>
 
 #include "alignment/AlignTrajectory.h"
 #include "utils/Statistics.h"
@@ -108,10 +110,14 @@ namespace ov_eval {
          * e_{rpe,d_i} &= \frac{1}{D_i} \sum_{k=1}^{D_i} ||\tilde{\mathbf{x}}_{r} \boxminus \hat{\tilde{\mathbf{x}}}_{r}||^2_{2}
          * \f}
          *
+         * The end pose of each segment is found with a binary search over the accumulated distance,
+         * and the errors of all segments are computed in parallel over the starting poses.
+         *
          * @param segment_lengths What segment lengths we want to calculate for
          * @param error_rpe Map of segment lengths => errors for that length (orientation and position)
+         * @param num_threads Number of threads to compute the errors with (-1 will use the number of cores)
          */
-        void calculate_rpe(const std::vector<double> &segment_lengths, std::map<double,std::pair<Statistics,Statistics>> &error_rpe);
+        void calculate_rpe(const std::vector<double> &segment_lengths, std::map<double,std::pair<Statistics,Statistics>> &error_rpe, int num_threads = -1);
 
 
         /**
@@ -175,24 +181,38 @@ namespace ov_eval {
         std::vector<size_t> compute_comparison_indices_length(std::vector<double> &distances, double distance, double max_dist_diff) {
 
             // Our max id and the vector of end ids for our pose indexes
-            int max_idx = distances.size() - 1;
+            // NOTE: the last pose is never used as an end pose
+            int max_idx = (int)distances.size() - 1;
             std::vector<size_t> comparisons;
 
             // Loop through each pose in our trajectory (i.e. our distance vector generated from the trajectory).
-            for (size_t idx = 0; idx < distances.size(); idx++) {
-
-                // Loop through and find the pose that minimized the difference between
-                // The desired trajectory distance and our current trajectory distance
-                double distance_startpose = distances[idx];
+            for (int idx = 0; idx < max_idx; idx++) {
+
+                // Since the distances are monotonic, the pose that minimizes the difference between the desired
+                // and our current trajectory distance is either the first one past it, or the one right before it.
+                // We binary search for these in the poses after our starting pose.
+                double distance_goal = distances[idx] + distance;
+                auto iter_begin = distances.begin() + idx;
+                auto iter_end = distances.begin() + max_idx;
+                auto iter_above = std::lower_bound(iter_begin, iter_end, distance_goal);
                 int best_idx = -1;
                 double best_error = max_dist_diff;
-                for (int i = idx; i < max_idx; i++) {
-                    if (std::abs(distances[i] - (distance_startpose + distance)) < best_error) {
-                        best_idx = i;
-                        best_error = std::abs(distances[i] - (distance_startpose + distance));
+
+                // Check the pose right before (if there are multiple with the same distance we want the first)
+                if (iter_above != iter_begin) {
+                    auto iter_below = std::lower_bound(iter_begin, iter_above, *(iter_above - 1));
+                    if (std::abs(*iter_below - distance_goal) < best_error) {
+                        best_idx = (int)(iter_below - distances.begin());
+                        best_error = std::abs(*iter_below - distance_goal);
                     }
                 }
 
+                // Check the first pose that is past the desired distance
+                if (iter_above != iter_end && std::abs(*iter_above - distance_goal) < best_error) {
+                    best_idx = (int)(iter_above - distances.begin());
+                    best_error = std::abs(*iter_above - distance_goal);
+                }
+
                 // If we have an end id that reached this trajectory distance then add it!
                 // Else we can break since we are at the end of the trajectory and thus won't find any more segments of this length
                 if (best_idx != -1) {
@@ -24,6 +24,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include "calc/ResultEngine.h"
 #include "calc/ResultTrajectory.h"
 #include "utils/Loader.h"
 #include "utils/Colors.h"
@@ -119,12 +120,13 @@ int main(int argc, char **argv) {
 
 
 
-    // Loop through each algorithm type
-    for(size_t i=0; i<path_algorithms.size(); i++) {
+    // Our evaluation engine, we will first queue all runs and then evaluate them in parallel
+    ov_eval::ResultEngine engine(argv[1], segments);
+    engine.set_errors(true, false, false, true);
 
-        // Debug print
-        printf("======================================\n");
-        printf("[COMP]: processing %s algorithm\n", path_algorithms.at(i).stem().c_str());
+    // Get the runs for each algorithm and dataset
+    std::map<std::pair<size_t,size_t>,std::vector<size_t>> run_jobs;
+    for(size_t i=0; i<path_algorithms.size(); i++) {
 
         // Get the list of datasets this algorithm records
         std::map<std::string,boost::filesystem::path> path_algo_datasets;
@@ -143,6 +145,45 @@ int main(int argc, char **argv) {
                 continue;
             }
 
+            // Loop though the different runs for this dataset
+            std::vector<std::string> file_paths;
+            for(auto& entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_groundtruths.at(j).stem().string()))) {
+                if(entry.path().extension() != ".txt")
+                    continue;
+                file_paths.push_back(entry.path().string());
+            }
+            std::sort(file_paths.begin(), file_paths.end());
+
+            // Queue each run in sorted order
+            std::vector<size_t> jobs;
+            for(auto &path_esttxt : file_paths) {
+                jobs.push_back(engine.add_job(path_esttxt, path_groundtruths.at(j).string()));
+            }
+            run_jobs.insert({{i,j},jobs});
+
+        }
+
+    }
+
+    // Evaluate all our runs
+    engine.run();
+
+
+    // Loop through each algorithm type
+    for(size_t i=0; i<path_algorithms.size(); i++) {
+
+        // Debug print
+        printf("======================================\n");
+        printf("[COMP]: processing %s algorithm\n", path_algorithms.at(i).stem().c_str());
+
+        // Loop through our list of groundtruth datasets, and see if we have it
+        for(size_t j=0; j<path_groundtruths.size(); j++) {
+
+            // Check if we have runs for this dataset
+            if(run_jobs.find({i,j})==run_jobs.end()) {
+                continue;
+            }
+
             // Debug print
             printf("[COMP]: processing %s algorithm => %s dataset\n", path_algorithms.at(i).stem().c_str(),path_groundtruths.at(j).stem().c_str());
 
@@ -154,34 +195,18 @@ int main(int argc, char **argv) {
                 rpe_dataset.insert({len,{ov_eval::Statistics(),ov_eval::Statistics()}});
             }
 
-            // Loop though the different runs for this dataset
-            std::vector<std::string> file_paths;
-            for(auto& entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_groundtruths.at(j).stem().string()))) {
-                if(entry.path().extension() != ".txt")
-                    continue;
-                file_paths.push_back(entry.path().string());
-            }
-            std::sort(file_paths.begin(), file_paths.end());
+            // Now loop through the sorted runs and merge their errors
+            for(const size_t &job : run_jobs.at({i,j})) {
 
-            // Now loop through the sorted vector
-            for(auto &path_esttxt : file_paths) {
-                // Our paths
-                std::string dataset = path_groundtruths.at(j).stem().string();
-                std::string path_gttxt = path_groundtruths.at(j).string();
-
-                // Create our trajectory object
-                ov_eval::ResultTrajectory traj(path_esttxt, path_gttxt, argv[1]);
-
-                // Calculate ATE error for this dataset
-                ov_eval::Statistics error_ori, error_pos;
-                traj.calculate_ate(error_ori, error_pos);
-                ate_dataset_ori.values.push_back(error_ori.rmse);
-                ate_dataset_pos.values.push_back(error_pos.rmse);
-
-                // Calculate RPE error for this dataset
-                std::map<double,std::pair<ov_eval::Statistics,ov_eval::Statistics>> error_rpe;
-                traj.calculate_rpe(segments, error_rpe);
-                for(const auto& elm : error_rpe) {
+                // Our errors for this run
+                const ov_eval::ResultEngine::RunResult &result = engine.get_result(job);
+
+                // ATE error for this dataset
+                ate_dataset_ori.values.push_back(result.ate_ori.rmse);
+                ate_dataset_pos.values.push_back(result.ate_pos.rmse);
+
+                // RPE error for this dataset
+                for(const auto& elm : result.rpe) {
                     rpe_dataset.at(elm.first).first.values.insert(rpe_dataset.at(elm.first).first.values.end(),elm.second.first.values.begin(),elm.second.first.values.end());
                     rpe_dataset.at(elm.first).first.timestamps.insert(rpe_dataset.at(elm.first).first.timestamps.end(),elm.second.first.timestamps.begin(),elm.second.first.timestamps.end());
                     rpe_dataset.at(elm.first).second.values.insert(rpe_dataset.at(elm.first).second.values.end(),elm.second.second.values.begin(),elm.second.second.values.end());
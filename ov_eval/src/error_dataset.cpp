@@ -25,6 +25,7 @@
 #include <boost/filesystem.hpp>
 
 
+#include "calc/ResultEngine.h"
 #include "calc/ResultTrajectory.h"
 #include "utils/Loader.h"
 #include "utils/Colors.h"
@@ -88,12 +89,12 @@ int main(int argc, char **argv) {
     //===============================================================================
 
 
-    // Loop through each algorithm type
-    for(size_t i=0; i<path_algorithms.size(); i++) {
+    // Our evaluation engine, we will first queue all runs and then evaluate them in parallel
+    ov_eval::ResultEngine engine(argv[1], segments);
 
-        // Debug print
-        printf("======================================\n");
-        printf("[COMP]: processing %s algorithm\n", path_algorithms.at(i).stem().c_str());
+    // Get the runs for each algorithm
+    std::map<size_t,std::vector<size_t>> run_jobs;
+    for(size_t i=0; i<path_algorithms.size(); i++) {
 
         // Get the list of datasets this algorithm records
         std::map<std::string,boost::filesystem::path> path_algo_datasets;
@@ -105,6 +106,40 @@ int main(int argc, char **argv) {
 
         // Check if we have runs for our dataset
         if(path_algo_datasets.find(path_gt.stem().string())==path_algo_datasets.end()) {
+            continue;
+        }
+
+        // Loop though the different runs for this dataset
+        std::vector<std::string> file_paths;
+        for(auto& entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_gt.stem().string()))) {
+            if(entry.path().extension() != ".txt")
+                continue;
+            file_paths.push_back(entry.path().string());
+        }
+        std::sort(file_paths.begin(), file_paths.end());
+
+        // Queue each run in sorted order
+        std::vector<size_t> jobs;
+        for(auto &path_esttxt : file_paths) {
+            jobs.push_back(engine.add_job(path_esttxt, path_gt.string()));
+        }
+        run_jobs.insert({i,jobs});
+
+    }
+
+    // Evaluate all our runs
+    engine.run();
+
+
+    // Loop through each algorithm type
+    for(size_t i=0; i<path_algorithms.size(); i++) {
+
+        // Debug print
+        printf("======================================\n");
+        printf("[COMP]: processing %s algorithm\n", path_algorithms.at(i).stem().c_str());
+
+        // Check if we have runs for our dataset
+        if(run_jobs.find(i)==run_jobs.end()) {
             printf(RED "[COMP]: %s dataset does not have any runs for %s!!!!!\n" RESET,path_algorithms.at(i).stem().c_str(),path_gt.stem().c_str());
             continue;
         }
@@ -120,31 +155,24 @@ int main(int argc, char **argv) {
         std::map<double,std::pair<ov_eval::Statistics,ov_eval::Statistics>> rmse_2d_dataset;
         std::map<double,std::pair<ov_eval::Statistics,ov_eval::Statistics>> nees_dataset;
 
-        // Loop though the different runs for this dataset
-        std::vector<std::string> file_paths;
-        for(auto& entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_gt.stem().string()))) {
-            if(entry.path().extension() != ".txt")
-                continue;
-            file_paths.push_back(entry.path().string());
-        }
-        std::sort(file_paths.begin(), file_paths.end());
+        // Our sorted runs for this dataset
+        const std::vector<size_t> &jobs = run_jobs.at(i);
 
         // Check if we have runs
-        if(file_paths.empty()) {
+        if(jobs.empty()) {
             printf(RED "\tERROR: No runs found for %s, is the folder structure right??\n" RESET, path_algorithms.at(i).stem().c_str());
             continue;
         }
 
-        // Loop though the different runs for this dataset
-        for(auto &path_esttxt : file_paths) {
+        // Loop though the different runs for this dataset and merge their errors
+        for(const size_t &job : jobs) {
 
-            // Create our trajectory object
-            std::string path_gttxt = path_gt.string();
-            ov_eval::ResultTrajectory traj(path_esttxt, path_gttxt, argv[1]);
+            // Our errors for this run
+            const ov_eval::ResultEngine::RunResult &result = engine.get_result(job);
 
-            // Calculate ATE error for this dataset
-            ov_eval::Statistics error_ori, error_pos;
-            traj.calculate_ate(error_ori, error_pos);
+            // ATE error for this dataset
+            const ov_eval::Statistics &error_ori = result.ate_ori;
+            const ov_eval::Statistics &error_pos = result.ate_pos;
             ate_dataset_ori.values.push_back(error_ori.rmse);
             ate_dataset_pos.values.push_back(error_pos.rmse);
             for(size_t j=0; j<error_ori.values.size(); j++) {
@@ -153,9 +181,9 @@ int main(int argc, char **argv) {
                 assert(error_ori.timestamps.at(j)==error_pos.timestamps.at(j));
             }
 
-            // Calculate ATE 2D error for this dataset
-            ov_eval::Statistics error_ori_2d, error_pos_2d;
-            traj.calculate_ate_2d(error_ori_2d, error_pos_2d);
+            // ATE 2D error for this dataset
+            const ov_eval::Statistics &error_ori_2d = result.ate_2d_ori;
+            const ov_eval::Statistics &error_pos_2d = result.ate_2d_pos;
             ate_2d_dataset_ori.values.push_back(error_ori_2d.rmse);
             ate_2d_dataset_pos.values.push_back(error_pos_2d.rmse);
             for(size_t j=0; j<error_ori_2d.values.size(); j++) {
@@ -165,19 +193,16 @@ int main(int argc, char **argv) {
             }
 
             // NEES error for this dataset
-            ov_eval::Statistics nees_ori, nees_pos;
-            traj.calculate_nees(nees_ori, nees_pos);
+            const ov_eval::Statistics &nees_ori = result.nees_ori;
+            const ov_eval::Statistics &nees_pos = result.nees_pos;
             for(size_t j=0; j<nees_ori.values.size(); j++) {
                 nees_dataset[nees_ori.timestamps.at(j)].first.values.push_back(nees_ori.values.at(j));
                 nees_dataset[nees_ori.timestamps.at(j)].second.values.push_back(nees_pos.values.at(j));
                 assert(nees_ori.timestamps.at(j)==nees_pos.timestamps.at(j));
             }
 
-
-            // Calculate RPE error for this dataset
-            std::map<double,std::pair<ov_eval::Statistics,ov_eval::Statistics>> error_rpe;
-            traj.calculate_rpe(segments, error_rpe);
-            for(const auto& elm : error_rpe) {
+            // RPE error for this dataset
+            for(const auto& elm : result.rpe) {
                 rpe_dataset.at(elm.first).first.values.insert(rpe_dataset.at(elm.first).first.values.end(),elm.second.first.values.begin(),elm.second.first.values.end());
                 rpe_dataset.at(elm.first).first.timestamps.insert(rpe_dataset.at(elm.first).first.timestamps.end(),elm.second.first.timestamps.begin(),elm.second.first.timestamps.end());
                 rpe_dataset.at(elm.first).second.values.insert(rpe_dataset.at(elm.first).second.values.end(),elm.second.second.values.begin(),elm.second.second.values.end());
@@ -208,7 +233,7 @@ int main(int argc, char **argv) {
         // RMSE: Convert into the right format (only use times where all runs have an error)
         ov_eval::Statistics rmse_ori, rmse_pos;
         for(auto &elm : rmse_dataset) {
-            if(elm.second.first.values.size()==file_paths.size()) {
+            if(elm.second.first.values.size()==jobs.size()) {
                 elm.second.first.calculate();
                 elm.second.second.calculate();
                 rmse_ori.timestamps.push_back(elm.first);
@@ -224,7 +249,7 @@ int main(int argc, char **argv) {
         // RMSE: Convert into the right format (only use times where all runs have an error)
         ov_eval::Statistics rmse_2d_ori, rmse_2d_pos;
         for(auto &elm : rmse_2d_dataset) {
-            if(elm.second.first.values.size()==file_paths.size()) {
+            if(elm.second.first.values.size()==jobs.size()) {
                 elm.second.first.calculate();
                 elm.second.second.calculate();
                 rmse_2d_ori.timestamps.push_back(elm.first);
@@ -240,7 +265,7 @@ int main(int argc, char **argv) {
         // NEES: Convert into the right format (only use times where all runs have an error)
         ov_eval::Statistics nees_ori, nees_pos;
         for(auto &elm : nees_dataset) {
-            if(elm.second.first.values.size()==file_paths.size()) {
+            if(elm.second.first.values.size()==jobs.size()) {
                 elm.second.first.calculate();
                 elm.second.second.calculate();
                 nees_ori.timestamps.push_back(elm.first);
@@ -74,15 +74,18 @@ int main(int argc, char **argv) {
         printf("[TIME]: loaded %d timestamps from file (%d categories)!!\n",(int)times.size(),(int)names_temp.size());
 
         // Our categories
+        // NOTE: only the total is plotted, so all others can be streamed without storing their values
         std::vector<ov_eval::Statistics> stats;
-        for(size_t i=0; i<names_temp.size(); i++)
+        for(size_t i=0; i<names_temp.size(); i++) {
             stats.push_back(ov_eval::Statistics());
+            if(i+1 < names_temp.size())
+                stats.back().enable_streaming();
+        }
 
         // Loop through each and report the average timing information
         for(size_t i=0; i<times.size(); i++) {
             for(size_t c=0; c<names_temp.size(); c++) {
-                stats.at(c).timestamps.push_back(times.at(i));
-                stats.at(c).values.push_back(timing_values.at(i)(c));
+                stats.at(c).add(times.at(i), timing_values.at(i)(c));
             }
         }
 
@@ -20,6 +20,12 @@
  */
 #include "Loader.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+
 
 using namespace ov_eval;
 
@@ -28,37 +34,41 @@ void Loader::load_data(std::string path_traj,
                        std::vector<double> &times, std::vector<Eigen::Matrix<double,7,1>> &poses,
                        std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos) {
 
-    // Try to open our trajectory file
-    std::ifstream file(path_traj);
-    if(!file.is_open()) {
-        printf(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
-        printf(RED "[LOAD]: %s\n" RESET,path_traj.c_str());
-        std::exit(EXIT_FAILURE);
+    // Load from our binary cache if we can
+    // Layout is [has_cov, num_poses, (time, pose, cov_ori(6), cov_pos(6))...]
+    std::vector<double> cache;
+    if(use_binary_cache() && read_cache(path_traj, 1, cache) && cache.size() >= 2) {
+        bool has_cov = (cache.at(0) == 1);
+        size_t num_poses = (size_t)cache.at(1);
+        size_t row_size = (has_cov)? 20 : 8;
+        if(cache.size() == 2+num_poses*row_size) {
+            for(size_t n=0; n<num_poses; n++) {
+                const double *data = cache.data()+2+n*row_size;
+                times.push_back(data[0]);
+                poses.push_back(Eigen::Map<const Eigen::Matrix<double,7,1>>(data+1));
+                if(has_cov) {
+                    Eigen::Matrix3d c_ori, c_pos;
+                    c_ori << data[8],data[9],data[10],
+                            data[9],data[11],data[12],
+                            data[10],data[12],data[13];
+                    c_pos << data[14],data[15],data[16],
+                            data[15],data[17],data[18],
+                            data[16],data[18],data[19];
+                    cov_ori.push_back(c_ori);
+                    cov_pos.push_back(c_pos);
+                }
+            }
+            return;
+        }
     }
 
     // Loop through each line of this file
-    std::string current_line;
-    while(std::getline(file, current_line)) {
-
-        // Skip if we start with a comment
-        if(!current_line.find("#"))
-            continue;
-
-        // Loop variables
-        int i = 0;
-        std::istringstream s(current_line);
-        std::string field;
-        Eigen::Matrix<double,20,1> data;
+    // NOTE: covariances are stored as the upper triangular so they are symmetric
+    Eigen::Matrix<double,20,1> data;
+    bool success = for_each_line(path_traj, [&](const char *begin, const char *end) {
 
         // Loop through this line (timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33)
-        while(std::getline(s,field,' ')) {
-            // Skip if empty
-            if(field.empty() || i >= data.rows())
-                continue;
-            // save the data to our vector
-            data(i) = std::atof(field.c_str());
-            i++;
-        }
+        int i = parse_line(begin, end, data.data(), (int)data.rows());
 
         // Only a valid line if we have all the parameters
         if(i >= 20) {
@@ -73,8 +83,6 @@ void Loader::load_data(std::string path_traj,
             c_pos << data(14),data(15),data(16),
                     data(15),data(17),data(18),
                     data(16),data(18),data(19);
-            c_ori = 0.5*(c_ori+c_ori.transpose());
-            c_pos = 0.5*(c_pos+c_pos.transpose());
             cov_ori.push_back(c_ori);
             cov_pos.push_back(c_pos);
         } else if(i >= 8) {
@@ -82,10 +90,14 @@ void Loader::load_data(std::string path_traj,
             poses.push_back(data.block(1,0,7,1));
         }
 
-    }
+    });
 
-    // Finally close the file
-    file.close();
+    // Try to open our trajectory file
+    if(!success) {
+        printf(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
+        printf(RED "[LOAD]: %s\n" RESET,path_traj.c_str());
+        std::exit(EXIT_FAILURE);
+    }
 
     // Error if we don't have any data
     if (times.empty()) {
@@ -108,6 +120,26 @@ void Loader::load_data(std::string path_traj,
         std::exit(EXIT_FAILURE);
     }
 
+    // Save to our binary cache
+    if(use_binary_cache()) {
+        bool has_cov = !cov_ori.empty();
+        cache.clear();
+        cache.reserve(2+times.size()*(has_cov? 20 : 8));
+        cache.push_back(has_cov? 1 : 0);
+        cache.push_back((double)times.size());
+        for(size_t n=0; n<times.size(); n++) {
+            cache.push_back(times.at(n));
+            cache.insert(cache.end(), poses.at(n).data(), poses.at(n).data()+7);
+            if(has_cov) {
+                const Eigen::Matrix3d &c_ori = cov_ori.at(n);
+                const Eigen::Matrix3d &c_pos = cov_pos.at(n);
+                cache.insert(cache.end(), {c_ori(0,0),c_ori(0,1),c_ori(0,2),c_ori(1,1),c_ori(1,2),c_ori(2,2)});
+                cache.insert(cache.end(), {c_pos(0,0),c_pos(0,1),c_pos(0,2),c_pos(1,1),c_pos(1,2),c_pos(2,2)});
+            }
+        }
+        write_cache(path_traj, 1, cache);
+    }
+
     // Debug print amount
     //std::string base_filename = path_traj.substr(path_traj.find_last_of("/\\") + 1);
     //printf("[LOAD]: loaded %d poses from %s\n",(int)poses.size(),base_filename.c_str());
@@ -118,47 +150,43 @@ void Loader::load_data(std::string path_traj,
 
 void Loader::load_simulation(std::string path, std::vector<Eigen::VectorXd> &values) {
 
-    // Try to open our trajectory file
-    std::ifstream file(path);
-    if(!file.is_open()) {
-        printf(RED "[LOAD]: Unable to open file...\n" RESET);
-        printf(RED "[LOAD]: %s\n" RESET,path.c_str());
-        std::exit(EXIT_FAILURE);
+    // Load from our binary cache if we can
+    // Layout is [num_rows, row_size, values...]
+    std::vector<double> cache;
+    if(use_binary_cache() && read_cache(path, 2, cache) && cache.size() >= 2) {
+        size_t num_rows = (size_t)cache.at(0);
+        size_t row_size = (size_t)cache.at(1);
+        if(num_rows > 0 && cache.size() == 2+num_rows*row_size) {
+            for(size_t n=0; n<num_rows; n++) {
+                values.push_back(Eigen::Map<const Eigen::VectorXd>(cache.data()+2+n*row_size, row_size));
+            }
+            return;
+        }
     }
 
     // Loop through each line of this file
-    std::string current_line;
-    while(std::getline(file, current_line)) {
-
-        // Skip if we start with a comment
-        if(!current_line.find("#"))
-            continue;
-
-        // Loop variables
-        std::istringstream s(current_line);
-        std::string field;
-        std::vector<double> vec;
+    // We reuse the same buffer for each line, and grow it if we have a line with more values
+    std::vector<double> vec(64);
+    bool success = for_each_line(path, [&](const char *begin, const char *end) {
 
         // Loop through this line (timestamp(s) values....)
-        while(std::getline(s,field,' ')) {
-            // Skip if empty
-            if(field.empty())
-                continue;
-            // save the data to our vector
-            vec.push_back(std::atof(field.c_str()));
+        int num = parse_line(begin, end, vec.data(), (int)vec.size());
+        if(num > (int)vec.size()) {
+            vec.resize(num);
+            num = parse_line(begin, end, vec.data(), (int)vec.size());
         }
 
         // Create eigen vector
-        Eigen::VectorXd temp(vec.size());
-        for(size_t i=0; i<vec.size(); i++) {
-            temp(i) = vec.at(i);
-        }
-        values.push_back(temp);
+        values.push_back(Eigen::Map<Eigen::VectorXd>(vec.data(), num));
 
-    }
+    });
 
-    // Finally close the file
-    file.close();
+    // Try to open our trajectory file
+    if(!success) {
+        printf(RED "[LOAD]: Unable to open file...\n" RESET);
+        printf(RED "[LOAD]: %s\n" RESET,path.c_str());
+        std::exit(EXIT_FAILURE);
+    }
 
     // Error if we don't have any data
     if (values.empty()) {
@@ -177,6 +205,18 @@ void Loader::load_simulation(std::string path, std::vector<Eigen::VectorXd> &val
         }
     }
 
+    // Save to our binary cache
+    if(use_binary_cache()) {
+        cache.clear();
+        cache.reserve(2+values.size()*rowsize);
+        cache.push_back((double)values.size());
+        cache.push_back((double)rowsize);
+        for(const Eigen::VectorXd &row : values) {
+            cache.insert(cache.end(), row.data(), row.data()+row.rows());
+        }
+        write_cache(path, 2, cache);
+    }
+
 }
 
 
@@ -349,3 +389,152 @@ double Loader::get_total_length(const std::vector<Eigen::Matrix<double,7,1>> &po
 }
 
 
+
+bool Loader::for_each_line(const std::string &path, const std::function<void(const char*,const char*)> &func) {
+
+    // Open our file and get its size
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // Empty files have no lines (and can't be mapped)
+    size_t size = (size_t)info.st_size;
+    if(size == 0) {
+        close(fd);
+        return true;
+    }
+
+    // Map the whole file into memory
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+        return false;
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    // Loop through each line, skipping if it starts with a comment
+    const char *data = static_cast<const char*>(mapped);
+    const char *data_end = data+size;
+    const char *line = data;
+    while(line < data_end) {
+        const char *line_end = static_cast<const char*>(std::memchr(line, '\n', data_end-line));
+        if(line_end == nullptr)
+            line_end = data_end;
+        if(line != line_end && *line != '#')
+            func(line, line_end);
+        line = line_end+1;
+    }
+
+    // Done, unmap it
+    munmap(mapped, size);
+    return true;
+
+}
+
+
+
+int Loader::parse_line(const char *begin, const char *end, double *values, int max_values) {
+
+    // Loop through each *space* separated field
+    // NOTE: the mapped file is not null terminated, so we copy each field into a small buffer for strtod
+    int num = 0;
+    char buffer[64];
+    const char *field = begin;
+    while(field < end) {
+        const char *field_end = static_cast<const char*>(std::memchr(field, ' ', end-field));
+        if(field_end == nullptr)
+            field_end = end;
+        // Skip if empty, else save the data
+        if(field_end != field) {
+            if(num < max_values) {
+                size_t length = std::min((size_t)(field_end-field), sizeof(buffer)-1);
+                std::memcpy(buffer, field, length);
+                buffer[length] = '\0';
+                values[num] = std::strtod(buffer, nullptr);
+            }
+            num++;
+        }
+        field = field_end+1;
+    }
+    return num;
+
+}
+
+
+
+bool Loader::get_cache_info(const std::string &path, std::string &path_cache, std::vector<int64_t> &key) {
+
+    // Get the modification time and size of the text file
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0)
+        return false;
+    key = {(int64_t)info.st_mtim.tv_sec, (int64_t)info.st_mtim.tv_nsec, (int64_t)info.st_size};
+
+    // Our cache is a hidden file in the same folder
+    boost::filesystem::path path_text(path);
+    path_cache = (path_text.parent_path() / ("."+path_text.filename().string()+".ovcache")).string();
+    return true;
+
+}
+
+
+
+bool Loader::read_cache(const std::string &path, int64_t type, std::vector<double> &data) {
+
+    // Get our cache location
+    std::string path_cache;
+    std::vector<int64_t> key;
+    if(!get_cache_info(path, path_cache, key))
+        return false;
+
+    // Read the header, and check that it matches
+    // Header is [magic, type, mtime_sec, mtime_nsec, size, num_values]
+    std::ifstream file(path_cache, std::ios::in | std::ios::binary);
+    if(!file.is_open())
+        return false;
+    int64_t header[6];
+    if(!file.read(reinterpret_cast<char*>(header), sizeof(header)))
+        return false;
+    if(header[0] != 0x4F56455643414348 || header[1] != type || header[2] != key.at(0) || header[3] != key.at(1) || header[4] != key.at(2))
+        return false;
+
+    // Read our values
+    data.resize((size_t)header[5]);
+    if(!file.read(reinterpret_cast<char*>(data.data()), data.size()*sizeof(double))) {
+        data.clear();
+        return false;
+    }
+    return true;
+
+}
+
+
+
+void Loader::write_cache(const std::string &path, int64_t type, const std::vector<double> &data) {
+
+    // Get our cache location
+    std::string path_cache;
+    std::vector<int64_t> key;
+    if(!get_cache_info(path, path_cache, key))
+        return;
+
+    // Write to a temporary file and then move it, so concurrent readers never see a partial cache
+    std::string path_tmp = path_cache+"."+std::to_string((long)getpid())+"."+std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::ofstream file(path_tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) {
+        printf(YELLOW "[LOAD]: unable to write cache %s\n" RESET,path_cache.c_str());
+        return;
+    }
+    int64_t header[6] = {0x4F56455643414348, type, key.at(0), key.at(1), key.at(2), (int64_t)data.size()};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(data.data()), data.size()*sizeof(double));
+    file.close();
+    if(file.fail() || std::rename(path_tmp.c_str(), path_cache.c_str()) != 0) {
+        std::remove(path_tmp.c_str());
+    }
+
+}
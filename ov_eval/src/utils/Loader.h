@@ -25,6 +25,11 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
 
 #include <Eigen/Eigen>
 #include <boost/filesystem.hpp>
@@ -88,8 +93,72 @@ namespace ov_eval {
          */
         static double get_total_length(const std::vector<Eigen::Matrix<double,7,1>> &poses);
 
+        /**
+         * @brief Enables a binary sidecar cache for load_data() and load_simulation()
+         *
+         * If enabled, after a text file is parsed we will write a hidden binary file next to it (.filename.ovcache).
+         * This cache stores the modification time and size of the text file, and will only be used if both still match.
+         * This is disabled by default, unless the OV_EVAL_CACHE environmental variable is set.
+         *
+         * @param enable True if we should read and write the binary cache
+         */
+        static void set_binary_cache(bool enable) {
+            use_binary_cache() = enable;
+        }
+
+
     private:
 
+        /// If we should use the binary sidecar cache
+        static bool &use_binary_cache() {
+            static bool enabled = (std::getenv("OV_EVAL_CACHE") != nullptr);
+            return enabled;
+        }
+
+        /**
+         * @brief Will map the file into memory and call the function on each line which is not a comment
+         * @param path Path to the text file
+         * @param func Function called with the start and end (exclusive) of each line
+         * @return False if we could not open the file
+         */
+        static bool for_each_line(const std::string &path, const std::function<void(const char*,const char*)> &func);
+
+        /**
+         * @brief Parses *space* separated numbers in place (without allocating)
+         * @param begin Start of the line
+         * @param end End of the line (exclusive)
+         * @param values Output buffer of values
+         * @param max_values Max number of values we can store in the buffer
+         * @return Number of fields on this line (can be larger than max_values)
+         */
+        static int parse_line(const char *begin, const char *end, double *values, int max_values);
+
+        /**
+         * @brief Gets the path of the binary cache of a text file and the key (modification time and size) it should have
+         * @param path Path to the text file
+         * @param path_cache Path to the cache file
+         * @param key Key that the cache needs to have to be valid
+         * @return False if we are unable to stat the text file
+         */
+        static bool get_cache_info(const std::string &path, std::string &path_cache, std::vector<int64_t> &key);
+
+        /**
+         * @brief Reads the binary cache of a text file, if it is valid
+         * @param path Path to the text file
+         * @param type Type of data the cache should contain
+         * @param data Values stored in the cache
+         * @return True if we have loaded a valid cache
+         */
+        static bool read_cache(const std::string &path, int64_t type, std::vector<double> &data);
+
+        /**
+         * @brief Writes the binary cache of a text file
+         * @param path Path to the text file
+         * @param type Type of data the cache contains
+         * @param data Values to store in the cache
+         */
+        static void write_cache(const std::string &path, int64_t type, const std::vector<double> &data);
+
         /**
          * All function in this class should be static.
          * Thus an instance of this class cannot be created.
@@ -0,0 +1,176 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_QUANTILESKETCH_H
+#define OV_EVAL_QUANTILESKETCH_H
+
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <map>
+
+
+namespace ov_eval {
+
+
+    /**
+     * @brief Mergeable quantile sketch with bounded relative error.
+     *
+     * Values are counted in logarithmically sized buckets, such that any quantile returned has a relative error of at most the specified accuracy.
+     * Only the non-empty buckets are stored, thus the memory depends on the range of the values and not on the number of values.
+     * Two sketches with the same accuracy can be merged by adding their bucket counts, which gives the same result as if all values were added to one.
+     * This follows the [DDSketch](https://arxiv.org/abs/1908.10693) construction.
+     */
+    class QuantileSketch {
+
+    public:
+
+        /**
+         * @brief Default constructor
+         * @param relative_accuracy Max relative error of the returned quantiles
+         */
+        QuantileSketch(double relative_accuracy = 0.005) : alpha(relative_accuracy) {
+            gamma = (1.0+alpha)/(1.0-alpha);
+            log_gamma = std::log(gamma);
+        }
+
+        /**
+         * @brief Adds a value to the sketch
+         * @param value Value we want to add
+         * @param num Number of times this value should be added
+         */
+        void add(double value, uint64_t num = 1) {
+            if(std::isnan(value))
+                return;
+            if(value > min_value) {
+                buckets_pos[index(value)] += num;
+            } else if(value < -min_value) {
+                buckets_neg[index(-value)] += num;
+            } else {
+                num_zeros += num;
+            }
+            num_total += num;
+        }
+
+        /**
+         * @brief Merges another sketch into this one
+         * @param other Sketch that must have been created with the same accuracy
+         */
+        void merge(const QuantileSketch &other) {
+            assert(alpha == other.alpha);
+            for(const auto &bucket : other.buckets_pos)
+                buckets_pos[bucket.first] += bucket.second;
+            for(const auto &bucket : other.buckets_neg)
+                buckets_neg[bucket.first] += bucket.second;
+            num_zeros += other.num_zeros;
+            num_total += other.num_total;
+        }
+
+        /**
+         * @brief Gets the value at a given quantile
+         * @param q Quantile we want in [0,1] (i.e. 0.5 is the median)
+         * @return Value at this quantile (zero if we have no values)
+         */
+        double quantile(double q) const {
+
+            // Return if empty
+            if(num_total == 0)
+                return 0.0;
+
+            // Rank of the value we want (zero based)
+            q = std::max(0.0, std::min(1.0, q));
+            uint64_t rank = (uint64_t)(q*(num_total-1));
+
+            // Negative values, starting from the most negative
+            uint64_t count = 0;
+            for(auto it = buckets_neg.rbegin(); it != buckets_neg.rend(); ++it) {
+                count += it->second;
+                if(count > rank)
+                    return -value(it->first);
+            }
+
+            // Zeros
+            count += num_zeros;
+            if(count > rank)
+                return 0.0;
+
+            // Positive values
+            for(const auto &bucket : buckets_pos) {
+                count += bucket.second;
+                if(count > rank)
+                    return value(bucket.first);
+            }
+            return value(buckets_pos.rbegin()->first);
+
+        }
+
+        /// Number of values added to the sketch
+        uint64_t size() const {
+            return num_total;
+        }
+
+        /// Number of buckets we are storing
+        size_t num_buckets() const {
+            return buckets_pos.size()+buckets_neg.size();
+        }
+
+        /// Will clear all values
+        void clear() {
+            buckets_pos.clear();
+            buckets_neg.clear();
+            num_zeros = 0;
+            num_total = 0;
+        }
+
+    protected:
+
+        /// Bucket index of a positive value
+        int index(double value) const {
+            return (int)std::ceil(std::log(value)/log_gamma);
+        }
+
+        /// Representative value of a bucket (has at most alpha relative error to all values in it)
+        double value(int index) const {
+            return 2.0*std::pow(gamma, index)/(gamma+1.0);
+        }
+
+        /// Relative accuracy and the growth of each bucket
+        double alpha, gamma, log_gamma;
+
+        /// Values smaller than this are counted as zeros
+        double min_value = 1e-12;
+
+        /// Number of values in each bucket of positive and negative values
+        std::map<int,uint64_t> buckets_pos, buckets_neg;
+
+        /// Number of zero values
+        uint64_t num_zeros = 0;
+
+        /// Total number of values
+        uint64_t num_total = 0;
+
+    };
+
+
+}
+
+#endif //OV_EVAL_QUANTILESKETCH_H
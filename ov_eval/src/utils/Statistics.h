@@ -25,8 +25,11 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <Eigen/Eigen>
 
+#include "QuantileSketch.h"
+
 
 namespace ov_eval {
 
@@ -72,30 +75,118 @@ namespace ov_eval {
         std::vector<double> values_bound;
 
 
+        /**
+         * @brief Will switch these statistics into streaming mode.
+         *
+         * In streaming mode values are not stored, instead we keep running moments (Welford's algorithm) and a quantile sketch.
+         * Thus memory does not grow with the number of values and statistics of different runs can be merged with merge().
+         * The min, max, mean, rmse, and std are exact, while the median and 99th percentile have the relative error of the @ref QuantileSketch.
+         * Note that the 99th percentile is then the actual quantile of the values, while calculate() uses the Gaussian estimate mean+2.326*std.
+         * Thus these differ for heavy-tailed values (e.g. timings), where the streaming one is the more accurate.
+         *
+         * @param relative_accuracy Max relative error of the median and 99th percentile
+         */
+        void enable_streaming(double relative_accuracy = 0.005) {
+            streaming = true;
+            sketch = QuantileSketch(relative_accuracy);
+            for(const double &value : values)
+                add_streaming(value);
+            timestamps.clear();
+            values.clear();
+            values_bound.clear();
+        }
+
+        /**
+         * @brief Adds a value to our statistics
+         *
+         * If we are not in streaming mode this will just append it to the vectors.
+         *
+         * @param timestamp Time this value occurred at
+         * @param value Value we want to add (e.g. error at this time)
+         */
+        void add(double timestamp, double value) {
+            if(streaming) {
+                add_streaming(value);
+            } else {
+                timestamps.push_back(timestamp);
+                values.push_back(value);
+            }
+        }
+
+        /**
+         * @brief Merges the values of another set of statistics into this one
+         *
+         * If we are streaming then its running moments and sketch are combined with ours.
+         * Otherwise we append its values (the other needs to also not be streaming).
+         *
+         * @param other Statistics we want to merge into this one
+         */
+        void merge(const Statistics &other) {
+            if(!streaming) {
+                assert(!other.streaming);
+                timestamps.insert(timestamps.end(), other.timestamps.begin(), other.timestamps.end());
+                values.insert(values.end(), other.values.begin(), other.values.end());
+                values_bound.insert(values_bound.end(), other.values_bound.begin(), other.values_bound.end());
+                return;
+            }
+            if(!other.streaming) {
+                for(const double &value : other.values)
+                    add_streaming(value);
+                return;
+            }
+            if(other.stream_count == 0)
+                return;
+            // Combine the moments of both (Chan et al. parallel algorithm)
+            double delta = other.stream_mean - stream_mean;
+            size_t count = stream_count + other.stream_count;
+            stream_mean += delta * other.stream_count / count;
+            stream_m2 += other.stream_m2 + delta * delta * stream_count * other.stream_count / count;
+            stream_sumsq += other.stream_sumsq;
+            stream_min = (stream_count == 0)? other.stream_min : std::min(stream_min, other.stream_min);
+            stream_max = (stream_count == 0)? other.stream_max : std::max(stream_max, other.stream_max);
+            stream_count = count;
+            sketch.merge(other.sketch);
+        }
+
+        /// Number of values we have (either stored or streamed)
+        size_t size() const {
+            return (streaming)? stream_count : values.size();
+        }
+
+
         /// Will calculate all values from our vectors of information
         void calculate() {
 
-            // Sort the data for easy finding of values
-            std::vector<double> values_sorted = values;
-            std::sort(values_sorted.begin(), values_sorted.end());
+            // If we are streaming then we can directly get them from our running moments
+            if(streaming) {
+                calculate_streaming();
+                return;
+            }
 
             // If we don't have any data, just return :(
-            if(values_sorted.empty())
+            if(values.empty())
                 return;
 
-            // Now that its been sorted, can easily grab min and max
-            min = values_sorted.at(0);
-            max = values_sorted.at(values_sorted.size()-1);
+            // Copy the data so we can partially sort it to find the median
+            std::vector<double> values_sorted = values;
+
+            // Grab min and max
+            auto minmax = std::minmax_element(values_sorted.begin(), values_sorted.end());
+            min = *minmax.first;
+            max = *minmax.second;
 
             // Compute median
             // ODD:  grab middle from the sorted vector
             // EVEN: average the middle two numbers
+            // NOTE: after nth_element all values before the middle are smaller, so we can get the max of them for the lower middle
+            auto middle = values_sorted.begin() + values_sorted.size() / 2;
+            std::nth_element(values_sorted.begin(), middle, values_sorted.end());
             if (values_sorted.size()==1) {
                 median = values_sorted.at(values_sorted.size()-1);
             } else if(values_sorted.size() % 2 == 1) {
-                median = values_sorted.at(values_sorted.size() / 2);
+                median = *middle;
             } else if(values_sorted.size() > 1) {
-                median = 0.5 * (values_sorted.at(values_sorted.size()/2-1) + values_sorted.at(values_sorted.size()/2));
+                median = 0.5 * (*std::max_element(values_sorted.begin(), middle) + *middle);
             } else {
                 median = 0.0;
             }
@@ -129,6 +220,53 @@ namespace ov_eval {
             timestamps.clear();
             values.clear();
             values_bound.clear();
+            stream_count = 0;
+            stream_mean = 0.0;
+            stream_m2 = 0.0;
+            stream_sumsq = 0.0;
+            sketch.clear();
+        }
+
+    protected:
+
+        /// If we are in streaming mode (see enable_streaming())
+        bool streaming = false;
+
+        /// Running moments of our streamed values
+        size_t stream_count = 0;
+        double stream_mean = 0.0;
+        double stream_m2 = 0.0;
+        double stream_sumsq = 0.0;
+        double stream_min = 0.0;
+        double stream_max = 0.0;
+
+        /// Quantile sketch of our streamed values
+        QuantileSketch sketch;
+
+        /// Updates our running moments with a new value (Welford's algorithm)
+        void add_streaming(double value) {
+            assert(!std::isnan(value));
+            stream_min = (stream_count == 0)? value : std::min(stream_min, value);
+            stream_max = (stream_count == 0)? value : std::max(stream_max, value);
+            stream_count++;
+            double delta = value - stream_mean;
+            stream_mean += delta / stream_count;
+            stream_m2 += delta * (value - stream_mean);
+            stream_sumsq += value * value;
+            sketch.add(value);
+        }
+
+        /// Calculates our final statistics from the running moments and sketch
+        void calculate_streaming() {
+            if(stream_count == 0)
+                return;
+            min = stream_min;
+            max = stream_max;
+            median = std::max(min, std::min(max, sketch.quantile(0.5)));
+            mean = stream_mean;
+            rmse = std::sqrt(stream_sumsq / stream_count);
+            std = std::sqrt(stream_m2 / (stream_count - 1));
+            ninetynine = std::max(min, std::min(max, sketch.quantile(0.99)));
         }
 
     };
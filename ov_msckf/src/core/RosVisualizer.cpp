@@ -100,38 +100,122 @@ RosVisualizer::RosVisualizer(ros::NodeHandle &nh, VioManager* app, Simulator *si
 
     }
 
+    // Finally start our publishing thread
+    thread_viz = std::thread(&RosVisualizer::thread_publish, this);
+
+}
+
+
+
+RosVisualizer::~RosVisualizer() {
+
+    // Tell our thread to stop once it has published everything
+    {
+        std::lock_guard<std::mutex> lck(mtx_viz);
+        viz_shutdown = true;
+    }
+    cv_viz_new.notify_one();
+    thread_viz.join();
+
 }
 
 
 
 void RosVisualizer::visualize() {
 
+    // Our snapshot of the estimator for this timestep
+    VisualizationData data;
+    data.state = _app->get_state_snapshot();
 
-    // publish current image
-    publish_images();
+    // Get our image of history tracks
+    // NOTE: this needs the feature database of the trackers, so it has to be done on the estimator thread
+    if(pub_tracks.getNumSubscribers() > 0) {
+        _app->get_track_feat()->display_history(data.img_history,255,255,0,255,255,255);
+        if(_app->get_track_aruco() != nullptr) {
+            _app->get_track_aruco()->display_history(data.img_history, 0, 255, 255, 255, 255, 255);
+            _app->get_track_aruco()->display_active(data.img_history, 0, 255, 255, 255, 255, 255);
+        }
+    }
 
-    // Return if we have not inited
-    if(!_app->initialized())
-        return;
+    // If we are initialized, record our start time and save the state
+    if(data.state->initialized) {
+
+        // Save the start time of this dataset
+        if(!start_time_set) {
+            rT1 =  boost::posix_time::microsec_clock::local_time();
+            start_time_set = true;
+        }
 
-    // Save the start time of this dataset
-    if(!start_time_set) {
-        rT1 =  boost::posix_time::microsec_clock::local_time();
-        start_time_set = true;
+        // Get our groundtruth state in the IMU clock frame [time(sec),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel]
+        // NOTE: if we are simulating, we get the true time in the IMU clock frame
+        if(_sim != nullptr) {
+            data.timestamp_gt = data.state->timestamp + _sim->get_true_paramters().calib_camimu_dt;
+            data.has_gt = _sim->get_state(data.timestamp_gt, data.state_gt);
+        } else if(!gt_states.empty()) {
+            data.timestamp_gt = data.state->timestamp_inI;
+            data.has_gt = DatasetReader::get_gt_state(data.timestamp_gt, data.state_gt, gt_states);
+        }
+
+        // save total state (needs the full covariance, so we do this directly)
+        if(save_total_state)
+            sim_save_total_state_to_file();
+
+    }
+
+    // Hand it to our publishing thread
+    // If it has fallen far behind then skip the messages of the oldest snapshots, since they are stale anyways
+    // NOTE: these snapshots are still processed so that our paths and error statistics are complete
+    {
+        std::lock_guard<std::mutex> lck(mtx_viz);
+        queue_viz.push_back(data);
+        for(size_t i=0; i+10<queue_viz.size(); i++) {
+            queue_viz.at(i).publish = false;
+            queue_viz.at(i).img_history.release();
+        }
     }
+    cv_viz_new.notify_one();
+
+}
+
+
+
+void RosVisualizer::thread_publish() {
+
+    while(true) {
 
-    // publish state
-    publish_state();
+        // Wait for our next snapshot
+        VisualizationData data;
+        {
+            std::unique_lock<std::mutex> lck(mtx_viz);
+            cv_viz_new.wait(lck, [this] { return !queue_viz.empty() || viz_shutdown; });
+            if(queue_viz.empty())
+                break;
+            data = queue_viz.front();
+            queue_viz.pop_front();
+            viz_publishing = true;
+        }
 
-    // publish points
-    publish_features();
+        // publish current image
+        if(data.publish)
+            publish_images(data);
+
+        // publish state, points, and gt if we have it
+        // NOTE: the state and gt always need to be processed, since they record our paths and statistics
+        if(data.state->initialized) {
+            publish_state(data);
+            if(data.publish)
+                publish_features(data);
+            publish_groundtruth(data);
+        }
 
-    // Publish gt if we have it
-    publish_groundtruth();
+        // Notify anybody waiting for us to finish
+        {
+            std::lock_guard<std::mutex> lck(mtx_viz);
+            viz_publishing = false;
+        }
+        cv_viz_done.notify_all();
 
-    // save total state
-    if(save_total_state)
-        sim_save_total_state_to_file();
+    }
 
 }
 
@@ -212,6 +296,12 @@ void RosVisualizer::visualize_odometry(double timestamp) {
 
 void RosVisualizer::visualize_final() {
 
+    // Wait for our thread to publish all snapshots, so our statistics are complete
+    {
+        std::unique_lock<std::mutex> lck(mtx_viz);
+        cv_viz_done.wait(lck, [this] { return queue_viz.empty() && !viz_publishing; });
+    }
+
     // Final time offset value
     if(_app->get_state()->_options.do_calib_camera_timeoffset) {
         printf(REDPURPLE "camera-imu timeoffset = %.5f\n\n" RESET,_app->get_state()->_calib_dt_CAMtoIMU->value()(0));
@@ -264,62 +354,63 @@ void RosVisualizer::visualize_final() {
 
 
 
-void RosVisualizer::publish_state() {
+void RosVisualizer::publish_state(const VisualizationData &data) {
 
     // Get the current state
-    State* state = _app->get_state();
-
-    // We want to publish in the IMU clock frame
-    // The timestamp in the state will be the last camera time
-    double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
-    double timestamp_inI = state->_timestamp + t_ItoC;
+    const StateSnapshot &state = *data.state;
 
     // Create pose of IMU (note we use the bag time)
     geometry_msgs::PoseWithCovarianceStamped poseIinM;
-    poseIinM.header.stamp = ros::Time(timestamp_inI);
+    poseIinM.header.stamp = ros::Time(state.timestamp_inI);
     poseIinM.header.seq = poses_seq_imu;
     poseIinM.header.frame_id = "global";
-    poseIinM.pose.pose.orientation.x = state->_imu->quat()(0);
-    poseIinM.pose.pose.orientation.y = state->_imu->quat()(1);
-    poseIinM.pose.pose.orientation.z = state->_imu->quat()(2);
-    poseIinM.pose.pose.orientation.w = state->_imu->quat()(3);
-    poseIinM.pose.pose.position.x = state->_imu->pos()(0);
-    poseIinM.pose.pose.position.y = state->_imu->pos()(1);
-    poseIinM.pose.pose.position.z = state->_imu->pos()(2);
+    poseIinM.pose.pose.orientation.x = state.imu(0);
+    poseIinM.pose.pose.orientation.y = state.imu(1);
+    poseIinM.pose.pose.orientation.z = state.imu(2);
+    poseIinM.pose.pose.orientation.w = state.imu(3);
+    poseIinM.pose.pose.position.x = state.imu(4);
+    poseIinM.pose.pose.position.y = state.imu(5);
+    poseIinM.pose.pose.position.z = state.imu(6);
 
     // Finally set the covariance in the message (in the order position then orientation as per ros convention)
-    std::vector<Type*> statevars;
-    statevars.push_back(state->_imu->pose()->p());
-    statevars.push_back(state->_imu->pose()->q());
-    Eigen::Matrix<double,6,6> covariance_posori = StateHelper::get_marginal_covariance(_app->get_state(),statevars);
-    for(int r=0; r<6; r++) {
-        for(int c=0; c<6; c++) {
-            poseIinM.pose.covariance[6*r+c] = covariance_posori(r,c);
+    if(data.publish && pub_poseimu.getNumSubscribers() > 0) {
+        Eigen::Matrix<double,6,6> covariance_posori = state.cov_posori();
+        for(int r=0; r<6; r++) {
+            for(int c=0; c<6; c++) {
+                poseIinM.pose.covariance[6*r+c] = covariance_posori(r,c);
+            }
         }
+        pub_poseimu.publish(poseIinM);
     }
-    pub_poseimu.publish(poseIinM);
 
 
     //=========================================================
     //=========================================================
 
     // Append to our pose vector
+    // NOTE: we always record this so the full path can be published once someone subscribes
     geometry_msgs::PoseStamped posetemp;
     posetemp.header = poseIinM.header;
     posetemp.pose = poseIinM.pose.pose;
     poses_imu.push_back(posetemp);
 
     // Create our path (imu)
-    nav_msgs::Path arrIMU;
-    arrIMU.header.stamp = ros::Time::now();
-    arrIMU.header.seq = poses_seq_imu;
-    arrIMU.header.frame_id = "global";
-    arrIMU.poses = poses_imu;
-    pub_pathimu.publish(arrIMU);
+    if(data.publish && pub_pathimu.getNumSubscribers() > 0) {
+        nav_msgs::Path arrIMU;
+        arrIMU.header.stamp = ros::Time::now();
+        arrIMU.header.seq = poses_seq_imu;
+        arrIMU.header.frame_id = "global";
+        arrIMU.poses = poses_imu;
+        pub_pathimu.publish(arrIMU);
+    }
 
     // Move them forward in time
     poses_seq_imu++;
 
+    // Return if we are skipping the messages of this timestep
+    if(!data.publish)
+        return;
+
     // Publish our transform on TF
     // NOTE: since we use JPL we have an implicit conversion to Hamilton when we publish
     // NOTE: a rotation from GtoI in JPL has the same xyzw as a ItoG Hamilton rotation
@@ -327,17 +418,17 @@ void RosVisualizer::publish_state() {
     trans.stamp_ = ros::Time::now();
     trans.frame_id_ = "global";
     trans.child_frame_id_ = "imu";
-    tf::Quaternion quat(state->_imu->quat()(0),state->_imu->quat()(1),state->_imu->quat()(2),state->_imu->quat()(3));
+    tf::Quaternion quat(state.imu(0),state.imu(1),state.imu(2),state.imu(3));
     trans.setRotation(quat);
-    tf::Vector3 orig(state->_imu->pos()(0),state->_imu->pos()(1),state->_imu->pos()(2));
+    tf::Vector3 orig(state.imu(4),state.imu(5),state.imu(6));
     trans.setOrigin(orig);
     mTfBr->sendTransform(trans);
 
     // Loop through each camera calibration and publish it
-    for(const auto &calib : state->_calib_IMUtoCAM) {
+    for(const auto &calib : state.calib_IMUtoCAM) {
         // need to flip the transform to the IMU frame
-        Eigen::Vector4d q_ItoC = calib.second->quat();
-        Eigen::Vector3d p_CinI = -calib.second->Rot().transpose()*calib.second->pos();
+        Eigen::Vector4d q_ItoC = calib.second.block(0,0,4,1);
+        Eigen::Vector3d p_CinI = -quat_2_Rot(q_ItoC).transpose()*calib.second.block(4,0,3,1);
         // publish our transform on TF
         // NOTE: since we use JPL we have an implicit conversion to Hamilton when we publish
         // NOTE: a rotation from ItoC in JPL has the same xyzw as a CtoI Hamilton rotation
@@ -356,28 +447,16 @@ void RosVisualizer::publish_state() {
 
 
 
-void RosVisualizer::publish_images() {
+void RosVisualizer::publish_images(const VisualizationData &data) {
 
-    // Check if we have subscribers
-    if(pub_tracks.getNumSubscribers()==0)
+    // Check if we have subscribers and our image (this was rendered on the estimator thread)
+    if(pub_tracks.getNumSubscribers()==0 || data.img_history.empty())
         return;
 
-    // Get our trackers
-    TrackBase *trackFEATS = _app->get_track_feat();
-    TrackBase *trackARUCO = _app->get_track_aruco();
-
-    // Get our image of history tracks
-    cv::Mat img_history;
-    trackFEATS->display_history(img_history,255,255,0,255,255,255);
-    if(trackARUCO != nullptr) {
-        trackARUCO->display_history(img_history, 0, 255, 255, 255, 255, 255);
-        trackARUCO->display_active(img_history, 0, 255, 255, 255, 255, 255);
-    }
-
     // Create our message
     std_msgs::Header header;
     header.stamp = ros::Time::now();
-    sensor_msgs::ImagePtr exl_msg = cv_bridge::CvImage(header, "bgr8", img_history).toImageMsg();
+    sensor_msgs::ImagePtr exl_msg = cv_bridge::CvImage(header, "bgr8", data.img_history).toImageMsg();
 
     // Publish
     pub_tracks.publish(exl_msg);
@@ -387,121 +466,134 @@ void RosVisualizer::publish_images() {
 
 
 
-void RosVisualizer::publish_features() {
+void RosVisualizer::publish_features(const VisualizationData &data) {
 
     // Check if we have subscribers
     if(pub_points_msckf.getNumSubscribers()==0 && pub_points_slam.getNumSubscribers()==0 &&
        pub_points_aruco.getNumSubscribers()==0 && pub_points_sim.getNumSubscribers()==0)
         return;
 
-    // Get our good features
-    std::vector<Eigen::Vector3d> feats_msckf = _app->get_good_features_MSCKF();
-
-    // Declare message and sizes
-    sensor_msgs::PointCloud2 cloud;
-    cloud.header.frame_id = "global";
-    cloud.header.stamp = ros::Time::now();
-    cloud.width  = 3*feats_msckf.size();
-    cloud.height = 1;
-    cloud.is_bigendian = false;
-    cloud.is_dense = false; // there may be invalid points
-
-    // Setup pointcloud fields
-    sensor_msgs::PointCloud2Modifier modifier(cloud);
-    modifier.setPointCloud2FieldsByString(1,"xyz");
-    modifier.resize(3*feats_msckf.size());
+    // Only publish the features that someone wants
+    if(pub_points_msckf.getNumSubscribers() > 0) {
+
+        // Get our good features
+        const std::vector<Eigen::Vector3d> &feats_msckf = data.state->features_MSCKF;
+
+        // Declare message and sizes
+        sensor_msgs::PointCloud2 cloud;
+        cloud.header.frame_id = "global";
+        cloud.header.stamp = ros::Time::now();
+        cloud.width  = 3*feats_msckf.size();
+        cloud.height = 1;
+        cloud.is_bigendian = false;
+        cloud.is_dense = false; // there may be invalid points
+
+        // Setup pointcloud fields
+        sensor_msgs::PointCloud2Modifier modifier(cloud);
+        modifier.setPointCloud2FieldsByString(1,"xyz");
+        modifier.resize(3*feats_msckf.size());
+
+        // Iterators
+        sensor_msgs::PointCloud2Iterator<float> out_x(cloud, "x");
+        sensor_msgs::PointCloud2Iterator<float> out_y(cloud, "y");
+        sensor_msgs::PointCloud2Iterator<float> out_z(cloud, "z");
+
+        // Fill our iterators
+        for(const auto &pt : feats_msckf) {
+            *out_x = pt(0); ++out_x;
+            *out_y = pt(1); ++out_y;
+            *out_z = pt(2); ++out_z;
+        }
 
-    // Iterators
-    sensor_msgs::PointCloud2Iterator<float> out_x(cloud, "x");
-    sensor_msgs::PointCloud2Iterator<float> out_y(cloud, "y");
-    sensor_msgs::PointCloud2Iterator<float> out_z(cloud, "z");
+        // Publish
+        pub_points_msckf.publish(cloud);
 
-    // Fill our iterators
-    for(const auto &pt : feats_msckf) {
-        *out_x = pt(0); ++out_x;
-        *out_y = pt(1); ++out_y;
-        *out_z = pt(2); ++out_z;
     }
 
-    // Publish
-    pub_points_msckf.publish(cloud);
-
     //====================================================================
     //====================================================================
 
-    // Get our good features
-    std::vector<Eigen::Vector3d> feats_slam = _app->get_features_SLAM();
-
-    // Declare message and sizes
-    sensor_msgs::PointCloud2 cloud_SLAM;
-    cloud_SLAM.header.frame_id = "global";
-    cloud_SLAM.header.stamp = ros::Time::now();
-    cloud_SLAM.width  = 3*feats_slam.size();
-    cloud_SLAM.height = 1;
-    cloud_SLAM.is_bigendian = false;
-    cloud_SLAM.is_dense = false; // there may be invalid points
-
-    // Setup pointcloud fields
-    sensor_msgs::PointCloud2Modifier modifier_SLAM(cloud_SLAM);
-    modifier_SLAM.setPointCloud2FieldsByString(1,"xyz");
-    modifier_SLAM.resize(3*feats_slam.size());
+    if(pub_points_slam.getNumSubscribers() > 0) {
+
+        // Get our good features
+        const std::vector<Eigen::Vector3d> &feats_slam = data.state->features_SLAM;
+
+        // Declare message and sizes
+        sensor_msgs::PointCloud2 cloud_SLAM;
+        cloud_SLAM.header.frame_id = "global";
+        cloud_SLAM.header.stamp = ros::Time::now();
+        cloud_SLAM.width  = 3*feats_slam.size();
+        cloud_SLAM.height = 1;
+        cloud_SLAM.is_bigendian = false;
+        cloud_SLAM.is_dense = false; // there may be invalid points
+
+        // Setup pointcloud fields
+        sensor_msgs::PointCloud2Modifier modifier_SLAM(cloud_SLAM);
+        modifier_SLAM.setPointCloud2FieldsByString(1,"xyz");
+        modifier_SLAM.resize(3*feats_slam.size());
+
+        // Iterators
+        sensor_msgs::PointCloud2Iterator<float> out_x_SLAM(cloud_SLAM, "x");
+        sensor_msgs::PointCloud2Iterator<float> out_y_SLAM(cloud_SLAM, "y");
+        sensor_msgs::PointCloud2Iterator<float> out_z_SLAM(cloud_SLAM, "z");
+
+        // Fill our iterators
+        for(const auto &pt : feats_slam) {
+            *out_x_SLAM = pt(0); ++out_x_SLAM;
+            *out_y_SLAM = pt(1); ++out_y_SLAM;
+            *out_z_SLAM = pt(2); ++out_z_SLAM;
+        }
 
-    // Iterators
-    sensor_msgs::PointCloud2Iterator<float> out_x_SLAM(cloud_SLAM, "x");
-    sensor_msgs::PointCloud2Iterator<float> out_y_SLAM(cloud_SLAM, "y");
-    sensor_msgs::PointCloud2Iterator<float> out_z_SLAM(cloud_SLAM, "z");
+        // Publish
+        pub_points_slam.publish(cloud_SLAM);
 
-    // Fill our iterators
-    for(const auto &pt : feats_slam) {
-        *out_x_SLAM = pt(0); ++out_x_SLAM;
-        *out_y_SLAM = pt(1); ++out_y_SLAM;
-        *out_z_SLAM = pt(2); ++out_z_SLAM;
     }
 
-    // Publish
-    pub_points_slam.publish(cloud_SLAM);
-
     //====================================================================
     //====================================================================
 
-    // Get our good features
-    std::vector<Eigen::Vector3d> feats_aruco = _app->get_features_ARUCO();
-
-    // Declare message and sizes
-    sensor_msgs::PointCloud2 cloud_ARUCO;
-    cloud_ARUCO.header.frame_id = "global";
-    cloud_ARUCO.header.stamp = ros::Time::now();
-    cloud_ARUCO.width  = 3*feats_aruco.size();
-    cloud_ARUCO.height = 1;
-    cloud_ARUCO.is_bigendian = false;
-    cloud_ARUCO.is_dense = false; // there may be invalid points
-
-    // Setup pointcloud fields
-    sensor_msgs::PointCloud2Modifier modifier_ARUCO(cloud_ARUCO);
-    modifier_ARUCO.setPointCloud2FieldsByString(1,"xyz");
-    modifier_ARUCO.resize(3*feats_aruco.size());
+    if(pub_points_aruco.getNumSubscribers() > 0) {
+
+        // Get our good features
+        const std::vector<Eigen::Vector3d> &feats_aruco = data.state->features_ARUCO;
+
+        // Declare message and sizes
+        sensor_msgs::PointCloud2 cloud_ARUCO;
+        cloud_ARUCO.header.frame_id = "global";
+        cloud_ARUCO.header.stamp = ros::Time::now();
+        cloud_ARUCO.width  = 3*feats_aruco.size();
+        cloud_ARUCO.height = 1;
+        cloud_ARUCO.is_bigendian = false;
+        cloud_ARUCO.is_dense = false; // there may be invalid points
+
+        // Setup pointcloud fields
+        sensor_msgs::PointCloud2Modifier modifier_ARUCO(cloud_ARUCO);
+        modifier_ARUCO.setPointCloud2FieldsByString(1,"xyz");
+        modifier_ARUCO.resize(3*feats_aruco.size());
+
+        // Iterators
+        sensor_msgs::PointCloud2Iterator<float> out_x_ARUCO(cloud_ARUCO, "x");
+        sensor_msgs::PointCloud2Iterator<float> out_y_ARUCO(cloud_ARUCO, "y");
+        sensor_msgs::PointCloud2Iterator<float> out_z_ARUCO(cloud_ARUCO, "z");
+
+        // Fill our iterators
+        for(const auto &pt : feats_aruco) {
+            *out_x_ARUCO = pt(0); ++out_x_ARUCO;
+            *out_y_ARUCO = pt(1); ++out_y_ARUCO;
+            *out_z_ARUCO = pt(2); ++out_z_ARUCO;
+        }
 
-    // Iterators
-    sensor_msgs::PointCloud2Iterator<float> out_x_ARUCO(cloud_ARUCO, "x");
-    sensor_msgs::PointCloud2Iterator<float> out_y_ARUCO(cloud_ARUCO, "y");
-    sensor_msgs::PointCloud2Iterator<float> out_z_ARUCO(cloud_ARUCO, "z");
+        // Publish
+        pub_points_aruco.publish(cloud_ARUCO);
 
-    // Fill our iterators
-    for(const auto &pt : feats_aruco) {
-        *out_x_ARUCO = pt(0); ++out_x_ARUCO;
-        *out_y_ARUCO = pt(1); ++out_y_ARUCO;
-        *out_z_ARUCO = pt(2); ++out_z_ARUCO;
     }
 
-    // Publish
-    pub_points_aruco.publish(cloud_ARUCO);
-
 
     //====================================================================
     //====================================================================
 
     // Skip the rest of we are not doing simulation
-    if(_sim == nullptr)
+    if(_sim == nullptr || pub_points_sim.getNumSubscribers() == 0)
         return;
 
     // Get our good features
@@ -540,31 +632,16 @@ void RosVisualizer::publish_features() {
 
 
 
-void RosVisualizer::publish_groundtruth() {
-
-    // Our groundtruth state
-    Eigen::Matrix<double,17,1> state_gt;
-
-    // We want to publish in the IMU clock frame
-    // The timestamp in the state will be the last camera time
-    double t_ItoC = _app->get_state()->_calib_dt_CAMtoIMU->value()(0);
-    double timestamp_inI = _app->get_state()->_timestamp + t_ItoC;
+void RosVisualizer::publish_groundtruth(const VisualizationData &data) {
 
-    // Check that we have the timestamp in our GT file [time(sec),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel]
-    if(_sim == nullptr && (gt_states.empty() || !DatasetReader::get_gt_state(timestamp_inI, state_gt, gt_states))) {
+    // Our groundtruth state in the IMU clock frame (this was looked up on the estimator thread)
+    if(!data.has_gt)
         return;
-    }
-
-    // Get the simulated groundtruth
-    // NOTE: we get the true time in the IMU clock frame
-    if(_sim != nullptr) {
-        timestamp_inI = _app->get_state()->_timestamp + _sim->get_true_paramters().calib_camimu_dt;
-        if(!_sim->get_state(timestamp_inI,state_gt))
-            return;
-    }
+    const Eigen::Matrix<double,17,1> &state_gt = data.state_gt;
+    double timestamp_inI = data.timestamp_gt;
 
     // Get the GT and system state state
-    Eigen::Matrix<double,16,1> state_ekf = _app->get_state()->_imu->value();
+    const Eigen::Matrix<double,16,1> &state_ekf = data.state->imu;
 
     // Create pose of IMU
     geometry_msgs::PoseStamped poseIinM;
@@ -578,32 +655,38 @@ void RosVisualizer::publish_groundtruth() {
     poseIinM.pose.position.x = state_gt(5,0);
     poseIinM.pose.position.y = state_gt(6,0);
     poseIinM.pose.position.z = state_gt(7,0);
-    pub_posegt.publish(poseIinM);
+    if(data.publish && pub_posegt.getNumSubscribers() > 0) {
+        pub_posegt.publish(poseIinM);
+    }
 
     // Append to our pose vector
     poses_gt.push_back(poseIinM);
 
     // Create our path (imu)
-    nav_msgs::Path arrIMU;
-    arrIMU.header.stamp = ros::Time::now();
-    arrIMU.header.seq = poses_seq_gt;
-    arrIMU.header.frame_id = "global";
-    arrIMU.poses = poses_gt;
-    pub_pathgt.publish(arrIMU);
+    if(data.publish && pub_pathgt.getNumSubscribers() > 0) {
+        nav_msgs::Path arrIMU;
+        arrIMU.header.stamp = ros::Time::now();
+        arrIMU.header.seq = poses_seq_gt;
+        arrIMU.header.frame_id = "global";
+        arrIMU.poses = poses_gt;
+        pub_pathgt.publish(arrIMU);
+    }
 
     // Move them forward in time
     poses_seq_gt++;
 
     // Publish our transform on TF
-    tf::StampedTransform trans;
-    trans.stamp_ = ros::Time::now();
-    trans.frame_id_ = "global";
-    trans.child_frame_id_ = "truth";
-    tf::Quaternion quat(state_gt(1,0),state_gt(2,0),state_gt(3,0),state_gt(4,0));
-    trans.setRotation(quat);
-    tf::Vector3 orig(state_gt(5,0),state_gt(6,0),state_gt(7,0));
-    trans.setOrigin(orig);
-    mTfBr->sendTransform(trans);
+    if(data.publish) {
+        tf::StampedTransform trans;
+        trans.stamp_ = ros::Time::now();
+        trans.frame_id_ = "global";
+        trans.child_frame_id_ = "truth";
+        tf::Quaternion quat(state_gt(1,0),state_gt(2,0),state_gt(3,0),state_gt(4,0));
+        trans.setRotation(quat);
+        tf::Vector3 orig(state_gt(5,0),state_gt(6,0),state_gt(7,0));
+        trans.setOrigin(orig);
+        mTfBr->sendTransform(trans);
+    }
 
     //==========================================================================
     //==========================================================================
@@ -626,10 +709,7 @@ void RosVisualizer::publish_groundtruth() {
     //==========================================================================
 
     // Get covariance of pose
-    std::vector<Type*> statevars;
-    statevars.push_back(_app->get_state()->_imu->q());
-    statevars.push_back(_app->get_state()->_imu->p());
-    Eigen::Matrix<double,6,6> covariance = StateHelper::get_marginal_covariance(_app->get_state(),statevars);
+    Eigen::Matrix<double,6,6> covariance = data.state->cov_imu.block(0,0,6,6);
 
     // Calculate NEES values
     double ori_nees = 2*quat_diff.block(0,0,3,1).dot(covariance.block(0,0,3,3).inverse()*2*quat_diff.block(0,0,3,1));
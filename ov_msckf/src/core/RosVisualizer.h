@@ -39,6 +39,11 @@
 #include <cv_bridge/cv_bridge.h>
 #include <boost/filesystem.hpp>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "VioManager.h"
 #include "sim/Simulator.h"
 #include "utils/dataset_reader.h"
@@ -56,6 +61,12 @@ namespace ov_msckf {
      * - Image of our tracker
      * - Our different features (SLAM, MSCKF, ARUCO)
      * - Groundtruth trajectory if we have it
+     *
+     * Publishing is done on a background thread so it does not add to the critical path of the estimator.
+     * After each update visualize() grabs the state snapshot published by the VioManager, which the publishing thread then works from.
+     * Everything which needs the trackers or simulator (track image and groundtruth) is grabbed on the estimator thread into this snapshot.
+     * Any message which has no subscribers is not constructed, while the path history and error statistics are always kept.
+     * If the publishing thread falls behind, the messages of the oldest snapshots are skipped, but they still extend our paths and statistics.
      */
     class RosVisualizer {
 
@@ -69,9 +80,17 @@ namespace ov_msckf {
          */
         RosVisualizer(ros::NodeHandle &nh, VioManager* app, Simulator* sim=nullptr);
 
+        /**
+         * @brief Destructor, will publish all remaining snapshots and stop our publishing thread
+         */
+        ~RosVisualizer();
+
 
         /**
          * @brief Will visualize the system if we have new things
+         *
+         * This should be called from the estimator thread after an update.
+         * It will take a snapshot of the estimator output and hand it to our publishing thread.
          */
         void visualize();
 
@@ -83,24 +102,48 @@ namespace ov_msckf {
         void visualize_odometry(double timestamp);
 
         /**
-         * @brief After the run has ended, print results
+         * @brief After the run has ended, print results (will wait for all snapshots to be published)
          */
         void visualize_final();
 
 
     protected:
 
+        /**
+         * @brief Estimator output at a single timestep which our publishing thread works from
+         */
+        struct VisualizationData {
+
+            /// Published state of the estimator
+            std::shared_ptr<const StateSnapshot> state;
+
+            /// Image of our track history (empty if nobody is subscribed)
+            cv::Mat img_history;
+
+            /// If we have a groundtruth state for this timestep, its timestamp in the imu clock, and the state itself
+            bool has_gt = false;
+            double timestamp_gt = -1;
+            Eigen::Matrix<double,17,1> state_gt;
+
+            /// If we should publish the messages of this timestep (false if we have fallen behind)
+            bool publish = true;
+
+        };
+
+        /// Main loop of our publishing thread
+        void thread_publish();
+
         /// Publish the current state
-        void publish_state();
+        void publish_state(const VisualizationData &data);
 
         /// Publish the active tracking image
-        void publish_images();
+        void publish_images(const VisualizationData &data);
 
         /// Publish current features
-        void publish_features();
+        void publish_features(const VisualizationData &data);
 
         /// Publish groundtruth (if we have it)
-        void publish_groundtruth();
+        void publish_groundtruth(const VisualizationData &data);
 
         /// Save current estimate state and groundtruth including calibration
         void sim_save_total_state_to_file();
@@ -153,6 +196,14 @@ namespace ov_msckf {
         bool save_total_state;
         std::ofstream of_state_est, of_state_std, of_state_gt;
 
+        // Snapshots waiting to be published, and the thread which publishes them
+        std::deque<VisualizationData> queue_viz;
+        std::mutex mtx_viz;
+        std::condition_variable cv_viz_new, cv_viz_done;
+        bool viz_publishing = false;
+        bool viz_shutdown = false;
+        std::thread thread_viz;
+
     };
 
 
@@ -46,8 +46,23 @@ VioManager::VioManager(VioManagerOptions& params_) {
     params.print_state();
     params.print_trackers();
 
+    // Create our shared worker pool, and limit OpenCV so the two do not oversubscribe the cores
+    // If our pool has workers then they already use the cores, so by default OpenCV should not spawn its own
+    ThreadPool::configure(params.num_threads, params.pin_threads);
+    if(params.num_opencv_threads >= 0) {
+        cv::setNumThreads(params.num_opencv_threads);
+    } else if(ThreadPool::instance()->size() > 0) {
+        cv::setNumThreads(1);
+    }
+
     // Create the state!!
     state = new State(params.state_options);
+    std::atomic_store(&state_snapshot, std::shared_ptr<const StateSnapshot>(new StateSnapshot()));
+
+    // Our history of poses
+    if(params.pose_history_size > 0) {
+        pose_history = new PoseHistory((size_t)params.pose_history_size);
+    }
 
     // Timeoffset from camera to IMU
     Eigen::VectorXd temp_camimu_dt;
@@ -104,13 +119,13 @@ VioManager::VioManager(VioManagerOptions& params_) {
         trackFEATS = new TrackKLT(params.num_pts,state->_options.max_aruco_features,params.fast_threshold,params.grid_x,params.grid_y,params.min_px_dist);
         trackFEATS->set_calibration(params.camera_intrinsics, params.camera_fisheye);
     } else {
-        trackFEATS = new TrackDescriptor(params.num_pts,state->_options.max_aruco_features,params.fast_threshold,params.grid_x,params.grid_y,params.knn_ratio);
+        trackFEATS = new TrackDescriptor(params.num_pts,state->_options.max_aruco_features,params.fast_threshold,params.grid_x,params.grid_y,params.knn_ratio,params.knn_window);
         trackFEATS->set_calibration(params.camera_intrinsics, params.camera_fisheye);
     }
 
     // Initialize our aruco tag extractor
     if(params.use_aruco) {
-        trackARUCO = new TrackAruco(state->_options.max_aruco_features, params.downsize_aruco);
+        trackARUCO = new TrackAruco(state->_options.max_aruco_features, params.downsize_aruco, params.aruco_detect_interval);
         trackARUCO->set_calibration(params.camera_intrinsics, params.camera_fisheye);
     }
 
@@ -121,14 +136,76 @@ VioManager::VioManager(VioManagerOptions& params_) {
     initializer = new InertialInitializer(params.gravity,params.init_window_time,params.init_imu_thresh);
 
     // Make the updater!
-    updaterMSCKF = new UpdaterMSCKF(params.msckf_options,params.featinit_options);
-    updaterSLAM = new UpdaterSLAM(params.slam_options,params.aruco_options,params.featinit_options);
+    updaterMSCKF = new UpdaterMSCKF(params.msckf_options,params.featinit_options,params.state_options);
+    updaterSLAM = new UpdaterSLAM(params.slam_options,params.aruco_options,params.featinit_options,params.state_options);
+
+    // Monitor for our calibration convergence if we want to freeze it
+    if(params.state_options.do_calib_freeze) {
+        calibMonitor = new CalibrationMonitor(params.state_options);
+    }
 
     // Init timing info
     total_images = 0;
     total_tracking_time = 0.0;
     total_filter_time = 0.0;
     total_frame_time = 0.0;
+
+    // Warm restart from our last snapshot if we have one
+    if(!params.snapshot_path.empty() && boost::filesystem::exists(params.snapshot_path)) {
+        load_snapshot(params.snapshot_path);
+    }
+}
+
+
+
+
+bool VioManager::save_snapshot(const std::string &path) {
+
+    // Nothing to save if we have not initialized yet
+    if(!is_initialized_vio) {
+        printf(YELLOW "[SNAPSHOT]: system is not initialized, not saving a snapshot\n" RESET);
+        return false;
+    }
+    return VioSnapshot::save(path, state, propagator, trackFEATS, trackARUCO, startup_time);
+
+}
+
+
+
+
+bool VioManager::load_snapshot(const std::string &path) {
+
+    // We can only restore if we have not started to estimate yet
+    if(is_initialized_vio) {
+        printf(YELLOW "[SNAPSHOT]: system is already initialized, not loading a snapshot\n" RESET);
+        return false;
+    }
+    if(!VioSnapshot::load(path, state, propagator, trackFEATS, trackARUCO, startup_time)) {
+        return false;
+    }
+    is_initialized_vio = true;
+    last_snapshot_time = state->_timestamp;
+
+    // Our trackers should normalize with the restored calibration
+    std::map<size_t, Eigen::VectorXd> cameranew_calib;
+    std::map<size_t, bool> cameranew_fisheye;
+    for(int i=0; i<state->_options.num_cameras; i++) {
+        cameranew_calib.insert({i,state->_cam_intrinsics.at(i)->value()});
+        cameranew_fisheye.insert({i,state->_cam_intrinsics_model.at(i)});
+    }
+    trackFEATS->set_calibration(cameranew_calib, cameranew_fisheye, true);
+    if(trackARUCO != nullptr) {
+        trackARUCO->set_calibration(cameranew_calib, cameranew_fisheye, true);
+    }
+
+    // Print what we init'ed with
+    publish_state_snapshot();
+    printf(GREEN "[INIT]: INITIALIZED FROM SNAPSHOT!!!!!\n" RESET);
+    printf(GREEN "[INIT]: orientation = %.4f, %.4f, %.4f, %.4f\n" RESET,state->_imu->quat()(0),state->_imu->quat()(1),state->_imu->quat()(2),state->_imu->quat()(3));
+    printf(GREEN "[INIT]: velocity = %.4f, %.4f, %.4f\n" RESET,state->_imu->vel()(0),state->_imu->vel()(1),state->_imu->vel()(2));
+    printf(GREEN "[INIT]: position = %.4f, %.4f, %.4f\n" RESET,state->_imu->pos()(0),state->_imu->pos()(1),state->_imu->pos()(2));
+    return true;
+
 }
 
 
@@ -144,6 +221,18 @@ void VioManager::feed_measurement_imu(double timestamp, Eigen::Vector3d wm, Eige
         initializer->feed_imu(timestamp, wm, am);
     }
 
+    // Record the IMU propagated pose into our history
+    // We propagate to the previous reading, as this newest one is needed to finish the integration to that time
+    if(pose_history != nullptr && params.pose_history_propagate && is_initialized_vio) {
+        double t_off = state->_calib_dt_CAMtoIMU->value()(0);
+        if(last_imu_time > state->_timestamp+t_off) {
+            Eigen::Matrix<double,13,1> state_plus = Eigen::Matrix<double,13,1>::Zero();
+            propagator->fast_state_propagate(state, last_imu_time-t_off, state_plus);
+            pose_history->feed_propagated(last_imu_time, state_plus.block(0,0,4,1), state_plus.block(4,0,3,1));
+        }
+    }
+    last_imu_time = timestamp;
+
 }
 
 
@@ -190,10 +279,10 @@ void VioManager::feed_measurement_stereo(double timestamp, cv::Mat& img0, cv::Ma
     if(params.use_stereo) {
         trackFEATS->feed_stereo(timestamp, img0, img1, cam_id0, cam_id1);
     } else {
-        boost::thread t_l = boost::thread(&TrackBase::feed_monocular, trackFEATS, boost::ref(timestamp), boost::ref(img0), boost::ref(cam_id0));
-        boost::thread t_r = boost::thread(&TrackBase::feed_monocular, trackFEATS, boost::ref(timestamp), boost::ref(img1), boost::ref(cam_id1));
-        t_l.join();
-        t_r.join();
+        std::future<void> t_l = ThreadPool::instance()->enqueue([&]{ trackFEATS->feed_monocular(timestamp, img0, cam_id0); });
+        std::future<void> t_r = ThreadPool::instance()->enqueue([&]{ trackFEATS->feed_monocular(timestamp, img1, cam_id1); });
+        t_l.get();
+        t_r.get();
     }
 
     // If aruoc is avalible, the also pass to it
@@ -295,6 +384,7 @@ bool VioManager::try_to_initialize() {
     printf(GREEN "[INIT]: velocity = %.4f, %.4f, %.4f\n" RESET,state->_imu->vel()(0),state->_imu->vel()(1),state->_imu->vel()(2));
     printf(GREEN "[INIT]: bias accel = %.4f, %.4f, %.4f\n" RESET,state->_imu->bias_a()(0),state->_imu->bias_a()(1),state->_imu->bias_a()(2));
     printf(GREEN "[INIT]: position = %.4f, %.4f, %.4f\n" RESET,state->_imu->pos()(0),state->_imu->pos()(1),state->_imu->pos()(2));
+    publish_state_snapshot();
     return true;
 
 }
@@ -324,6 +414,7 @@ void VioManager::do_feature_propagate_update(double timestamp) {
     // We can start processing things when we have at least 5 clones since we can start triangulating things...
     if((int)state->_clones_IMU.size() < std::min(state->_options.max_clone_size,5)) {
         printf("waiting for enough clone states (%d of %d)....\n",(int)state->_clones_IMU.size(),std::min(state->_options.max_clone_size,5));
+        publish_state_snapshot();
         return;
     }
 
@@ -448,10 +539,10 @@ void VioManager::do_feature_propagate_update(double timestamp) {
 
 
     // Pass them to our MSCKF updater
-    // NOTE: if we have more then the max, we select the "best" ones (i.e. max tracks) for this update
+    // NOTE: if we have more then the max, we select the "best" ones (i.e. informative and spread out) for this update
     // NOTE: this should only really be used if you want to track a lot of features, or have limited computational resources
     if((int)featsup_MSCKF.size() > state->_options.max_msckf_in_update)
-        featsup_MSCKF.erase(featsup_MSCKF.begin(), featsup_MSCKF.end()-state->_options.max_msckf_in_update);
+        UpdaterHelper::select_features_inplace(state, featsup_MSCKF, state->_options.max_msckf_in_update);
     updaterMSCKF->update(state, featsup_MSCKF);
     rT4 =  boost::posix_time::microsec_clock::local_time();
 
@@ -529,6 +620,11 @@ void VioManager::do_feature_propagate_update(double timestamp) {
             trackARUCO->set_calibration(cameranew_calib, cameranew_fisheye, true);
         }
     }
+
+    // Freeze any calibration that has converged (will be removed from the state)
+    if(calibMonitor != nullptr) {
+        calibMonitor->feed(state);
+    }
     rT7 =  boost::posix_time::microsec_clock::local_time();
 
 
@@ -592,6 +688,15 @@ void VioManager::do_feature_propagate_update(double timestamp) {
     }
     timelastupdate = timestamp;
 
+    // Publish our new state to any readers
+    publish_state_snapshot();
+
+    // Periodically save a snapshot so we can warm restart after a crash
+    if(!params.snapshot_path.empty() && params.snapshot_interval > 0 && state->_timestamp-last_snapshot_time >= params.snapshot_interval) {
+        save_snapshot(params.snapshot_path);
+        last_snapshot_time = state->_timestamp;
+    }
+
     // Debug, print our current state
     printf("q_GtoI = %.3f,%.3f,%.3f,%.3f | p_IinG = %.3f,%.3f,%.3f | dist = %.2f (meters)\n",
             state->_imu->quat()(0),state->_imu->quat()(1),state->_imu->quat()(2),state->_imu->quat()(3),
@@ -633,21 +738,68 @@ void VioManager::do_feature_propagate_update(double timestamp) {
 
 
 
+void VioManager::publish_state_snapshot() {
 
+    // Our new snapshot
+    std::shared_ptr<StateSnapshot> snapshot(new StateSnapshot());
+    snapshot->initialized = is_initialized_vio;
+    snapshot->timestamp = state->_timestamp;
+    snapshot->timestamp_inI = state->_timestamp + state->_calib_dt_CAMtoIMU->value()(0);
 
+    // IMU state and its marginal covariance
+    snapshot->imu = state->_imu->value();
+    std::vector<Type*> statevars;
+    statevars.push_back(state->_imu);
+    snapshot->cov_imu = StateHelper::get_marginal_covariance(state, statevars);
 
+    // Calibration
+    snapshot->calib_dt_CAMtoIMU = state->_calib_dt_CAMtoIMU->value()(0);
+    for(int i=0; i<state->_options.num_cameras; i++) {
+        snapshot->calib_IMUtoCAM.insert({i, state->_calib_IMUtoCAM.at(i)->value()});
+        snapshot->cam_intrinsics.insert({i, state->_cam_intrinsics.at(i)->value()});
+    }
+
+    // Clones and their marginal covariance
+    for(const auto &clone : state->_clones_IMU) {
+        snapshot->clones_IMU.insert({clone.first, clone.second->value()});
+        statevars.clear();
+        statevars.push_back(clone.second);
+        snapshot->clones_cov.insert({clone.first, StateHelper::get_marginal_covariance(state, statevars)});
+    }
+
+    // Features in the global frame
+    snapshot->features_MSCKF = good_features_MSCKF;
+    for(const auto &f : state->_features_SLAM) {
+        Eigen::Vector3d p_FinG;
+        if(LandmarkRepresentation::is_relative_representation(f.second->_feat_representation)) {
+            // Assert that we have an anchor pose for this feature
+            assert(f.second->_anchor_cam_id!=-1);
+            // Get calibration for our anchor camera
+            Eigen::Matrix<double, 3, 3> R_ItoC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->Rot();
+            Eigen::Matrix<double, 3, 1> p_IinC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->pos();
+            // Anchor pose orientation and position
+            Eigen::Matrix<double,3,3> R_GtoI = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->Rot();
+            Eigen::Matrix<double,3,1> p_IinG = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->pos();
+            // Feature in the global frame
+            p_FinG = R_GtoI.transpose() * R_ItoC.transpose()*(f.second->get_xyz(false) - p_IinC) + p_IinG;
+        } else {
+            p_FinG = f.second->get_xyz(false);
+        }
+        if((int)f.first <= state->_options.max_aruco_features) {
+            snapshot->features_ARUCO.push_back(p_FinG);
+        } else {
+            snapshot->features_SLAM.push_back(p_FinG);
+        }
+    }
 
+    // Record the poses into our history
+    if(pose_history != nullptr) {
+        pose_history->feed_snapshot(*snapshot);
+    }
 
+    // Finally swap it in, any reader still holding the old one keeps it alive until they are done
+    std::atomic_store(&state_snapshot, std::shared_ptr<const StateSnapshot>(snapshot));
 
-
-
-
-
-
-
-
-
-
-
+}
 
 
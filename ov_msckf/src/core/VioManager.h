@@ -25,6 +25,7 @@
 #include <string>
 #include <algorithm>
 #include <fstream>
+#include <memory>
 #include <Eigen/StdVector>
 #include <boost/filesystem.hpp>
 
@@ -39,10 +40,14 @@
 #include "state/Propagator.h"
 #include "state/State.h"
 #include "state/StateHelper.h"
+#include "state/StateSnapshot.h"
+#include "state/PoseHistory.h"
+#include "state/CalibrationMonitor.h"
 #include "update/UpdaterMSCKF.h"
 #include "update/UpdaterSLAM.h"
 
 #include "VioManagerOptions.h"
+#include "VioSnapshot.h"
 
 
 namespace ov_msckf {
@@ -121,6 +126,7 @@ namespace ov_msckf {
             if(trackARUCO != nullptr) {
                 trackARUCO->get_feature_database()->cleanup_measurements(state->_timestamp);
             }
+            publish_state_snapshot();
 
             // Print what we init'ed with
             printf(GREEN "[INIT]: INITIALIZED FROM GROUNDTRUTH FILE!!!!!\n" RESET);
@@ -133,6 +139,28 @@ namespace ov_msckf {
         }
 
 
+        /**
+         * @brief Will save the full estimator into a binary snapshot
+         *
+         * This includes the state with its covariance, the buffered inertial readings, and the feature databases of the trackers.
+         * See VioSnapshot for details on what is saved.
+         *
+         * @param path Path to the binary file we will write to
+         * @return True if we have successfully saved the snapshot
+         */
+        bool save_snapshot(const std::string &path);
+
+        /**
+         * @brief Will restore the full estimator from a binary snapshot and skip initialization
+         *
+         * This should be called before any measurements have been processed.
+         * Since we propagate from the snapshot time, the snapshot should be recent and the IMU data should continue from it.
+         *
+         * @param path Path to the binary file we will read
+         * @return True if we have successfully restored the snapshot
+         */
+        bool load_snapshot(const std::string &path);
+
         /// If we are initialized or not
         bool initialized() {
             return is_initialized_vio;
@@ -153,6 +181,17 @@ namespace ov_msckf {
             return propagator;
         }
 
+        /**
+         * @brief Will re-enable online estimation of any calibration that has been frozen after convergence
+         *
+         * Only has an effect if the calibration freezing is enabled (see StateOptions::do_calib_freeze).
+         */
+        void reenable_calibration() {
+            if(calibMonitor != nullptr) {
+                calibMonitor->unfreeze(state);
+            }
+        }
+
         /// Get feature tracker
         TrackBase* get_track_feat() {
             return trackFEATS;
@@ -163,55 +202,41 @@ namespace ov_msckf {
             return trackARUCO;
         }
 
+        /**
+         * @brief Gets the estimator output published after the last update
+         *
+         * This can be called from any thread without blocking the filter.
+         * The returned snapshot will never change, thus a reader can hold on to it as long as it wants.
+         *
+         * @return Immutable snapshot of the state
+         */
+        std::shared_ptr<const StateSnapshot> get_state_snapshot() {
+            return std::atomic_load(&state_snapshot);
+        }
+
+        /**
+         * @brief Gets our history of poses which can be queried at any recent timestamp
+         *
+         * This is safe to query from any thread, and will be a nullptr if disabled (see VioManagerOptions::pose_history_size).
+         * @return Pose history
+         */
+        PoseHistory* get_pose_history() {
+            return pose_history;
+        }
+
         /// Returns 3d features used in the last update in global frame
         std::vector<Eigen::Vector3d> get_good_features_MSCKF() {
-            return good_features_MSCKF;
+            return get_state_snapshot()->features_MSCKF;
         }
 
         /// Returns 3d SLAM features in the global frame
         std::vector<Eigen::Vector3d> get_features_SLAM() {
-            std::vector<Eigen::Vector3d> slam_feats;
-            for (auto &f : state->_features_SLAM) {
-                if((int)f.first <= state->_options.max_aruco_features) continue;
-                if(LandmarkRepresentation::is_relative_representation(f.second->_feat_representation)) {
-                    // Assert that we have an anchor pose for this feature
-                    assert(f.second->_anchor_cam_id!=-1);
-                    // Get calibration for our anchor camera
-                    Eigen::Matrix<double, 3, 3> R_ItoC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->Rot();
-                    Eigen::Matrix<double, 3, 1> p_IinC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->pos();
-                    // Anchor pose orientation and position
-                    Eigen::Matrix<double,3,3> R_GtoI = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->Rot();
-                    Eigen::Matrix<double,3,1> p_IinG = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->pos();
-                    // Feature in the global frame
-                    slam_feats.push_back(R_GtoI.transpose() * R_ItoC.transpose()*(f.second->get_xyz(false) - p_IinC) + p_IinG);
-                } else {
-                    slam_feats.push_back(f.second->get_xyz(false));
-                }
-            }
-            return slam_feats;
+            return get_state_snapshot()->features_SLAM;
         }
 
         /// Returns 3d ARUCO features in the global frame
         std::vector<Eigen::Vector3d> get_features_ARUCO() {
-            std::vector<Eigen::Vector3d> aruco_feats;
-            for (auto &f : state->_features_SLAM) {
-                if((int)f.first > state->_options.max_aruco_features) continue;
-                if(LandmarkRepresentation::is_relative_representation(f.second->_feat_representation)) {
-                    // Assert that we have an anchor pose for this feature
-                    assert(f.second->_anchor_cam_id!=-1);
-                    // Get calibration for our anchor camera
-                    Eigen::Matrix<double, 3, 3> R_ItoC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->Rot();
-                    Eigen::Matrix<double, 3, 1> p_IinC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->pos();
-                    // Anchor pose orientation and position
-                    Eigen::Matrix<double,3,3> R_GtoI = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->Rot();
-                    Eigen::Matrix<double,3,1> p_IinG = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->pos();
-                    // Feature in the global frame
-                    aruco_feats.push_back(R_GtoI.transpose() * R_ItoC.transpose()*(f.second->get_xyz(false) - p_IinC) + p_IinG);
-                } else {
-                    aruco_feats.push_back(f.second->get_xyz(false));
-                }
-            }
-            return aruco_feats;
+            return get_state_snapshot()->features_ARUCO;
         }
 
 
@@ -236,6 +261,14 @@ namespace ov_msckf {
          */
         void do_feature_propagate_update(double timestamp);
 
+        /**
+         * @brief Will copy the current state into a new snapshot and atomically publish it to readers
+         *
+         * This should be called from the thread which is running the filter, after the state has changed.
+         * The landmarks are converted into the global frame once here, instead of every time they are requested.
+         */
+        void publish_state_snapshot();
+
         /// Manager parameters
         VioManagerOptions params;
 
@@ -263,9 +296,21 @@ namespace ov_msckf {
         /// Our MSCKF feature updater
         UpdaterSLAM* updaterSLAM;
 
+        /// Monitor which freezes the calibration once converged (nullptr if disabled)
+        CalibrationMonitor* calibMonitor = nullptr;
+
         /// Good features that where used in the last update
         std::vector<Eigen::Vector3d> good_features_MSCKF;
 
+        /// Latest published snapshot of our state (only access with the std::atomic_load/store functions)
+        std::shared_ptr<const StateSnapshot> state_snapshot;
+
+        /// History of our filter, clone, and propagated poses
+        PoseHistory* pose_history = nullptr;
+
+        /// Timestamp of the last IMU reading we have received
+        double last_imu_time = -1;
+
         // Timing statistic file and variables
         std::ofstream of_statistics;
         boost::posix_time::ptime rT1, rT2, rT3, rT4, rT5, rT6, rT7;
@@ -281,6 +326,9 @@ namespace ov_msckf {
         // Startup time of the filter
         double startup_time = -1;
 
+        // Time of the last periodic snapshot
+        double last_snapshot_time = -1;
+
 
     };
 
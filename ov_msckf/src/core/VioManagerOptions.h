@@ -75,6 +75,18 @@ namespace ov_msckf {
         /// The path to the file we will record the timing information into
         std::string record_timing_filepath = "ov_msckf_timing.txt";
 
+        /// Path to the estimator snapshot we restore from on startup and save into (empty to disable)
+        std::string snapshot_path = "";
+
+        /// How often, in seconds of data, we should save a snapshot while running (zero to disable)
+        double snapshot_interval = 0.0;
+
+        /// Max number of poses we keep in our history for timestamp queries (zero to disable)
+        int pose_history_size = 1000;
+
+        /// If we should record an IMU propagated pose into our history for every IMU reading after the last update
+        bool pose_history_propagate = false;
+
         /**
          * @brief This function will print out all estimator settings loaded.
          * This allows for visual checking that everything was loaded properly from ROS/CMD parsers.
@@ -88,6 +100,10 @@ namespace ov_msckf {
             printf("\t- init_imu_thresh: %.2f\n", init_imu_thresh);
             printf("\t- record timing?: %d\n", (int)record_timing_information);
             printf("\t- record timing filepath: %s\n", record_timing_filepath.c_str());
+            printf("\t- snapshot path: %s\n", snapshot_path.c_str());
+            printf("\t- snapshot interval: %.2f\n", snapshot_interval);
+            printf("\t- pose history size: %d\n", pose_history_size);
+            printf("\t- pose history propagate?: %d\n", (int)pose_history_propagate);
         }
 
         // NOISE / CHI2 ============================
@@ -172,6 +188,9 @@ namespace ov_msckf {
         /// Will half the resolution of the aruco tag image (will be faster)
         bool downsize_aruco = true;
 
+        /// We will do a full aruco tag detection every this many frames, and track the tags with KLT in between
+        int aruco_detect_interval = 1;
+
         /// The number of points we should extract and track in *each* image frame. This highly effects the computation required for tracking.
         int num_pts = 150;
 
@@ -190,9 +209,21 @@ namespace ov_msckf {
         /// KNN ration between top two descriptor matcher which is required to be a good match
         double knn_ratio = 0.85;
 
+        /// Half size in pixels of the window we search for descriptor matches around the previous location (non-positive will brute force match)
+        int knn_window = -1;
+
         /// Parameters used by our feature initialize / triangulator
         FeatureInitializerOptions featinit_options;
 
+        /// Number of worker threads in our shared pool (negative will use all hardware threads, zero runs everything inline)
+        int num_threads = -1;
+
+        /// If we should pin each worker thread of our pool to a single core
+        bool pin_threads = false;
+
+        /// Number of threads OpenCV can use internally (negative will use one if our pool has workers, otherwise the OpenCV default)
+        int num_opencv_threads = -1;
+
         /**
          * @brief This function will print out all parameters releated to our visual trackers.
          */
@@ -200,6 +231,11 @@ namespace ov_msckf {
             printf("FEATURE TRACKING PARAMETERS:\n");
             printf("\t- num_pts: %d\n", num_pts);
             printf("\t- use_stereo: %d\n", use_stereo);
+            printf("\t- knn_window: %d\n", knn_window);
+            printf("\t- aruco_detect_interval: %d\n", aruco_detect_interval);
+            printf("\t- num_threads: %d\n", num_threads);
+            printf("\t- pin_threads: %d\n", pin_threads);
+            printf("\t- num_opencv_threads: %d\n", num_opencv_threads);
             featinit_options.print();
         }
 
@@ -229,6 +265,9 @@ namespace ov_msckf {
         /// If we should perturb the calibration that the estimator starts with
         bool sim_do_perturbation = false;
 
+        /// Path to a binary recording of the simulated measurements. If it exists and matches our config it will be replayed, otherwise it is generated.
+        string sim_stream_path = "";
+
         /**
          * @brief This function will print out all simulated parameters loaded.
          * This allows for visual checking that everything was loaded properly from ROS/CMD parsers.
@@ -242,6 +281,7 @@ namespace ov_msckf {
             printf("\t- dist thresh: %.2f\n", sim_distance_threshold);
             printf("\t- cam feq: %.2f\n", sim_freq_cam);
             printf("\t- imu feq: %.2f\n", sim_freq_imu);
+            printf("\t- stream path: %s\n", sim_stream_path.c_str());
         }
 
 
@@ -0,0 +1,500 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "VioSnapshot.h"
+
+
+using namespace ov_core;
+using namespace ov_msckf;
+
+
+/// Magic bytes at the start of each snapshot, and the version of the format
+static const char SNAPSHOT_MAGIC[8] = {'O','V','S','N','A','P','S','T'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+
+
+bool VioSnapshot::save(const std::string &path, State *state, Propagator *propagator,
+                       TrackBase *trackFEATS, TrackBase *trackARUCO, double startup_time) {
+
+    // Write to a temporary file first, so a crash while saving will not corrupt the last good snapshot
+    std::string path_tmp = path + ".tmp";
+    std::ofstream file(path_tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file) {
+        printf(RED "[SNAPSHOT]: Unable to open %s for writing\n" RESET, path_tmp.c_str());
+        return false;
+    }
+
+    // Header
+    file.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    write(file, SNAPSHOT_VERSION);
+    write(file, (uint32_t)state->_options.num_cameras);
+    write(file, startup_time);
+    write(file, state->_timestamp);
+
+    // Calibration flags (these can change online if the calibration has been frozen)
+    write(file, (uint8_t)state->_options.do_calib_camera_timeoffset);
+    write(file, (uint8_t)state->_options.do_calib_camera_pose);
+    write(file, (uint8_t)state->_options.do_calib_camera_intrinsics);
+
+    // IMU and calibration, which always exist even if they are not estimated
+    write_type(file, state->_imu);
+    write_type(file, state->_calib_dt_CAMtoIMU);
+    for(int i=0; i<state->_options.num_cameras; i++) {
+        write(file, (uint8_t)state->_cam_intrinsics_model.at(i));
+        write_type(file, state->_calib_IMUtoCAM.at(i));
+        write_type(file, state->_cam_intrinsics.at(i));
+    }
+
+    // Clones in our sliding window
+    write(file, (uint32_t)state->_clones_IMU.size());
+    for(const auto &clone : state->_clones_IMU) {
+        write(file, clone.first);
+        write_type(file, clone.second);
+    }
+
+    // SLAM features
+    write(file, (uint32_t)state->_features_SLAM.size());
+    for(const auto &feat : state->_features_SLAM) {
+        Landmark *landmark = feat.second;
+        write(file, (uint64_t)landmark->_featid);
+        write(file, (int32_t)landmark->_anchor_cam_id);
+        write(file, landmark->_anchor_clone_timestamp);
+        write(file, (uint8_t)landmark->has_had_anchor_change);
+        write(file, (uint8_t)landmark->should_marg);
+        write(file, (int32_t)landmark->_feat_representation);
+        for(int i=0; i<3; i++)
+            write(file, landmark->uv_norm_zero(i));
+        for(int i=0; i<3; i++)
+            write(file, landmark->uv_norm_zero_fej(i));
+        write_type(file, landmark);
+    }
+
+    // Ordering of the variables in the covariance
+    // Each variable is identified by its type and a key (camera id, clone time, or feature id)
+    write(file, (uint32_t)state->_variables.size());
+    for(Type *var : state->_variables) {
+        uint8_t type = 255;
+        double key = 0;
+        if(var == state->_imu) {
+            type = VAR_IMU;
+        } else if(var == state->_calib_dt_CAMtoIMU) {
+            type = VAR_TIMEOFFSET;
+        }
+        for(const auto &calib : state->_calib_IMUtoCAM) {
+            if(var == calib.second) {
+                type = VAR_EXTRINSIC;
+                key = (double)calib.first;
+            }
+        }
+        for(const auto &calib : state->_cam_intrinsics) {
+            if(var == calib.second) {
+                type = VAR_INTRINSIC;
+                key = (double)calib.first;
+            }
+        }
+        for(const auto &clone : state->_clones_IMU) {
+            if(var == clone.second) {
+                type = VAR_CLONE;
+                key = clone.first;
+            }
+        }
+        for(const auto &feat : state->_features_SLAM) {
+            if(var == feat.second) {
+                type = VAR_LANDMARK;
+                key = (double)feat.first;
+            }
+        }
+        if(type == 255) {
+            printf(RED "[SNAPSHOT]: Unknown variable of size %d in the state, unable to save\n" RESET, var->size());
+            file.close();
+            std::remove(path_tmp.c_str());
+            return false;
+        }
+        write(file, type);
+        write(file, key);
+        write(file, (int32_t)var->id());
+    }
+
+    // Full covariance
+    write_matrix(file, state->_Cov);
+
+    // Inertial readings of the propagator
+    std::vector<Propagator::IMUDATA> imu_data;
+    double time_offset;
+    bool have_time_offset = propagator->get_imu_buffer(imu_data, time_offset);
+    write(file, (uint8_t)have_time_offset);
+    write(file, time_offset);
+    write(file, (uint64_t)imu_data.size());
+    for(const Propagator::IMUDATA &data : imu_data) {
+        write(file, data.timestamp);
+        for(int i=0; i<3; i++)
+            write(file, data.wm(i));
+        for(int i=0; i<3; i++)
+            write(file, data.am(i));
+    }
+
+    // Feature trackers
+    write_tracker(file, trackFEATS);
+    write_tracker(file, trackARUCO);
+
+    // Done, make sure everything was written then move it into place
+    file.close();
+    if(file.fail() || std::rename(path_tmp.c_str(), path.c_str()) != 0) {
+        printf(RED "[SNAPSHOT]: Failed writing to %s\n" RESET, path.c_str());
+        std::remove(path_tmp.c_str());
+        return false;
+    }
+    printf("[SNAPSHOT]: saved %d clones and %d SLAM features at %.3f to %s\n",
+           (int)state->_clones_IMU.size(),(int)state->_features_SLAM.size(),state->_timestamp,path.c_str());
+    return true;
+
+}
+
+
+
+bool VioSnapshot::load(const std::string &path, State *state, Propagator *propagator,
+                       TrackBase *trackFEATS, TrackBase *trackARUCO, double &startup_time) {
+
+    // We can only restore into a state that was just constructed
+    if(!state->_clones_IMU.empty() || !state->_features_SLAM.empty()) {
+        printf(RED "[SNAPSHOT]: The state already has clones or features, unable to restore\n" RESET);
+        return false;
+    }
+
+    // Open the file
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if(!file) {
+        printf(YELLOW "[SNAPSHOT]: Unable to open %s\n" RESET, path.c_str());
+        return false;
+    }
+
+    // Check the header
+    char magic[8];
+    uint32_t version, num_cameras;
+    file.read(magic, sizeof(magic));
+    if(!file || std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || !read(file, version) || version != SNAPSHOT_VERSION) {
+        printf(YELLOW "[SNAPSHOT]: %s is not a valid snapshot (or an older version)\n" RESET, path.c_str());
+        return false;
+    }
+    if(!read(file, num_cameras) || (int)num_cameras != state->_options.num_cameras) {
+        printf(YELLOW "[SNAPSHOT]: %s was saved with %d cameras but we have %d\n" RESET, path.c_str(), (int)num_cameras, state->_options.num_cameras);
+        return false;
+    }
+
+    // Everything is read into temporaries first, so nothing is changed if the file is invalid
+    bool success = true;
+    double file_startup_time, timestamp;
+    uint8_t calib_dt, calib_pose, calib_intrinsics;
+    success = success && read(file, file_startup_time) && read(file, timestamp);
+    success = success && read(file, calib_dt) && read(file, calib_pose) && read(file, calib_intrinsics);
+
+    // IMU and calibration
+    Eigen::MatrixXd imu_value, imu_fej, dt_value, dt_fej;
+    std::vector<uint8_t> cam_models(num_cameras);
+    std::vector<Eigen::MatrixXd> extrin_value(num_cameras), extrin_fej(num_cameras), intrin_value(num_cameras), intrin_fej(num_cameras);
+    success = success && read_type(file, imu_value, imu_fej) && imu_value.rows() == 16;
+    success = success && read_type(file, dt_value, dt_fej) && dt_value.rows() == 1;
+    for(size_t i=0; success && i<num_cameras; i++) {
+        success = success && read(file, cam_models.at(i));
+        success = success && read_type(file, extrin_value.at(i), extrin_fej.at(i)) && extrin_value.at(i).rows() == 7;
+        success = success && read_type(file, intrin_value.at(i), intrin_fej.at(i)) && intrin_value.at(i).rows() == 8;
+    }
+
+    // Clones and SLAM features, which are newly allocated
+    std::map<double, PoseJPL*> clones;
+    std::unordered_map<size_t, Landmark*> features;
+    uint32_t num_clones = 0, num_features = 0;
+    success = success && read(file, num_clones);
+    for(size_t i=0; success && i<num_clones; i++) {
+        double clone_time;
+        Eigen::MatrixXd value, fej;
+        success = success && read(file, clone_time) && read_type(file, value, fej) && value.rows() == 7 && fej.rows() == 7;
+        if(success) {
+            PoseJPL *pose = new PoseJPL();
+            pose->set_value(value);
+            pose->set_fej(fej);
+            clones.insert({clone_time, pose});
+        }
+    }
+    success = success && read(file, num_features);
+    for(size_t i=0; success && i<num_features; i++) {
+        uint64_t featid;
+        int32_t anchor_cam_id, representation;
+        double anchor_clone_timestamp;
+        uint8_t has_had_anchor_change, should_marg;
+        Eigen::Vector3d uv_norm_zero, uv_norm_zero_fej;
+        Eigen::MatrixXd value, fej;
+        success = success && read(file, featid) && read(file, anchor_cam_id) && read(file, anchor_clone_timestamp);
+        success = success && read(file, has_had_anchor_change) && read(file, should_marg) && read(file, representation);
+        for(int j=0; j<3; j++)
+            success = success && read(file, uv_norm_zero(j));
+        for(int j=0; j<3; j++)
+            success = success && read(file, uv_norm_zero_fej(j));
+        success = success && read_type(file, value, fej) && (value.rows() == 1 || value.rows() == 3) && fej.rows() == value.rows();
+        if(success) {
+            Landmark *landmark = new Landmark((int)value.rows());
+            landmark->_featid = featid;
+            landmark->_anchor_cam_id = anchor_cam_id;
+            landmark->_anchor_clone_timestamp = anchor_clone_timestamp;
+            landmark->has_had_anchor_change = (has_had_anchor_change != 0);
+            landmark->should_marg = (should_marg != 0);
+            landmark->_feat_representation = (LandmarkRepresentation::Representation)representation;
+            landmark->uv_norm_zero = uv_norm_zero;
+            landmark->uv_norm_zero_fej = uv_norm_zero_fej;
+            landmark->set_value(value);
+            landmark->set_fej(fej);
+            features.insert({(size_t)featid, landmark});
+        }
+    }
+
+    // Ordering of the variables in the covariance
+    uint32_t num_variables = 0;
+    std::vector<uint8_t> var_types;
+    std::vector<double> var_keys;
+    std::vector<int32_t> var_ids;
+    success = success && read(file, num_variables);
+    for(size_t i=0; success && i<num_variables; i++) {
+        uint8_t type;
+        double key;
+        int32_t id;
+        success = success && read(file, type) && read(file, key) && read(file, id);
+        var_types.push_back(type);
+        var_keys.push_back(key);
+        var_ids.push_back(id);
+    }
+
+    // Covariance
+    Eigen::MatrixXd cov;
+    success = success && read_matrix(file, cov, (size_t)1e8) && cov.rows() == cov.cols();
+
+    // Inertial readings
+    uint8_t have_time_offset = 0;
+    double time_offset = 0;
+    uint64_t num_imu = 0;
+    std::vector<Propagator::IMUDATA> imu_data;
+    success = success && read(file, have_time_offset) && read(file, time_offset) && read(file, num_imu);
+    for(size_t i=0; success && i<num_imu; i++) {
+        Propagator::IMUDATA data;
+        success = success && read(file, data.timestamp);
+        for(int j=0; j<3; j++)
+            success = success && read(file, data.wm(j));
+        for(int j=0; j<3; j++)
+            success = success && read(file, data.am(j));
+        imu_data.push_back(data);
+    }
+
+    // Feature trackers
+    TrackerData data_feats, data_aruco;
+    success = success && read_tracker(file, data_feats) && read_tracker(file, data_aruco);
+
+    // Lookup what each of the variables in the covariance is, and ensure they cover it exactly
+    std::vector<Type*> variables;
+    int current_id = 0;
+    for(size_t i=0; success && i<var_types.size(); i++) {
+        Type *var = nullptr;
+        size_t camid = (size_t)var_keys.at(i);
+        if(var_types.at(i) == VAR_IMU) {
+            var = state->_imu;
+        } else if(var_types.at(i) == VAR_TIMEOFFSET) {
+            var = state->_calib_dt_CAMtoIMU;
+        } else if(var_types.at(i) == VAR_EXTRINSIC && camid < num_cameras) {
+            var = state->_calib_IMUtoCAM.at(camid);
+        } else if(var_types.at(i) == VAR_INTRINSIC && camid < num_cameras) {
+            var = state->_cam_intrinsics.at(camid);
+        } else if(var_types.at(i) == VAR_CLONE && clones.find(var_keys.at(i)) != clones.end()) {
+            var = clones.at(var_keys.at(i));
+        } else if(var_types.at(i) == VAR_LANDMARK && features.find((size_t)var_keys.at(i)) != features.end()) {
+            var = features.at((size_t)var_keys.at(i));
+        }
+        success = (var != nullptr && var_ids.at(i) == current_id && std::find(variables.begin(), variables.end(), var) == variables.end());
+        if(success) {
+            variables.push_back(var);
+            current_id += var->size();
+        }
+    }
+    success = success && current_id == cov.rows() && clones.size()+features.size() <= variables.size();
+
+    // Cleanup if we failed
+    if(!success) {
+        printf(RED "[SNAPSHOT]: %s is corrupted or incomplete, unable to restore\n" RESET, path.c_str());
+        for(auto &clone : clones)
+            delete clone.second;
+        for(auto &feat : features)
+            delete feat.second;
+        return false;
+    }
+
+    // Now restore the state
+    startup_time = file_startup_time;
+    state->_timestamp = timestamp;
+    state->_options.do_calib_camera_timeoffset = (calib_dt != 0);
+    state->_options.do_calib_camera_pose = (calib_pose != 0);
+    state->_options.do_calib_camera_intrinsics = (calib_intrinsics != 0);
+    state->_imu->set_value(imu_value);
+    state->_imu->set_fej(imu_fej);
+    state->_calib_dt_CAMtoIMU->set_value(dt_value);
+    state->_calib_dt_CAMtoIMU->set_fej(dt_fej);
+    for(size_t i=0; i<num_cameras; i++) {
+        state->_cam_intrinsics_model.at(i) = (cam_models.at(i) != 0);
+        state->_calib_IMUtoCAM.at(i)->set_value(extrin_value.at(i));
+        state->_calib_IMUtoCAM.at(i)->set_fej(extrin_fej.at(i));
+        state->_cam_intrinsics.at(i)->set_value(intrin_value.at(i));
+        state->_cam_intrinsics.at(i)->set_fej(intrin_fej.at(i));
+    }
+    state->_clones_IMU = clones;
+    state->_features_SLAM = features;
+
+    // Variables which are not estimated anymore have no location in the covariance
+    state->_imu->set_local_id(-1);
+    state->_calib_dt_CAMtoIMU->set_local_id(-1);
+    for(size_t i=0; i<num_cameras; i++) {
+        state->_calib_IMUtoCAM.at(i)->set_local_id(-1);
+        state->_cam_intrinsics.at(i)->set_local_id(-1);
+    }
+    for(size_t i=0; i<variables.size(); i++) {
+        variables.at(i)->set_local_id(var_ids.at(i));
+    }
+    state->_variables = variables;
+    state->_Cov = cov;
+    StateHelper::update_consider_variables(state);
+
+    // Restore the propagator and trackers
+    propagator->set_imu_buffer(imu_data, time_offset, (have_time_offset != 0));
+    const TrackerData* datas[2] = {&data_feats, &data_aruco};
+    TrackBase* trackers[2] = {trackFEATS, trackARUCO};
+    for(size_t t=0; t<2; t++) {
+        if(trackers[t] == nullptr || !datas[t]->exists)
+            continue;
+        const TrackerData &data = *datas[t];
+        for(size_t m=0; m<data.featids.size(); m++) {
+            trackers[t]->get_feature_database()->update_feature(data.featids.at(m), data.timestamps.at(m), data.camids.at(m),
+                    data.uvs.at(4*m), data.uvs.at(4*m+1), data.uvs.at(4*m+2), data.uvs.at(4*m+3));
+        }
+        trackers[t]->set_currid(std::max(trackers[t]->get_currid(), (size_t)data.currid));
+    }
+    printf(GREEN "[SNAPSHOT]: restored %d clones and %d SLAM features at %.3f from %s\n" RESET,
+           (int)state->_clones_IMU.size(),(int)state->_features_SLAM.size(),state->_timestamp,path.c_str());
+    return true;
+
+}
+
+
+
+void VioSnapshot::write_matrix(std::ofstream &file, const Eigen::MatrixXd &mat) {
+    write(file, (uint32_t)mat.rows());
+    write(file, (uint32_t)mat.cols());
+    file.write(reinterpret_cast<const char*>(mat.data()), sizeof(double)*mat.size());
+}
+
+
+
+bool VioSnapshot::read_matrix(std::ifstream &file, Eigen::MatrixXd &mat, size_t max_size) {
+    uint32_t rows, cols;
+    if(!read(file, rows) || !read(file, cols) || (size_t)rows*(size_t)cols > max_size)
+        return false;
+    mat.resize(rows, cols);
+    file.read(reinterpret_cast<char*>(mat.data()), sizeof(double)*mat.size());
+    return (bool)file;
+}
+
+
+
+void VioSnapshot::write_type(std::ofstream &file, Type *var) {
+    write_matrix(file, var->value());
+    write_matrix(file, var->fej());
+}
+
+
+
+bool VioSnapshot::read_type(std::ifstream &file, Eigen::MatrixXd &value, Eigen::MatrixXd &fej) {
+    // Our largest variable is the IMU with a 16x1 value
+    return read_matrix(file, value, 16) && read_matrix(file, fej, 16)
+           && value.rows() == fej.rows() && value.cols() == 1 && fej.cols() == 1;
+}
+
+
+
+void VioSnapshot::write_tracker(std::ofstream &file, TrackBase *tracker) {
+
+    // Record if we have this tracker
+    write(file, (uint8_t)(tracker != nullptr));
+    if(tracker == nullptr)
+        return;
+    write(file, (uint64_t)tracker->get_currid());
+
+    // Count how many measurements we have
+    std::unordered_map<size_t, Feature*> features = tracker->get_feature_database()->get_internal_data();
+    uint64_t num_meas = 0;
+    for(const auto &feat : features) {
+        for(const auto &times : feat.second->timestamps)
+            num_meas += times.second.size();
+    }
+
+    // Write each measurement, ordered per feature and camera so the tracks are rebuilt in the same order
+    write(file, num_meas);
+    for(const auto &feat : features) {
+        for(const auto &times : feat.second->timestamps) {
+            size_t camid = times.first;
+            for(size_t m=0; m<times.second.size(); m++) {
+                write(file, (uint64_t)feat.first);
+                write(file, (uint64_t)camid);
+                write(file, times.second.at(m));
+                write(file, feat.second->uvs.at(camid).at(m)(0));
+                write(file, feat.second->uvs.at(camid).at(m)(1));
+                write(file, feat.second->uvs_norm.at(camid).at(m)(0));
+                write(file, feat.second->uvs_norm.at(camid).at(m)(1));
+            }
+        }
+    }
+
+}
+
+
+
+bool VioSnapshot::read_tracker(std::ifstream &file, TrackerData &data) {
+
+    // Check if this tracker was saved
+    uint8_t exists;
+    if(!read(file, exists))
+        return false;
+    data.exists = (exists != 0);
+    if(!data.exists)
+        return true;
+
+    // Read all the measurements
+    uint64_t num_meas;
+    if(!read(file, data.currid) || !read(file, num_meas))
+        return false;
+    for(size_t m=0; m<num_meas; m++) {
+        uint64_t featid, camid;
+        double timestamp;
+        float uv[4];
+        if(!read(file, featid) || !read(file, camid) || !read(file, timestamp) || !read(file, uv))
+            return false;
+        data.featids.push_back((size_t)featid);
+        data.camids.push_back((size_t)camid);
+        data.timestamps.push_back(timestamp);
+        data.uvs.insert(data.uvs.end(), uv, uv+4);
+    }
+    return true;
+
+}
+
@@ -0,0 +1,166 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_VIOSNAPSHOT_H
+#define OV_MSCKF_VIOSNAPSHOT_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "track/TrackBase.h"
+#include "types/Landmark.h"
+#include "state/Propagator.h"
+#include "state/State.h"
+#include "state/StateHelper.h"
+#include "utils/colors.h"
+
+
+namespace ov_msckf {
+
+
+
+    /**
+     * @brief Binary snapshot of the full estimator which allows for a warm restart
+     *
+     * A snapshot contains everything needed to continue estimation without going through the initializer again:
+     * - All state variables (IMU, calibration, clones and SLAM landmarks) with their values and first-estimates
+     * - The full covariance and the ordering of the variables inside of it
+     * - The buffered inertial readings of the propagator
+     * - The feature databases and next feature IDs of the trackers
+     *
+     * The last tracked images are not saved, thus the trackers will re-detect features on the first image after a restore.
+     * The restored tracks in the database are still used, but will not be extended.
+     * The file is versioned and a snapshot will only be loaded if it matches the number of cameras of the current configuration.
+     */
+    class VioSnapshot {
+
+    public:
+
+
+        /**
+         * @brief Will save the estimator into a binary snapshot
+         * @param path Path to the binary file we will write to
+         * @param state Pointer to state (should be initialized)
+         * @param propagator Propagator which has our inertial readings
+         * @param trackFEATS Feature tracker
+         * @param trackARUCO Aruco tracker (can be nullptr)
+         * @param startup_time Timestamp the system was initialized at
+         * @return True if we have successfully written the file
+         */
+        static bool save(const std::string &path, State *state, Propagator *propagator,
+                         TrackBase *trackFEATS, TrackBase *trackARUCO, double startup_time);
+
+
+        /**
+         * @brief Will restore the estimator from a binary snapshot
+         *
+         * The state should have just been constructed (i.e. have no clones or SLAM features).
+         * If the snapshot can not be loaded, nothing will be changed.
+         *
+         * @param path Path to the binary file we will read
+         * @param state Pointer to state we will overwrite
+         * @param propagator Propagator we will restore the inertial readings into
+         * @param trackFEATS Feature tracker we will restore the database into
+         * @param trackARUCO Aruco tracker (can be nullptr)
+         * @param startup_time Timestamp the system was initialized at
+         * @return True if we have successfully restored the snapshot
+         */
+        static bool load(const std::string &path, State *state, Propagator *propagator,
+                         TrackBase *trackFEATS, TrackBase *trackARUCO, double &startup_time);
+
+
+    protected:
+
+        /// What each variable in the covariance is
+        enum VariableType : uint8_t {
+            VAR_IMU = 0,
+            VAR_TIMEOFFSET = 1,
+            VAR_EXTRINSIC = 2,
+            VAR_INTRINSIC = 3,
+            VAR_CLONE = 4,
+            VAR_LANDMARK = 5
+        };
+
+        /// Writes a plain value to the stream
+        template<typename T>
+        static void write(std::ofstream &file, const T &value) {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        /// Reads a plain value from the stream
+        template<typename T>
+        static bool read(std::ifstream &file, T &value) {
+            file.read(reinterpret_cast<char*>(&value), sizeof(T));
+            return (bool)file;
+        }
+
+        /// Writes a matrix with its size to the stream
+        static void write_matrix(std::ofstream &file, const Eigen::MatrixXd &mat);
+
+        /// Reads a matrix with its size from the stream (must be smaller than the max size)
+        static bool read_matrix(std::ifstream &file, Eigen::MatrixXd &mat, size_t max_size);
+
+        /// Measurements of a tracker in the order they should be inserted back into its database
+        struct TrackerData {
+
+            /// If this tracker was saved
+            bool exists = false;
+
+            /// Next feature ID of the tracker
+            uint64_t currid = 0;
+
+            /// Feature ID, camera ID, and timestamp of each measurement
+            std::vector<size_t> featids;
+            std::vector<size_t> camids;
+            std::vector<double> timestamps;
+
+            /// Raw and normalized uv of each measurement (four values per measurement)
+            std::vector<float> uvs;
+
+        };
+
+        /// Writes the value and first-estimate of a variable
+        static void write_type(std::ofstream &file, Type *var);
+
+        /// Reads the value and first-estimate of a variable
+        static bool read_type(std::ifstream &file, Eigen::MatrixXd &value, Eigen::MatrixXd &fej);
+
+        /// Writes the feature database and next ID of a tracker
+        static void write_tracker(std::ofstream &file, TrackBase *tracker);
+
+        /// Reads the feature database and next ID of a tracker
+        static bool read_tracker(std::ifstream &file, TrackerData &data);
+
+    };
+
+
+}
+
+#endif //OV_MSCKF_VIOSNAPSHOT_H
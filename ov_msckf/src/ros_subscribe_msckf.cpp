@@ -20,6 +20,11 @@
  */
 
 
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include <ros/ros.h>
 #include <rosbag/bag.h>
 #include <rosbag/view.h>
@@ -36,6 +41,7 @@
 #include "core/RosVisualizer.h"
 #include "utils/dataset_reader.h"
 #include "utils/parse_ros.h"
+#include "utils/SPSCQueue.h"
 
 
 using namespace ov_msckf;
@@ -45,15 +51,34 @@ VioManager* sys;
 RosVisualizer* viz;
 
 
-// Buffer data
-double time_buffer = -1;
-cv::Mat img0_buffer, img1_buffer;
+/// Single inertial reading passed to the estimator thread
+struct ImuMessage {
+    double timestamp = -1;
+    Eigen::Vector3d wm, am;
+};
+
+/// Single (mono or stereo) image passed to the estimator thread
+struct CameraMessage {
+    double timestamp = -1;
+    cv::Mat img0, img1;
+};
+
+// Queues between the ROS callbacks (producer) and the estimator thread (consumer)
+// The IMU queue is large enough to hold a few seconds of data, so it should only drop if the estimator has stalled
+ov_core::SPSCQueue<ImuMessage> queue_imu(4096);
+ov_core::SPSCQueue<CameraMessage> queue_cam(8);
+
+// If the estimator thread should stop
+std::atomic<bool> estimator_shutdown(false);
 
 // Callback functions
 void callback_inertial(const sensor_msgs::Imu::ConstPtr& msg);
 void callback_monocular(const sensor_msgs::ImageConstPtr& msg0);
 void callback_stereo(const sensor_msgs::ImageConstPtr& msg0, const sensor_msgs::ImageConstPtr& msg1);
 
+// Estimator thread which processes all measurements
+void estimator_thread(int num_cameras);
+
 
 
 // Main function
@@ -82,8 +107,9 @@ int main(int argc, char** argv) {
 
     // Logic for sync stereo subscriber
     // https://answers.ros.org/question/96346/subscribe-to-two-image_raws-with-one-function/?answer=96491#post-id-96491
-    message_filters::Subscriber<sensor_msgs::Image> image_sub0(nh,topic_camera0.c_str(),1);
-    message_filters::Subscriber<sensor_msgs::Image> image_sub1(nh,topic_camera1.c_str(),1);
+    // Our callbacks only copy into the queues, so ROS can keep a few images without them going stale
+    message_filters::Subscriber<sensor_msgs::Image> image_sub0(nh,topic_camera0.c_str(),5);
+    message_filters::Subscriber<sensor_msgs::Image> image_sub1(nh,topic_camera1.c_str(),5);
     //message_filters::TimeSynchronizer<sensor_msgs::Image,sensor_msgs::Image> sync(image_sub0,image_sub1,5);
     typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Image, sensor_msgs::Image> sync_pol;
     message_filters::Synchronizer<sync_pol> sync(sync_pol(5), image_sub0,image_sub1);
@@ -93,7 +119,7 @@ int main(int argc, char** argv) {
     ros::Subscriber subcam;
     if(params.state_options.num_cameras == 1) {
         ROS_INFO("subscribing to: %s", topic_camera0.c_str());
-        subcam = nh.subscribe(topic_camera0.c_str(), 1, callback_monocular);
+        subcam = nh.subscribe(topic_camera0.c_str(), 5, callback_monocular);
     } else if(params.state_options.num_cameras == 2) {
         ROS_INFO("subscribing to: %s", topic_camera0.c_str());
         ROS_INFO("subscribing to: %s", topic_camera1.c_str());
@@ -107,13 +133,25 @@ int main(int argc, char** argv) {
     //===================================================================================
     //===================================================================================
 
-    // Spin off to ROS
+    // Start our estimator, then spin off to ROS
+    // The callbacks will never block on the estimator, they only push into the queues
+    std::thread thread_estimator(estimator_thread, params.state_options.num_cameras);
     ROS_INFO("done...spinning to ros");
     ros::spin();
 
+    // Stop the estimator
+    estimator_shutdown = true;
+    thread_estimator.join();
+    ROS_INFO("queues: %d imu and %d camera measurements dropped",(int)queue_imu.dropped(),(int)queue_cam.dropped());
+
     // Final visualization
     viz->visualize_final();
 
+    // Save where we ended so we can warm restart
+    if(!params.snapshot_path.empty()) {
+        sys->save_snapshot(params.snapshot_path);
+    }
+
     // Finally delete our system
     delete sys;
     delete viz;
@@ -129,14 +167,15 @@ int main(int argc, char** argv) {
 void callback_inertial(const sensor_msgs::Imu::ConstPtr& msg) {
 
     // convert into correct format
-    double timem = msg->header.stamp.toSec();
-    Eigen::Vector3d wm, am;
-    wm << msg->angular_velocity.x, msg->angular_velocity.y, msg->angular_velocity.z;
-    am << msg->linear_acceleration.x, msg->linear_acceleration.y, msg->linear_acceleration.z;
-
-    // send it to our VIO system
-    sys->feed_measurement_imu(timem, wm, am);
-    viz->visualize_odometry(timem);
+    ImuMessage imu;
+    imu.timestamp = msg->header.stamp.toSec();
+    imu.wm << msg->angular_velocity.x, msg->angular_velocity.y, msg->angular_velocity.z;
+    imu.am << msg->linear_acceleration.x, msg->linear_acceleration.y, msg->linear_acceleration.z;
+
+    // send it to our estimator thread
+    if(!queue_imu.push(imu)) {
+        ROS_WARN_THROTTLE(1.0, "imu queue is full, dropped %d measurements so far", (int)queue_imu.dropped());
+    }
 
 }
 
@@ -154,21 +193,14 @@ void callback_monocular(const sensor_msgs::ImageConstPtr& msg0) {
         return;
     }
 
-    // Fill our buffer if we have not
-    if(img0_buffer.rows == 0) {
-        time_buffer = cv_ptr->header.stamp.toSec();
-        img0_buffer = cv_ptr->image.clone();
-        return;
+    // send it to our estimator thread
+    CameraMessage cam;
+    cam.timestamp = cv_ptr->header.stamp.toSec();
+    cam.img0 = cv_ptr->image.clone();
+    if(!queue_cam.push(cam)) {
+        ROS_WARN_THROTTLE(1.0, "camera queue is full, dropped %d images so far", (int)queue_cam.dropped());
     }
 
-    // send it to our VIO system
-    sys->feed_measurement_monocular(time_buffer, img0_buffer, 0);
-    viz->visualize();
-
-    // move buffer forward
-    time_buffer = cv_ptr->header.stamp.toSec();
-    img0_buffer = cv_ptr->image.clone();
-
 }
 
 
@@ -193,29 +225,65 @@ void callback_stereo(const sensor_msgs::ImageConstPtr& msg0, const sensor_msgs::
         return;
     }
 
-
-    // Fill our buffer if we have not
-    if(img0_buffer.rows == 0 || img1_buffer.rows == 0) {
-        time_buffer = cv_ptr0->header.stamp.toSec();
-        img0_buffer = cv_ptr0->image.clone();
-        time_buffer = cv_ptr1->header.stamp.toSec();
-        img1_buffer = cv_ptr1->image.clone();
-        return;
+    // send it to our estimator thread
+    CameraMessage cam;
+    cam.timestamp = cv_ptr0->header.stamp.toSec();
+    cam.img0 = cv_ptr0->image.clone();
+    cam.img1 = cv_ptr1->image.clone();
+    if(!queue_cam.push(cam)) {
+        ROS_WARN_THROTTLE(1.0, "camera queue is full, dropped %d images so far", (int)queue_cam.dropped());
     }
 
-    // send it to our VIO system
-    sys->feed_measurement_stereo(time_buffer, img0_buffer, img1_buffer, 0, 1);
-    viz->visualize();
+}
 
-    // move buffer forward
-    time_buffer = cv_ptr0->header.stamp.toSec();
-    img0_buffer = cv_ptr0->image.clone();
-    time_buffer = cv_ptr1->header.stamp.toSec();
-    img1_buffer = cv_ptr1->image.clone();
 
-}
 
+void estimator_thread(int num_cameras) {
+
+    // Newest inertial reading we have processed
+    double time_imu_last = -1;
+
+    // Loop until we are told to stop
+    while(!estimator_shutdown) {
+
+        // First give all inertial readings to the system
+        ImuMessage imu;
+        bool has_imu = false;
+        while(queue_imu.pop(imu)) {
+            sys->feed_measurement_imu(imu.timestamp, imu.wm, imu.am);
+            time_imu_last = imu.timestamp;
+            has_imu = true;
+        }
+        if(has_imu) {
+            viz->visualize_odometry(time_imu_last);
+        }
+
+        // Process the oldest image once we have inertial readings up to it (in the imu clock)
+        // If the camera queue is filling up then our IMU is late or has stopped, so we just process with what we have
+        CameraMessage *cam = queue_cam.front();
+        if(cam != nullptr) {
+            double time_cam_inI = cam->timestamp + sys->get_state()->_calib_dt_CAMtoIMU->value()(0);
+            if(time_imu_last >= time_cam_inI || queue_cam.size() > queue_cam.capacity()/2) {
+                if(num_cameras == 1) {
+                    sys->feed_measurement_monocular(cam->timestamp, cam->img0, 0);
+                } else {
+                    sys->feed_measurement_stereo(cam->timestamp, cam->img0, cam->img1, 0, 1);
+                }
+                viz->visualize();
+                queue_cam.pop();
+                ROS_DEBUG("queues: %d imu and %d camera measurements waiting",(int)queue_imu.size(),(int)queue_cam.size());
+                continue;
+            }
+        }
+
+        // Nothing to do, wait a bit for new measurements
+        if(!has_imu) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
 
+    }
+
+}
 
 
 
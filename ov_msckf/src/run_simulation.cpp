@@ -24,6 +24,7 @@
 #include <csignal>
 
 #include "sim/Simulator.h"
+#include "sim/SimulatorStream.h"
 #include "core/VioManager.h"
 #include "utils/dataset_reader.h"
 #include "utils/parse_cmd.h"
@@ -40,7 +41,8 @@
 using namespace ov_msckf;
 
 
-Simulator* sim;
+Simulator* sim = nullptr;
+SimulatorStream* stream = nullptr;
 VioManager* sys;
 #ifdef ROS_AVAILABLE
 RosVisualizer* viz;
@@ -67,8 +69,29 @@ int main(int argc, char** argv)
     params = parse_command_line_arguments(argc, argv);
 #endif
 
+    // Load our recorded measurements if we have them, otherwise simulate
+    // NOTE: if we replay a recording, we do not have the simulator groundtruth for visualization
+    if(!params.sim_stream_path.empty()) {
+        stream = new SimulatorStream(params, params.sim_stream_path);
+        if(!stream->valid()) {
+            delete stream;
+            sim = new Simulator(params);
+            if(!SimulatorStream::record(sim, params, params.sim_stream_path)) {
+                printf(RED "[SIM]: Could not record the simulation to %s\n" RESET, params.sim_stream_path.c_str());
+                std::exit(EXIT_FAILURE);
+            }
+            stream = new SimulatorStream(sim->get_true_paramters(), params.sim_stream_path);
+            if(!stream->valid()) {
+                printf(RED "[SIM]: Could not load the recorded simulation %s\n" RESET, params.sim_stream_path.c_str());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        stream->get_initial_calibration(params);
+    } else {
+        sim = new Simulator(params);
+    }
+
     // Create our VIO system
-    sim = new Simulator(params);
     sys = new VioManager(params);
 #ifdef ROS_AVAILABLE
     viz = new RosVisualizer(nh, sys, sim);
@@ -80,16 +103,20 @@ int main(int argc, char** argv)
 
     // Get initial state
     Eigen::Matrix<double, 17, 1> imustate;
-    bool success = sim->get_state(sim->current_timestamp(),imustate);
-    if(!success) {
-        printf(RED "[SIM]: Could not initialize the filter to the first state\n" RESET);
-        printf(RED "[SIM]: Did the simulator load properly???\n" RESET);
-        std::exit(EXIT_FAILURE);
-    }
+    if(stream != nullptr) {
+        stream->get_initial_state(imustate);
+    } else {
+        bool success = sim->get_state(sim->current_timestamp(),imustate);
+        if(!success) {
+            printf(RED "[SIM]: Could not initialize the filter to the first state\n" RESET);
+            printf(RED "[SIM]: Did the simulator load properly???\n" RESET);
+            std::exit(EXIT_FAILURE);
+        }
 
-    // Since the state time is in the camera frame of reference
-    // Subtract out the imu to camera time offset
-    imustate(0,0) -= sim->get_true_paramters().calib_camimu_dt;
+        // Since the state time is in the camera frame of reference
+        // Subtract out the imu to camera time offset
+        imustate(0,0) -= sim->get_true_paramters().calib_camimu_dt;
+    }
 
     // Initialize our filter with the groundtruth
     sys->initialize_with_gt(imustate);
@@ -106,15 +133,15 @@ int main(int argc, char** argv)
     // Step through the rosbag
     signal(SIGINT, signal_callback_handler);
 #ifdef ROS_AVAILABLE
-    while(sim->ok() && ros::ok()) {
+    while(((stream != nullptr)? stream->ok() : sim->ok()) && ros::ok()) {
 #else
-    while(sim->ok()) {
+    while((stream != nullptr)? stream->ok() : sim->ok()) {
 #endif
 
         // IMU: get the next simulated IMU measurement if we have it
         double time_imu;
         Eigen::Vector3d wm, am;
-        bool hasimu = sim->get_next_imu(time_imu, wm, am);
+        bool hasimu = (stream != nullptr)? stream->get_next_imu(time_imu, wm, am) : sim->get_next_imu(time_imu, wm, am);
         if(hasimu) {
             sys->feed_measurement_imu(time_imu, wm, am);
 #ifdef ROS_AVAILABLE
@@ -126,7 +153,7 @@ int main(int argc, char** argv)
         double time_cam;
         std::vector<int> camids;
         std::vector<std::vector<std::pair<size_t,Eigen::VectorXf>>> feats;
-        bool hascam = sim->get_next_cam(time_cam, camids, feats);
+        bool hascam = (stream != nullptr)? stream->get_next_cam(time_cam, camids, feats) : sim->get_next_cam(time_cam, camids, feats);
         if(hascam) {
             if(buffer_timecam != -1) {
                 sys->feed_measurement_simulation(buffer_timecam, buffer_camids, buffer_feats);
@@ -155,6 +182,7 @@ int main(int argc, char** argv)
 
     // Finally delete our system
     delete sim;
+    delete stream;
     delete sys;
 
     // Done!
@@ -175,45 +175,63 @@ Simulator::Simulator(VioManagerOptions& params_) {
     //===============================================================
 
 
+    // Compute the cone which encloses the image of each camera (used to cull our spatial index)
+    for(int i=0; i<params.state_options.num_cameras; i++) {
+        camera_fov_half.push_back(compute_fov_half_angle(i));
+        printf("[SIM]: camera %d has a half fov of %.2f degrees\n",i,180.0/M_PI*camera_fov_half.at(i));
+    }
+
     // We will create synthetic camera frames and ensure that each has enough features
     //double dt = 0.25/freq_cam;
     double dt = 0.25;
     size_t mapsize = featmap.size();
     printf("[SIM]: Generating map features at %d rate\n",(int)(1.0/dt));
 
+    // Get the poses of all synthetic frames (these are the same for each camera)
+    // NOTE: we evaluate them from the spline in batches until we reach its end
+    std::vector<Eigen::Matrix3d> R_GtoI_synth;
+    std::vector<Eigen::Vector3d> p_IinG_synth;
+    double time_synth = spline.get_start_time();
+    bool reached_end = false;
+    while(!reached_end) {
+        std::vector<double> times_batch;
+        for(int k=0; k<100; k++) {
+            times_batch.push_back(time_synth);
+            time_synth += dt;
+        }
+        std::vector<Eigen::Matrix3d> R_GtoI_batch;
+        std::vector<Eigen::Vector3d> p_IinG_batch;
+        std::vector<bool> valid_batch;
+        spline.get_pose_batch(times_batch, R_GtoI_batch, p_IinG_batch, valid_batch);
+        for(size_t k=0; k<times_batch.size(); k++) {
+            if(!valid_batch.at(k)) {
+                reached_end = true;
+                break;
+            }
+            R_GtoI_synth.push_back(R_GtoI_batch.at(k));
+            p_IinG_synth.push_back(p_IinG_batch.at(k));
+        }
+    }
+
     // Loop through each camera
     // NOTE: we loop through cameras here so that the feature map for camera 1 will always be the same
     // NOTE: thus when we add more cameras the first camera should get the same measurements
     for(int i=0; i<params.state_options.num_cameras; i++) {
 
-        // Reset the start time
-        double time_synth = spline.get_start_time();
-
         // Loop through each pose and generate our feature map in them!!!!
-        while(true) {
-
-            // Get the pose at the current timestep
-            Eigen::Matrix3d R_GtoI;
-            Eigen::Vector3d p_IinG;
-            bool success_pose = spline.get_pose(time_synth, R_GtoI, p_IinG);
-
-            // We have finished generating features
-            if(!success_pose)
-                break;
+        for(size_t k=0; k<R_GtoI_synth.size(); k++) {
 
             // Get the uv features for this frame
-            std::vector<std::pair<size_t,Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featmap);
+            std::vector<std::pair<size_t,Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI_synth.at(k), p_IinG_synth.at(k), i);
             // If we do not have enough, generate more
             if((int)uvs.size() < params.num_pts) {
-                generate_points(R_GtoI, p_IinG, i, featmap, params.num_pts-(int)uvs.size());
+                generate_points(R_GtoI_synth.at(k), p_IinG_synth.at(k), i, featmap, params.num_pts-(int)uvs.size());
             }
 
-            // Move forward in time
-            time_synth += dt;
         }
 
         // Debug print
-        printf("[SIM]: Generated %d map features in total over %d frames (camera %d)\n",(int)(featmap.size()-mapsize),(int)((time_synth-spline.get_start_time())/dt),i);
+        printf("[SIM]: Generated %d map features in total over %d frames (camera %d)\n",(int)(featmap.size()-mapsize),(int)R_GtoI_synth.size(),i);
         mapsize = featmap.size();
 
     }
@@ -286,15 +304,27 @@ bool Simulator::get_next_imu(double &time_imu, Eigen::Vector3d &wm, Eigen::Vecto
     timestamp = timestamp_last_imu;
     time_imu = timestamp_last_imu;
 
-    // Current state values
-    Eigen::Matrix3d R_GtoI;
-    Eigen::Vector3d p_IinG, w_IinI, v_IinG, alpha_IinI, a_IinG;
-
     // Get the pose, velocity, and acceleration
     // NOTE: we get the acceleration between our two IMU
     // NOTE: this is because we are using a constant measurement model for integration
+    // NOTE: the spline is evaluated for a batch of our upcoming IMU timestamps at once (these are exactly the ones we will step through)
     //bool success_accel = spline.get_acceleration(timestamp+0.5/freq_imu, R_GtoI, p_IinG, w_IinI, v_IinG, alpha_IinI, a_IinG);
-    bool success_accel = spline.get_acceleration(timestamp, R_GtoI, p_IinG, w_IinI, v_IinG, alpha_IinI, a_IinG);
+    if(imu_batch_idx >= imu_batch_times.size() || imu_batch_times.at(imu_batch_idx) != timestamp) {
+        imu_batch_times.clear();
+        double time_batch = timestamp;
+        for(int k=0; k<400; k++) {
+            imu_batch_times.push_back(time_batch);
+            time_batch += 1.0/params.sim_freq_imu;
+        }
+        spline.get_acceleration_batch(imu_batch_times, imu_batch_R_GtoI, imu_batch_p_IinG, imu_batch_w_IinI, imu_batch_v_IinG,
+                                      imu_batch_alpha_IinI, imu_batch_a_IinG, imu_batch_valid);
+        imu_batch_idx = 0;
+    }
+    bool success_accel = imu_batch_valid.at(imu_batch_idx);
+    const Eigen::Matrix3d &R_GtoI = imu_batch_R_GtoI.at(imu_batch_idx);
+    const Eigen::Vector3d &w_IinI = imu_batch_w_IinI.at(imu_batch_idx);
+    const Eigen::Vector3d &a_IinG = imu_batch_a_IinG.at(imu_batch_idx);
+    imu_batch_idx++;
 
     // If failed, then that means we don't have any more spline
     // Thus we should stop the simulation
@@ -363,7 +393,7 @@ bool Simulator::get_next_cam(double &time_cam, std::vector<int> &camids, std::ve
     for(int i=0; i<params.state_options.num_cameras; i++) {
 
         // Get the uv features for this frame
-        std::vector<std::pair<size_t,Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featmap);
+        std::vector<std::pair<size_t,Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i);
 
         // If we do not have enough, generate more
         if((int)uvs.size() < params.num_pts) {
@@ -468,8 +498,7 @@ void Simulator::load_data(std::string path_traj) {
 
 
 
-std::vector<std::pair<size_t,Eigen::VectorXf>> Simulator::project_pointcloud(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG,
-                                                                             int camid, const std::unordered_map<size_t,Eigen::Vector3d> &feats) {
+std::vector<std::pair<size_t,Eigen::VectorXf>> Simulator::project_pointcloud(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG, int camid) {
 
     // Assert we have good camera
     assert(camid < params.state_options.num_cameras);
@@ -477,6 +506,7 @@ std::vector<std::pair<size_t,Eigen::VectorXf>> Simulator::project_pointcloud(con
     assert((int)params.camera_wh.size() == params.state_options.num_cameras);
     assert((int)params.camera_intrinsics.size() == params.state_options.num_cameras);
     assert((int)params.camera_extrinsics.size() == params.state_options.num_cameras);
+    assert((int)camera_fov_half.size() == params.state_options.num_cameras);
 
     // Grab our extrinsic and intrinsic values
     Eigen::Matrix<double,3,3> R_ItoC = quat_2_Rot(params.camera_extrinsics.at(camid).block(0,0,4,1));
@@ -486,15 +516,71 @@ std::vector<std::pair<size_t,Eigen::VectorXf>> Simulator::project_pointcloud(con
     // Our projected uv true measurements
     std::vector<std::pair<size_t,Eigen::VectorXf>> uvs;
 
-    // Loop through our map
-    for(const auto &feat : feats) {
+    // Pose of the camera in the global frame
+    Eigen::Matrix3d R_GtoC = R_ItoC*R_GtoI;
+    Eigen::Vector3d p_CinG = p_IinG-R_GtoC.transpose()*p_IinC;
+
+    // Radius of the sphere which bounds a voxel
+    double voxel_radius = 0.5*std::sqrt(3.0)*voxel_size;
+    double fov_half = camera_fov_half.at(camid);
+
+    // Checks if the bounding sphere of a voxel could be seen by the camera
+    auto voxel_in_frustum = [&](int64_t ix, int64_t iy, int64_t iz) {
+        Eigen::Vector3d center_inG;
+        center_inG << (ix+0.5)*voxel_size, (iy+0.5)*voxel_size, (iz+0.5)*voxel_size;
+        Eigen::Vector3d center_inC = R_GtoC*(center_inG-p_CinG);
+        double dist = center_inC.norm();
+        if(dist <= voxel_radius)
+            return true;
+        if(center_inC(2) > max_proj_depth+voxel_radius || center_inC(2) < min_proj_depth-voxel_radius)
+            return false;
+        double angle = std::acos(std::max(-1.0,std::min(1.0,center_inC(2)/dist)));
+        return (angle <= fov_half+std::asin(voxel_radius/dist));
+    };
+
+    // Get the voxels which intersect our view frustum
+    // If the map has less voxels than the bounding box of the frustum we can just check each occupied one
+    std::vector<size_t> candidates;
+    int64_t radius_vox = (int64_t)std::ceil(max_proj_depth/voxel_size)+1;
+    size_t num_bbox = (size_t)std::pow(2*radius_vox+1,3);
+    const int64_t offset = ((int64_t)1<<20);
+    if(featmap_voxels.size() < num_bbox) {
+        for(const auto &voxel : featmap_voxels) {
+            int64_t ix = (int64_t)((voxel.first>>42)&0x1FFFFF)-offset;
+            int64_t iy = (int64_t)((voxel.first>>21)&0x1FFFFF)-offset;
+            int64_t iz = (int64_t)(voxel.first&0x1FFFFF)-offset;
+            if(voxel_in_frustum(ix,iy,iz))
+                candidates.insert(candidates.end(), voxel.second.begin(), voxel.second.end());
+        }
+    } else {
+        int64_t cx = (int64_t)std::floor(p_CinG(0)/voxel_size);
+        int64_t cy = (int64_t)std::floor(p_CinG(1)/voxel_size);
+        int64_t cz = (int64_t)std::floor(p_CinG(2)/voxel_size);
+        for(int64_t ix=cx-radius_vox; ix<=cx+radius_vox; ix++) {
+            for(int64_t iy=cy-radius_vox; iy<=cy+radius_vox; iy++) {
+                for(int64_t iz=cz-radius_vox; iz<=cz+radius_vox; iz++) {
+                    Eigen::Vector3d center_inG;
+                    center_inG << (ix+0.5)*voxel_size, (iy+0.5)*voxel_size, (iz+0.5)*voxel_size;
+                    auto voxel = featmap_voxels.find(get_voxel_key(center_inG));
+                    if(voxel != featmap_voxels.end() && voxel_in_frustum(ix,iy,iz))
+                        candidates.insert(candidates.end(), voxel->second.begin(), voxel->second.end());
+                }
+            }
+        }
+    }
+
+    // Loop through the features in our candidate voxels
+    for(const size_t &featid : candidates) {
+
+        // Our feature in the global frame
+        const Eigen::Vector3d &p_FinG = featmap.at(featid);
 
         // Transform feature into current camera frame
-        Eigen::Vector3d p_FinI = R_GtoI*(feat.second-p_IinG);
+        Eigen::Vector3d p_FinI = R_GtoI*(p_FinG-p_IinG);
         Eigen::Vector3d p_FinC = R_ItoC*p_FinI+p_IinC;
 
         // Skip cloud if too far away
-        if(p_FinC(2) > 15 || p_FinC(2) < 0.5)
+        if(p_FinC(2) > max_proj_depth || p_FinC(2) < min_proj_depth)
             continue;
 
         // Project to normalized coordinates
@@ -541,10 +627,17 @@ std::vector<std::pair<size_t,Eigen::VectorXf>> Simulator::project_pointcloud(con
         }
 
         // Else we can add this as a good projection
-        uvs.push_back({feat.first, uv_dist});
+        uvs.push_back({featid, uv_dist});
 
     }
 
+    // Sort by id so our measurements are independent of the voxel ordering
+    // NOTE: this changes which features are kept and the order of the noise draws compared to looping over the hash map
+    // NOTE: thus simulated datasets are deterministic, but do not match the ones generated before the voxel index
+    std::sort(uvs.begin(), uvs.end(), [](const std::pair<size_t,Eigen::VectorXf> &a, const std::pair<size_t,Eigen::VectorXf> &b) {
+        return a.first < b.first;
+    });
+
     // Return our projections
     return uvs;
 
@@ -628,11 +721,97 @@ void Simulator::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vect
         Eigen::Vector3d p_FinI = R_ItoC.transpose()*(p_FinC-p_IinC);
         Eigen::Vector3d p_FinG = R_GtoI.transpose()*p_FinI+p_IinG;
 
-        // Append this as a new feature
+        // Append this as a new feature (and to our spatial index)
         featmap.insert({id_map,p_FinG});
+        featmap_voxels[get_voxel_key(p_FinG)].push_back(id_map);
         id_map++;
 
     }
 
 
 }
+
+
+
+
+double Simulator::compute_fov_half_angle(int camid) {
+
+    // Grab our intrinsic values
+    Eigen::Matrix<double,8,1> cam_d = params.camera_intrinsics.at(camid);
+    double width = params.camera_wh.at(camid).first;
+    double height = params.camera_wh.at(camid).second;
+
+    // Convert to opencv format since we will use their undistort functions
+    cv::Matx33d camK;
+    camK(0, 0) = cam_d(0);
+    camK(0, 1) = 0;
+    camK(0, 2) = cam_d(2);
+    camK(1, 0) = 0;
+    camK(1, 1) = cam_d(1);
+    camK(1, 2) = cam_d(3);
+    camK(2, 0) = 0;
+    camK(2, 1) = 0;
+    camK(2, 2) = 1;
+    cv::Vec4d camD;
+    camD(0) = cam_d(4);
+    camD(1) = cam_d(5);
+    camD(2) = cam_d(6);
+    camD(3) = cam_d(7);
+
+    // Sample pixels along the border of the image
+    int num_samples = 20;
+    cv::Mat mat(4*num_samples, 2, CV_32F);
+    for(int i=0; i<num_samples; i++) {
+        double t = (double)i/(num_samples-1);
+        mat.at<float>(4*i+0, 0) = t*width;
+        mat.at<float>(4*i+0, 1) = 0;
+        mat.at<float>(4*i+1, 0) = t*width;
+        mat.at<float>(4*i+1, 1) = height;
+        mat.at<float>(4*i+2, 0) = 0;
+        mat.at<float>(4*i+2, 1) = t*height;
+        mat.at<float>(4*i+3, 0) = width;
+        mat.at<float>(4*i+3, 1) = t*height;
+    }
+    mat = mat.reshape(2); // Nx1, 2-channel
+
+    // Undistort the points to our normalized coordinates (false=radtan, true=fisheye)
+    if(params.camera_fisheye.at(camid)) {
+        cv::fisheye::undistortPoints(mat, mat, camK, camD);
+    } else {
+        cv::undistortPoints(mat, mat, camK, camD);
+    }
+
+    // Find the largest angle from the optical axis
+    mat = mat.reshape(1); // Nx2, 1-channel
+    double max_angle = 0.0;
+    for(int i=0; i<mat.rows; i++) {
+        double r = std::sqrt(std::pow(mat.at<float>(i, 0),2)+std::pow(mat.at<float>(i, 1),2));
+        if(std::isfinite(r))
+            max_angle = std::max(max_angle, std::atan(r));
+    }
+
+    // Add a small margin, and make sure we are within a half sphere
+    // NOTE: we can not see anything behind the camera since we require positive depth
+    return std::min(1.1*max_angle+1.0*M_PI/180.0, 0.5*M_PI);
+
+}
+
+
+
+
+uint64_t Simulator::get_voxel_key(const Eigen::Vector3d &p_FinG) {
+
+    // Integer coordinates of this voxel, offset so they are positive
+    // NOTE: each axis gets 21 bits, thus the voxel coordinates need to be in [-2^20, 2^20)
+    const int64_t offset = ((int64_t)1<<20);
+    Eigen::Vector3d p_vox = (p_FinG/voxel_size).array().floor();
+    if(!(p_vox.array() >= -(double)offset).all() || !(p_vox.array() < (double)offset).all()) {
+        printf(RED "[SIM]: point %.2f,%.2f,%.2f is outside of the range of our voxel index\n" RESET, p_FinG(0), p_FinG(1), p_FinG(2));
+        std::exit(EXIT_FAILURE);
+    }
+    uint64_t ix = (uint64_t)((int64_t)p_vox(0)+offset) & 0x1FFFFF;
+    uint64_t iy = (uint64_t)((int64_t)p_vox(1)+offset) & 0x1FFFFF;
+    uint64_t iz = (uint64_t)((int64_t)p_vox(2)+offset) & 0x1FFFFF;
+    return (ix<<42) | (iy<<21) | iz;
+
+}
@@ -22,6 +22,7 @@
 #define OV_MSCKF_SIMULATOR_H
 
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <random>
@@ -134,14 +135,44 @@ namespace ov_msckf {
         void load_data(std::string path_traj);
 
         /**
-         * @brief Projects the passed map features into the desired camera frame.
+         * @brief Projects the map features into the desired camera frame.
+         *
+         * Instead of looping over the whole map, we use our voxel spatial index and only look at voxels whose bounding sphere
+         * intersects the view frustum of the camera (depth range and a cone enclosing the image).
+         * The remaining points then go through the exact projection and image bound checks.
+         * The returned measurements are sorted by feature id so they do not depend on the hash map ordering.
+         *
          * @param R_GtoI Orientation of the IMU pose
          * @param p_IinG Position of the IMU pose
          * @param camid Camera id of the camera sensor we want to project into
-         * @param feats Our set of 3d features
          * @return True distorted raw image measurements and their ids for the specified camera
          */
-        std::vector<std::pair<size_t,Eigen::VectorXf>> project_pointcloud(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG, int camid, const std::unordered_map<size_t,Eigen::Vector3d> &feats);
+        std::vector<std::pair<size_t,Eigen::VectorXf>> project_pointcloud(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG, int camid);
+
+
+        /**
+         * @brief Computes the half angle of a cone around the optical axis which contains the whole image.
+         *
+         * We undistort pixels along the image border and take the largest angle from the optical axis.
+         * This is used to cull voxels of the spatial index which can not project into the image.
+         *
+         * @param camid Camera id of the camera sensor
+         * @return Half angle of the cone in radians
+         */
+        double compute_fov_half_angle(int camid);
+
+
+        /**
+         * @brief Gets the key of the voxel that a 3d point falls into
+         *
+         * Each axis of the integer voxel coordinates is packed into 21 bits.
+         * Thus the supported voxel coordinates are [-2^20, 2^20) on each axis (about +-2000km with our default voxel size).
+         * Points outside of this range are an error (they would alias with other voxels).
+         *
+         * @param p_FinG Position of the point in the global frame
+         * @return Packed integer coordinates of the voxel
+         */
+        uint64_t get_voxel_key(const Eigen::Vector3d &p_FinG);
 
 
         /**
@@ -175,6 +206,19 @@ namespace ov_msckf {
         size_t id_map = 0;
         std::unordered_map<size_t,Eigen::Vector3d> featmap;
 
+        /// Voxel spatial index of our map (voxel key => feature ids in that voxel)
+        std::unordered_map<uint64_t,std::vector<size_t>> featmap_voxels;
+
+        /// Side length of each voxel in our spatial index (meters)
+        double voxel_size = 2.0;
+
+        /// Half angle of the cone containing the image of each camera (radians)
+        std::vector<double> camera_fov_half;
+
+        /// Min and max depth that a feature can be projected at
+        double min_proj_depth = 0.5;
+        double max_proj_depth = 15.0;
+
         /// Mersenne twister PRNG for measurements (IMU)
         std::mt19937 gen_meas_imu;
 
@@ -214,6 +258,13 @@ namespace ov_msckf {
         std::vector<Eigen::Vector3d> hist_true_bias_accel;
         std::vector<Eigen::Vector3d> hist_true_bias_gyro;
 
+        // True motion at the upcoming IMU timestamps (evaluated from the spline in batches)
+        size_t imu_batch_idx = 0;
+        std::vector<double> imu_batch_times;
+        std::vector<Eigen::Matrix3d> imu_batch_R_GtoI;
+        std::vector<Eigen::Vector3d> imu_batch_p_IinG, imu_batch_w_IinI, imu_batch_v_IinG, imu_batch_alpha_IinI, imu_batch_a_IinG;
+        std::vector<bool> imu_batch_valid;
+
 
     };
 
@@ -0,0 +1,334 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SimulatorStream.h"
+
+
+using namespace ov_msckf;
+
+
+/// Magic bytes at the start of each recording, and the version of the format
+static const char STREAM_MAGIC[8] = {'O','V','S','I','M','S','T','R'};
+static const uint32_t STREAM_VERSION = 2;
+
+
+
+bool SimulatorStream::record(Simulator *sim, const VioManagerOptions &params_init, const std::string &path) {
+
+    // Our true parameters used to generate the stream
+    VioManagerOptions params = sim->get_true_paramters();
+
+    // Get initial state
+    Eigen::Matrix<double, 17, 1> imustate;
+    bool success = sim->get_state(sim->current_timestamp(),imustate);
+    if(!success) {
+        printf(RED "[SIM-STREAM]: Could not get the first state of the simulator\n" RESET);
+        return false;
+    }
+
+    // Since the state time is in the camera frame of reference
+    // Subtract out the imu to camera time offset
+    imustate(0,0) -= params.calib_camimu_dt;
+
+    // Open our file
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file) {
+        printf(RED "[SIM-STREAM]: Unable to open %s for writing\n" RESET, path.c_str());
+        return false;
+    }
+
+    // Header and fingerprint of our config
+    file.write(STREAM_MAGIC, sizeof(STREAM_MAGIC));
+    write(file, STREAM_VERSION);
+    std::vector<double> fingerprint = get_fingerprint(params);
+    write(file, (uint32_t)fingerprint.size());
+    for(const double &val : fingerprint)
+        write(file, val);
+    write(file, (uint32_t)params.sim_traj_path.size());
+    file.write(params.sim_traj_path.data(), params.sim_traj_path.size());
+
+    // Initial state and the calibration the estimator will start with
+    for(int i=0; i<17; i++)
+        write(file, imustate(i));
+    write(file, params_init.calib_camimu_dt);
+    for(int n=0; n<params.state_options.num_cameras; n++) {
+        for(int i=0; i<8; i++)
+            write(file, params_init.camera_intrinsics.at(n)(i));
+        for(int i=0; i<7; i++)
+            write(file, params_init.camera_extrinsics.at(n)(i));
+    }
+
+    // Continue to simulate until we have processed all the measurements
+    size_t ct_imu = 0;
+    size_t ct_cam = 0;
+    while(sim->ok()) {
+
+        // IMU: get the next simulated IMU measurement if we have it
+        double time_imu;
+        Eigen::Vector3d wm, am;
+        bool hasimu = sim->get_next_imu(time_imu, wm, am);
+        if(hasimu) {
+            write(file, (uint8_t)RECORD_IMU);
+            write(file, time_imu);
+            for(int i=0; i<3; i++)
+                write(file, wm(i));
+            for(int i=0; i<3; i++)
+                write(file, am(i));
+            ct_imu++;
+        }
+
+        // CAM: get the next simulated camera uv measurements if we have them
+        double time_cam;
+        std::vector<int> camids;
+        std::vector<std::vector<std::pair<size_t,Eigen::VectorXf>>> feats;
+        bool hascam = sim->get_next_cam(time_cam, camids, feats);
+        if(hascam) {
+            write(file, (uint8_t)RECORD_CAM);
+            write(file, time_cam);
+            write(file, (uint32_t)camids.size());
+            for(size_t c=0; c<camids.size(); c++) {
+                write(file, (int32_t)camids.at(c));
+                write(file, (uint32_t)feats.at(c).size());
+                for(const auto &feat : feats.at(c)) {
+                    write(file, (uint64_t)feat.first);
+                    write(file, feat.second(0));
+                    write(file, feat.second(1));
+                }
+            }
+            ct_cam++;
+        }
+
+    }
+
+    // Done, make sure everything was written
+    file.close();
+    if(file.fail()) {
+        printf(RED "[SIM-STREAM]: Failed writing to %s\n" RESET, path.c_str());
+        return false;
+    }
+    printf("[SIM-STREAM]: recorded %d imu and %d camera measurements to %s\n",(int)ct_imu,(int)ct_cam,path.c_str());
+    return true;
+
+}
+
+
+
+SimulatorStream::SimulatorStream(const VioManagerOptions &params, const std::string &path) {
+
+    // Read the whole file into memory
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if(!file) {
+        return;
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    buffer.resize((size_t)size);
+    if(size <= 0 || !file.read(buffer.data(), size)) {
+        printf(YELLOW "[SIM-STREAM]: unable to read %s\n" RESET, path.c_str());
+        return;
+    }
+    file.close();
+
+    // Check our header
+    uint32_t version;
+    if(buffer.size() < sizeof(STREAM_MAGIC) || std::memcmp(buffer.data(), STREAM_MAGIC, sizeof(STREAM_MAGIC)) != 0) {
+        printf(YELLOW "[SIM-STREAM]: %s is not a simulation recording\n" RESET, path.c_str());
+        return;
+    }
+    cursor = sizeof(STREAM_MAGIC);
+    if(!read(version) || version != STREAM_VERSION) {
+        printf(YELLOW "[SIM-STREAM]: %s has an unsupported version\n" RESET, path.c_str());
+        return;
+    }
+
+    // Check that it was generated with the same configuration
+    std::vector<double> fingerprint = get_fingerprint(params);
+    uint32_t num_fingerprint;
+    if(!read(num_fingerprint) || num_fingerprint != fingerprint.size()) {
+        printf(YELLOW "[SIM-STREAM]: %s was recorded with a different configuration\n" RESET, path.c_str());
+        return;
+    }
+    for(size_t i=0; i<fingerprint.size(); i++) {
+        double val;
+        if(!read(val) || val != fingerprint.at(i)) {
+            printf(YELLOW "[SIM-STREAM]: %s was recorded with a different configuration\n" RESET, path.c_str());
+            return;
+        }
+    }
+    uint32_t len_path;
+    if(!read(len_path) || cursor+len_path > buffer.size() || std::string(buffer.data()+cursor, len_path) != params.sim_traj_path) {
+        printf(YELLOW "[SIM-STREAM]: %s was recorded with a different trajectory\n" RESET, path.c_str());
+        return;
+    }
+    cursor += len_path;
+
+    // Initial state and calibration
+    bool success = true;
+    for(int i=0; i<17; i++)
+        success &= read(init_imustate(i));
+    success &= read(init_calib_camimu_dt);
+    for(int n=0; n<params.state_options.num_cameras; n++) {
+        Eigen::VectorXd intrinsics(8), extrinsics(7);
+        for(int i=0; i<8; i++)
+            success &= read(intrinsics(i));
+        for(int i=0; i<7; i++)
+            success &= read(extrinsics(i));
+        init_camera_intrinsics.insert({n,intrinsics});
+        init_camera_extrinsics.insert({n,extrinsics});
+    }
+    if(!success) {
+        printf(YELLOW "[SIM-STREAM]: %s has a truncated header\n" RESET, path.c_str());
+        return;
+    }
+
+    // Success!
+    is_valid = true;
+    printf("[SIM-STREAM]: loaded %.2f MB recording from %s\n",(double)buffer.size()/(1024.0*1024.0),path.c_str());
+
+}
+
+
+
+void SimulatorStream::get_initial_calibration(VioManagerOptions &params) {
+    params.calib_camimu_dt = init_calib_camimu_dt;
+    for(const auto &intrinsics : init_camera_intrinsics)
+        params.camera_intrinsics[intrinsics.first] = intrinsics.second;
+    for(const auto &extrinsics : init_camera_extrinsics)
+        params.camera_extrinsics[extrinsics.first] = extrinsics.second;
+}
+
+
+
+bool SimulatorStream::get_next_imu(double &time_imu, Eigen::Vector3d &wm, Eigen::Vector3d &am) {
+
+    // Return if the next record is not an imu reading
+    if(!ok() || (uint8_t)buffer.at(cursor) != RECORD_IMU)
+        return false;
+    cursor++;
+
+    // Read the measurement
+    bool success = read(time_imu);
+    for(int i=0; i<3; i++)
+        success &= read(wm(i));
+    for(int i=0; i<3; i++)
+        success &= read(am(i));
+    if(!success) {
+        printf(RED "[SIM-STREAM]: recording is truncated, stopping replay\n" RESET);
+        cursor = buffer.size();
+    }
+    return success;
+
+}
+
+
+
+bool SimulatorStream::get_next_cam(double &time_cam, std::vector<int> &camids, std::vector<std::vector<std::pair<size_t,Eigen::VectorXf>>> &feats) {
+
+    // Return if the next record is not a camera reading
+    if(!ok() || (uint8_t)buffer.at(cursor) != RECORD_CAM)
+        return false;
+    cursor++;
+
+    // Read the measurement
+    uint32_t num_cams;
+    bool success = read(time_cam) && read(num_cams);
+    for(uint32_t c=0; success && c<num_cams; c++) {
+        int32_t camid;
+        uint32_t num_feats;
+        success &= read(camid) && read(num_feats);
+        std::vector<std::pair<size_t,Eigen::VectorXf>> uvs;
+        uvs.reserve(num_feats);
+        for(uint32_t f=0; success && f<num_feats; f++) {
+            uint64_t id;
+            Eigen::VectorXf uv(2);
+            success &= read(id) && read(uv(0)) && read(uv(1));
+            uvs.push_back({(size_t)id, uv});
+        }
+        camids.push_back((int)camid);
+        feats.push_back(uvs);
+    }
+    if(!success) {
+        printf(RED "[SIM-STREAM]: recording is truncated, stopping replay\n" RESET);
+        cursor = buffer.size();
+    }
+    return success;
+
+}
+
+
+
+std::vector<double> SimulatorStream::get_fingerprint(const VioManagerOptions &params) {
+
+    // Simulation settings and seeds
+    std::vector<double> fingerprint;
+    fingerprint.push_back(params.sim_distance_threshold);
+    fingerprint.push_back(params.sim_freq_cam);
+    fingerprint.push_back(params.sim_freq_imu);
+    fingerprint.push_back(params.sim_seed_state_init);
+    fingerprint.push_back(params.sim_seed_preturb);
+    fingerprint.push_back(params.sim_seed_measurements);
+    fingerprint.push_back(params.sim_do_perturbation);
+    fingerprint.push_back(params.gravity(0));
+    fingerprint.push_back(params.gravity(1));
+    fingerprint.push_back(params.gravity(2));
+
+    // Contents of the trajectory we simulate (size and FNV-1a hash of the file)
+    // NOTE: the hash is split into two 32 bit halves so they are exactly represented as doubles
+    uint64_t traj_size = 0;
+    uint64_t traj_hash = 14695981039346656037ULL;
+    std::ifstream file(params.sim_traj_path, std::ios::in | std::ios::binary);
+    char chunk[65536];
+    while(file) {
+        file.read(chunk, sizeof(chunk));
+        std::streamsize num = file.gcount();
+        for(std::streamsize i=0; i<num; i++) {
+            traj_hash ^= (uint8_t)chunk[i];
+            traj_hash *= 1099511628211ULL;
+        }
+        traj_size += (uint64_t)num;
+    }
+    fingerprint.push_back((double)traj_size);
+    fingerprint.push_back((double)(traj_hash >> 32));
+    fingerprint.push_back((double)(traj_hash & 0xFFFFFFFFULL));
+
+    // Measurement generation
+    fingerprint.push_back(params.num_pts);
+    fingerprint.push_back(params.use_stereo);
+    fingerprint.push_back(params.msckf_options.sigma_pix);
+    fingerprint.push_back(params.imu_noises.sigma_w);
+    fingerprint.push_back(params.imu_noises.sigma_wb);
+    fingerprint.push_back(params.imu_noises.sigma_a);
+    fingerprint.push_back(params.imu_noises.sigma_ab);
+
+    // True calibration of our sensors
+    fingerprint.push_back(params.calib_camimu_dt);
+    fingerprint.push_back(params.state_options.num_cameras);
+    for(int n=0; n<params.state_options.num_cameras; n++) {
+        fingerprint.push_back(params.camera_fisheye.at(n));
+        fingerprint.push_back(params.camera_wh.at(n).first);
+        fingerprint.push_back(params.camera_wh.at(n).second);
+        for(int i=0; i<8; i++)
+            fingerprint.push_back(params.camera_intrinsics.at(n)(i));
+        for(int i=0; i<7; i++)
+            fingerprint.push_back(params.camera_extrinsics.at(n)(i));
+    }
+    return fingerprint;
+
+}
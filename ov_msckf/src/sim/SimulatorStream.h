@@ -0,0 +1,176 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_SIMULATOR_STREAM_H
+#define OV_MSCKF_SIMULATOR_STREAM_H
+
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "core/VioManagerOptions.h"
+#include "sim/Simulator.h"
+#include "utils/colors.h"
+
+
+namespace ov_msckf {
+
+
+
+    /**
+     * @brief Binary recording and replay of a simulated measurement stream
+     *
+     * Generating the b-spline, feature map and all measurements of a simulation is deterministic given the seeds and the configuration.
+     * Thus we can generate the full stream once, save it into a compact binary file, and then replay it for any further run.
+     * This allows for benchmarking of the estimator only, without paying for the measurement generation.
+     *
+     * The file has a header with a fingerprint of all parameters which change the generated measurements, the initial groundtruth state,
+     * and the (possibly perturbed) calibration the estimator should start with.
+     * This is followed by IMU and camera records in the order they were returned by the simulator.
+     * A file will only be replayed if its fingerprint matches the current configuration.
+     */
+    class SimulatorStream {
+
+    public:
+
+
+        /**
+         * @brief Will run the simulator to completion and save all its measurements to file
+         * @param sim Simulator which has just been constructed (all its measurements will be consumed)
+         * @param params_init Parameters the estimator should be started with (perturbed by the simulator)
+         * @param path Path to the binary file we will write to
+         * @return True if we have successfully written the file
+         */
+        static bool record(Simulator *sim, const VioManagerOptions &params_init, const std::string &path);
+
+
+        /**
+         * @brief Will try to load the recording from file and check that it matches our configuration
+         * @param params Parameters that the stream should have been generated with
+         * @param path Path to the binary file we will read
+         */
+        SimulatorStream(const VioManagerOptions &params, const std::string &path);
+
+        /// If we have loaded a valid stream
+        bool valid() {
+            return is_valid;
+        }
+
+        /// If we still have measurements to replay
+        bool ok() {
+            return is_valid && cursor < buffer.size();
+        }
+
+        /**
+         * @brief Returns the state in the MSCKF ordering the estimator should be initialized with
+         * @param imustate State in the MSCKF ordering: [time(sec),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel]
+         */
+        void get_initial_state(Eigen::Matrix<double,17,1> &imustate) {
+            imustate = init_imustate;
+        }
+
+        /**
+         * @brief Overwrites the calibration with the one the estimator was started with during recording
+         * @param params Parameters we will update (i.e. with the perturbed calibration)
+         */
+        void get_initial_calibration(VioManagerOptions &params);
+
+        /**
+         * @brief Gets the next inertial reading if it is the next record in the stream
+         * @param time_imu Time that this measurement occured at
+         * @param wm Angular velocity measurement in the inertial frame
+         * @param am Linear velocity in the inertial frame
+         * @return True if we have a measurement
+         */
+        bool get_next_imu(double &time_imu, Eigen::Vector3d &wm, Eigen::Vector3d &am);
+
+        /**
+         * @brief Gets the next camera reading if it is the next record in the stream
+         * @param time_cam Time that this measurement occured at
+         * @param camids Camera ids that the corresponding vectors match
+         * @param feats Noisy uv measurements and ids for the returned time
+         * @return True if we have a measurement
+         */
+        bool get_next_cam(double &time_cam, std::vector<int> &camids, std::vector<std::vector<std::pair<size_t,Eigen::VectorXf>>> &feats);
+
+
+    protected:
+
+        /// Type of each record in our stream
+        enum RecordType : uint8_t {
+            RECORD_IMU = 0,
+            RECORD_CAM = 1
+        };
+
+        /**
+         * @brief Collects all parameters which change the generated measurements
+         *
+         * This also includes the size and a hash of the contents of the trajectory file.
+         *
+         * @param params Configuration of the simulator
+         * @return Vector of values which should exactly match between recording and replay
+         */
+        static std::vector<double> get_fingerprint(const VioManagerOptions &params);
+
+        /// Reads a plain value at our cursor
+        template<typename T>
+        bool read(T &value) {
+            if(cursor+sizeof(T) > buffer.size())
+                return false;
+            std::memcpy(&value, buffer.data()+cursor, sizeof(T));
+            cursor += sizeof(T);
+            return true;
+        }
+
+        /// Writes a plain value to the stream
+        template<typename T>
+        static void write(std::ofstream &file, const T &value) {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        /// Raw contents of the recording
+        std::vector<char> buffer;
+
+        /// Current read location in the buffer
+        size_t cursor = 0;
+
+        /// If the stream was loaded and matches our config
+        bool is_valid = false;
+
+        /// Groundtruth state we should initialize with
+        Eigen::Matrix<double,17,1> init_imustate;
+
+        /// Calibration the estimator should be initialized with
+        double init_calib_camimu_dt;
+        std::map<size_t,Eigen::VectorXd> init_camera_intrinsics;
+        std::map<size_t,Eigen::VectorXd> init_camera_extrinsics;
+
+    };
+
+
+}
+
+#endif //OV_MSCKF_SIMULATOR_STREAM_H
@@ -0,0 +1,166 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CalibrationMonitor.h"
+
+
+using namespace ov_core;
+using namespace ov_msckf;
+
+
+
+void CalibrationMonitor::feed(State *state) {
+
+    // Loop through each group that we are estimating
+    for(int g=0; g<3; g++) {
+
+        // Skip if not being estimated (either disabled or frozen)
+        Group group = (Group)g;
+        GroupInfo &info = _groups[g];
+        if(!get_flag(state, group))
+            continue;
+
+        // Get the current value and marginal standard deviation
+        std::vector<Type*> vars = get_variables(state, group);
+        Eigen::MatrixXd cov = StateHelper::get_marginal_covariance(state, vars);
+        Eigen::VectorXd stds = cov.diagonal().cwiseMax(0.0).cwiseSqrt();
+        int value_size = 0;
+        for(Type* var : vars)
+            value_size += (int)var->value().rows();
+        Eigen::VectorXd value(value_size);
+        int value_id = 0;
+        for(Type* var : vars) {
+            value.block(value_id,0,var->value().rows(),1) = var->value();
+            value_id += (int)var->value().rows();
+        }
+
+        // Check if both the uncertainty and estimate have stopped changing
+        // Note that the values have quaternions (4 vs 3 error states) thus we compare against the largest std
+        bool stable = false;
+        if(info.last_std.rows() == stds.rows() && info.last_value.rows() == value.rows()) {
+            double max_std = stds.maxCoeff();
+            double change_std = ((stds-info.last_std).cwiseAbs().array()/info.last_std.array().max(1e-12)).maxCoeff();
+            double change_value = (value-info.last_value).cwiseAbs().maxCoeff()/std::max(max_std, 1e-12);
+            stable = (change_std < _options.calib_freeze_rel_change && change_value < _options.calib_freeze_rel_change);
+        }
+        info.count = (stable)? info.count+1 : 0;
+        info.last_std = stds;
+        info.last_value = value;
+
+        // Freeze if we have been stable long enough
+        if(info.count >= _options.calib_freeze_window) {
+            freeze(state, group);
+        }
+
+    }
+
+}
+
+
+
+void CalibrationMonitor::unfreeze(State *state) {
+
+    // Loop through each group and add back the frozen ones
+    for(int g=0; g<3; g++) {
+        Group group = (Group)g;
+        GroupInfo &info = _groups[g];
+        if(!info.frozen)
+            continue;
+        std::vector<Type*> vars = get_variables(state, group);
+        assert(vars.size() == info.frozen_cov.size());
+        for(size_t i=0; i<vars.size(); i++) {
+            StateHelper::insert_variable(state, vars.at(i), info.frozen_cov.at(i));
+        }
+        get_flag(state, group) = true;
+        info = GroupInfo();
+        printf(YELLOW "[CALIB]: re-enabled estimation of the %s\n" RESET, get_name(group).c_str());
+    }
+
+}
+
+
+
+void CalibrationMonitor::freeze(State *state, Group group) {
+
+    // Record the marginal covariance of each variable, so we can re-enable it in the future
+    GroupInfo &info = _groups[group];
+    std::vector<Type*> vars = get_variables(state, group);
+    info.frozen_cov.clear();
+    for(Type* var : vars) {
+        info.frozen_cov.push_back(StateHelper::get_marginal_covariance(state, {var}));
+    }
+
+    // Marginalize each variable, and replace it with a fixed copy
+    // Note that the marginalizer deletes the variable, thus we need to copy it first
+    for(size_t i=0; i<vars.size(); i++) {
+        Type* fixed = vars.at(i)->clone();
+        StateHelper::marginalize(state, vars.at(i));
+        if(group == TIMEOFFSET) {
+            state->_calib_dt_CAMtoIMU = dynamic_cast<Vec*>(fixed);
+        } else if(group == EXTRINSICS) {
+            state->_calib_IMUtoCAM.at(i) = dynamic_cast<PoseJPL*>(fixed);
+        } else {
+            state->_cam_intrinsics.at(i) = dynamic_cast<Vec*>(fixed);
+        }
+    }
+
+    // We are no longer estimating this group
+    get_flag(state, group) = false;
+    info.frozen = true;
+    info.count = 0;
+    printf(GREEN "[CALIB]: %s has converged, it is now a fixed parameter\n" RESET, get_name(group).c_str());
+
+}
+
+
+
+std::vector<Type*> CalibrationMonitor::get_variables(State *state, Group group) {
+    std::vector<Type*> vars;
+    if(group == TIMEOFFSET) {
+        vars.push_back(state->_calib_dt_CAMtoIMU);
+    } else if(group == EXTRINSICS) {
+        for(int i=0; i<state->_options.num_cameras; i++)
+            vars.push_back(state->_calib_IMUtoCAM.at(i));
+    } else {
+        for(int i=0; i<state->_options.num_cameras; i++)
+            vars.push_back(state->_cam_intrinsics.at(i));
+    }
+    return vars;
+}
+
+
+
+bool &CalibrationMonitor::get_flag(State *state, Group group) {
+    if(group == TIMEOFFSET)
+        return state->_options.do_calib_camera_timeoffset;
+    if(group == EXTRINSICS)
+        return state->_options.do_calib_camera_pose;
+    return state->_options.do_calib_camera_intrinsics;
+}
+
+
+
+std::string CalibrationMonitor::get_name(Group group) {
+    if(group == TIMEOFFSET)
+        return "camera-imu timeoffset";
+    if(group == EXTRINSICS)
+        return "camera extrinsics";
+    return "camera intrinsics";
+}
@@ -0,0 +1,153 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_CALIBRATION_MONITOR_H
+#define OV_MSCKF_CALIBRATION_MONITOR_H
+
+
+#include <vector>
+#include <Eigen/Eigen>
+
+#include "State.h"
+#include "StateHelper.h"
+#include "StateOptions.h"
+#include "utils/colors.h"
+
+
+namespace ov_msckf {
+
+
+    /**
+     * @brief Monitors the online calibration and freezes it once it has converged.
+     *
+     * Each calibration group (time offset, camera extrinsics, camera intrinsics) is checked after every update.
+     * If the marginal standard deviations and the estimate have stopped changing for StateOptions::calib_freeze_window
+     * consecutive updates, then the group is marginalized from the state using StateHelper::marginalize().
+     * After this the calibration is used as a fixed parameter, and its calibration flag in the state options is disabled.
+     * We keep the marginal covariance at freeze time so the calibration can be re-enabled with unfreeze().
+     */
+    class CalibrationMonitor {
+
+    public:
+
+        /// Calibration groups which can be frozen
+        enum Group {
+            TIMEOFFSET = 0,
+            EXTRINSICS = 1,
+            INTRINSICS = 2
+        };
+
+        /**
+         * @brief Default constructor
+         * @param options State options which contain our convergence thresholds
+         */
+        CalibrationMonitor(StateOptions &options) : _options(options) {}
+
+        /**
+         * @brief Checks for convergence of all estimated calibration, and freezes any that has converged
+         * @param state Pointer to state (should be called after the update)
+         */
+        void feed(State *state);
+
+        /**
+         * @brief Will re-enable estimation of all frozen calibration
+         *
+         * The calibration is added back into the state with the marginal covariance it had when frozen.
+         * Note that the crossterms with the rest of the state are lost, thus these start as zero.
+         *
+         * @param state Pointer to state
+         */
+        void unfreeze(State *state);
+
+        /**
+         * @brief If the given calibration group has been frozen
+         * @param group Calibration group
+         * @return True if this group is currently a fixed parameter
+         */
+        bool is_frozen(Group group) {
+            return _groups[group].frozen;
+        }
+
+
+    protected:
+
+        /**
+         * @brief Marginalizes the calibration group and keeps it as a fixed parameter
+         * @param state Pointer to state
+         * @param group Calibration group
+         */
+        void freeze(State *state, Group group);
+
+        /**
+         * @brief Gets the calibration variables of this group (in camera order)
+         * @param state Pointer to state
+         * @param group Calibration group
+         * @return Variables of this group
+         */
+        static std::vector<Type*> get_variables(State *state, Group group);
+
+        /**
+         * @brief Gets the state option flag that enables the estimation of this group
+         * @param state Pointer to state
+         * @param group Calibration group
+         * @return Reference to the calibration flag
+         */
+        static bool &get_flag(State *state, Group group);
+
+        /**
+         * @brief Gets the human readable name of the group
+         * @param group Calibration group
+         * @return Name of the group
+         */
+        static std::string get_name(Group group);
+
+        /// Information we keep for each calibration group
+        struct GroupInfo {
+
+            /// Number of consecutive stable updates
+            int count = 0;
+
+            /// If this group has been frozen
+            bool frozen = false;
+
+            /// Value of the group at the last check
+            Eigen::VectorXd last_value;
+
+            /// Marginal standard deviation of the group at the last check
+            Eigen::VectorXd last_std;
+
+            /// Marginal covariance of each variable at freeze time
+            std::vector<Eigen::MatrixXd> frozen_cov;
+
+        };
+
+        /// Our convergence options
+        StateOptions _options;
+
+        /// Information of each group (indexed by the Group enum)
+        GroupInfo _groups[3];
+
+    };
+
+
+}
+
+
+#endif //OV_MSCKF_CALIBRATION_MONITOR_H
@@ -0,0 +1,193 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "PoseHistory.h"
+
+
+using namespace ov_core;
+using namespace ov_msckf;
+
+
+
+void PoseHistory::feed_snapshot(const StateSnapshot &snapshot) {
+
+    // Nothing to record if we have not initialized yet
+    if(!snapshot.initialized)
+        return;
+
+    // Lock our history
+    std::unique_lock<std::mutex> lck(_mtx);
+
+    // Remove the older versions of the clones and filter pose we are about to record
+    // NOTE: we match them on their camera time, since their time in the IMU clock changes if we calibrate the time offset
+    auto it_old = _poses.begin();
+    while(it_old != _poses.end()) {
+        bool is_rerecorded = (it_old->source == CLONE || it_old->source == FILTER) &&
+                (it_old->timestamp_cam == snapshot.timestamp || snapshot.clones_IMU.find(it_old->timestamp_cam) != snapshot.clones_IMU.end());
+        if(is_rerecorded) it_old = _poses.erase(it_old);
+        else it_old++;
+    }
+
+    // Record all the clones in our window (they are in the camera clock)
+    for(const auto &clone : snapshot.clones_IMU) {
+        PoseEntry pose;
+        pose.timestamp = clone.first + snapshot.calib_dt_CAMtoIMU;
+        pose.timestamp_cam = clone.first;
+        pose.source = CLONE;
+        pose.q_GtoI = clone.second.block(0,0,4,1);
+        pose.p_IinG = clone.second.block(4,0,3,1);
+        if(snapshot.clones_cov.find(clone.first) != snapshot.clones_cov.end()) {
+            pose.has_covariance = true;
+            pose.covariance = snapshot.clones_cov.at(clone.first);
+        }
+        insert(pose);
+    }
+
+    // Record the current filter pose
+    PoseEntry pose;
+    pose.timestamp = snapshot.timestamp_inI;
+    pose.timestamp_cam = snapshot.timestamp;
+    pose.source = FILTER;
+    pose.q_GtoI = snapshot.quat();
+    pose.p_IinG = snapshot.pos();
+    pose.has_covariance = true;
+    pose.covariance = snapshot.cov_imu.block(0,0,6,6);
+    insert(pose);
+    _last_filter_time = std::max(_last_filter_time, pose.timestamp);
+
+    // Remove all propagated poses that this update has superseded
+    auto it = _poses.begin();
+    while(it != _poses.end() && it->timestamp <= _last_filter_time) {
+        if(it->source == PROPAGATED) it = _poses.erase(it);
+        else it++;
+    }
+
+}
+
+
+
+void PoseHistory::feed_propagated(double timestamp, const Eigen::Matrix<double,4,1> &q_GtoI, const Eigen::Matrix<double,3,1> &p_IinG) {
+
+    // Lock our history
+    std::unique_lock<std::mutex> lck(_mtx);
+
+    // Skip if the filter already has a better estimate
+    if(timestamp <= _last_filter_time)
+        return;
+
+    // Record it
+    PoseEntry pose;
+    pose.timestamp = timestamp;
+    pose.source = PROPAGATED;
+    pose.q_GtoI = q_GtoI;
+    pose.p_IinG = p_IinG;
+    insert(pose);
+
+}
+
+
+
+bool PoseHistory::get_pose(double timestamp, PoseEntry &pose) const {
+
+    // Lock our history
+    std::unique_lock<std::mutex> lck(_mtx);
+
+    // Fail if this is outside the period we have
+    if(_poses.empty() || timestamp < _poses.front().timestamp-1e-9 || timestamp > _poses.back().timestamp+1e-9)
+        return false;
+
+    // Find the first pose that is not before our timestamp
+    auto it1 = std::lower_bound(_poses.begin(), _poses.end(), timestamp-1e-9, [](const PoseEntry &p, double t) {
+        return p.timestamp < t;
+    });
+    if(it1 == _poses.end() || std::abs(it1->timestamp-timestamp) < 1e-9 || it1 == _poses.begin()) {
+        pose = (it1 == _poses.end())? _poses.back() : *it1;
+        return true;
+    }
+    const PoseEntry &pose0 = *(it1-1);
+    const PoseEntry &pose1 = *it1;
+
+    // Our interpolation amount between the two
+    double lambda = (timestamp-pose0.timestamp)/(pose1.timestamp-pose0.timestamp);
+
+    // Interpolate the orientation on the manifold, and the position linearly
+    Eigen::Matrix<double,3,3> R_GtoI0 = quat_2_Rot(pose0.q_GtoI);
+    Eigen::Matrix<double,3,3> R_GtoI1 = quat_2_Rot(pose1.q_GtoI);
+    Eigen::Matrix<double,3,3> R_GtoI = exp_so3(lambda*log_so3(R_GtoI1*R_GtoI0.transpose()))*R_GtoI0;
+    pose.timestamp = timestamp;
+    pose.source = INTERPOLATED;
+    pose.q_GtoI = rot_2_quat(R_GtoI);
+    pose.p_IinG = (1-lambda)*pose0.p_IinG + lambda*pose1.p_IinG;
+
+    // Approximate the covariance by interpolating between the two
+    pose.has_covariance = (pose0.has_covariance && pose1.has_covariance);
+    if(pose.has_covariance) pose.covariance = (1-lambda)*pose0.covariance + lambda*pose1.covariance;
+    else pose.covariance.setZero();
+    return true;
+
+}
+
+
+
+bool PoseHistory::get_latest(PoseEntry &pose) const {
+    std::unique_lock<std::mutex> lck(_mtx);
+    if(_poses.empty())
+        return false;
+    pose = _poses.back();
+    return true;
+}
+
+
+
+void PoseHistory::clear() {
+    std::unique_lock<std::mutex> lck(_mtx);
+    _poses.clear();
+    _last_filter_time = -1;
+}
+
+
+
+size_t PoseHistory::size() const {
+    std::unique_lock<std::mutex> lck(_mtx);
+    return _poses.size();
+}
+
+
+
+void PoseHistory::insert(const PoseEntry &pose) {
+
+    // Find where this pose should go (this is almost always at the end)
+    auto it = std::lower_bound(_poses.begin(), _poses.end(), pose.timestamp-1e-9, [](const PoseEntry &p, double t) {
+        return p.timestamp < t;
+    });
+
+    // Replace the pose at this time if we already have one, otherwise insert it
+    if(it != _poses.end() && std::abs(it->timestamp-pose.timestamp) < 1e-9) {
+        *it = pose;
+    } else {
+        _poses.insert(it, pose);
+    }
+
+    // Drop the oldest poses if we are too large
+    while(_poses.size() > _max_size) {
+        _poses.pop_front();
+    }
+
+}
@@ -0,0 +1,172 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_POSE_HISTORY_H
+#define OV_MSCKF_POSE_HISTORY_H
+
+
+#include <deque>
+#include <mutex>
+#include <Eigen/Eigen>
+#include <Eigen/StdVector>
+
+#include "StateSnapshot.h"
+#include "utils/quat_ops.h"
+
+
+namespace ov_msckf {
+
+
+    /**
+     * @brief Bounded history of timestamped IMU poses which can be queried at any time inside of it.
+     *
+     * Consumers such as XR reprojection or lidar motion compensation need the pose at some arbitrary recent time
+     * (e.g. display scanout or the middle of a sweep), and not just the pose at the last image.
+     * We record three kinds of poses, all in the IMU clock (t_imu = t_cam + t_off):
+     * - The filter pose after each update along with its marginal covariance
+     * - The clone poses in our sliding window along with their marginal covariance (re-recorded after each update as they are refined)
+     * - Poses propagated with the IMU past the last update, which have no covariance
+     *
+     * After each update the propagated poses before the new filter pose are removed, as they were computed from the older estimate
+     * and the refined clones give a better trajectory over that period.
+     * Clone and filter poses are identified by their camera clock time, since their time in the IMU clock moves as the time offset is calibrated.
+     * Thus when a clone is re-recorded its older version is removed, even if its time in the IMU clock has changed.
+     * The entries are kept sorted by time and the oldest are dropped once we reach our maximum size.
+     * A query is a binary search followed by a SE(3) interpolation between the two neighbouring poses:
+     * the orientation is interpolated on the manifold using exp_so3() and log_so3(), while the position is linearly interpolated.
+     * We do not extrapolate, so any query outside of the recorded period will fail.
+     * All functions are thread safe, so the filter thread can record poses while others query them.
+     */
+    class PoseHistory {
+
+    public:
+
+        /// Where a pose in our history came from
+        enum Source {
+            FILTER = 0,
+            CLONE = 1,
+            PROPAGATED = 2,
+            INTERPOLATED = 3
+        };
+
+        /**
+         * @brief Single timestamped pose of the IMU
+         */
+        struct PoseEntry {
+
+            /// Timestamp of this pose in the IMU clock
+            double timestamp = -1;
+
+            /// Timestamp of this pose in the camera clock (only for filter and clone poses, which are recorded at camera times)
+            double timestamp_cam = -1;
+
+            /// What kind of estimate this pose is
+            Source source = FILTER;
+
+            /// Rotation from global to IMU (JPL quaternion)
+            Eigen::Matrix<double,4,1> q_GtoI = Eigen::Matrix<double,4,1>(0,0,0,1);
+
+            /// Position of the IMU in the global
+            Eigen::Matrix<double,3,1> p_IinG = Eigen::Matrix<double,3,1>::Zero();
+
+            /// If we have a covariance for this pose
+            bool has_covariance = false;
+
+            /// Marginal covariance of the pose in the error state ordering (q_GtoI,p_IinG)
+            Eigen::Matrix<double,6,6> covariance = Eigen::Matrix<double,6,6>::Zero();
+
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        };
+
+
+        /**
+         * @brief Default constructor
+         * @param max_size Max number of poses we will keep (oldest are dropped first)
+         */
+        PoseHistory(size_t max_size) : _max_size(max_size) {}
+
+        /**
+         * @brief Records the filter and clone poses of a newly published state
+         *
+         * This will replace any poses we have of the same clones (or at the same times), and remove propagated poses which are now stale.
+         * @param snapshot Snapshot of the state after an update
+         */
+        void feed_snapshot(const StateSnapshot &snapshot);
+
+        /**
+         * @brief Records a pose which was propagated with the IMU past the last update
+         *
+         * Poses which are not newer than the last filter pose are ignored.
+         * @param timestamp Timestamp of this pose in the IMU clock
+         * @param q_GtoI Rotation from global to IMU (JPL quaternion)
+         * @param p_IinG Position of the IMU in the global
+         */
+        void feed_propagated(double timestamp, const Eigen::Matrix<double,4,1> &q_GtoI, const Eigen::Matrix<double,3,1> &p_IinG);
+
+        /**
+         * @brief Gets the pose at a given time
+         *
+         * If we have a pose at exactly this time it is returned, otherwise we interpolate between the two poses around it.
+         * The covariance is only given if both poses have one, and in that case is linearly interpolated between them.
+         *
+         * @param timestamp Desired timestamp in the IMU clock
+         * @param pose The pose at this timestamp
+         * @return False if the timestamp is outside of the period we have recorded
+         */
+        bool get_pose(double timestamp, PoseEntry &pose) const;
+
+        /**
+         * @brief Gets the newest pose we have
+         * @param pose The newest pose
+         * @return False if we do not have any poses yet
+         */
+        bool get_latest(PoseEntry &pose) const;
+
+        /// Removes all poses
+        void clear();
+
+        /// Number of poses we have
+        size_t size() const;
+
+
+    protected:
+
+        /// Will insert a pose into our sorted history (replacing one at the same time), assumes we have the lock
+        void insert(const PoseEntry &pose);
+
+        /// Max number of poses we will keep
+        size_t _max_size;
+
+        /// Time of the newest filter pose, propagated poses at or before this are stale
+        double _last_filter_time = -1;
+
+        /// Our poses sorted by their timestamp
+        std::deque<PoseEntry, Eigen::aligned_allocator<PoseEntry>> _poses;
+
+        /// Mutex for our history
+        mutable std::mutex _mtx;
+
+    };
+
+
+}
+
+#endif //OV_MSCKF_POSE_HISTORY_H
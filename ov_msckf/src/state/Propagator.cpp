@@ -71,15 +71,30 @@ void Propagator::propagate_and_clone(State* state, double timestamp) {
     Eigen::Matrix<double,15,15> Qd_summed = Eigen::Matrix<double,15,15>::Zero();
     double dt_summed = 0;
 
-    // Loop through all IMU messages, and use them to move the state forward in time
+    // If we are using preintegration, then we can get the transition and noise of the whole interval at once
+    // Otherwise loop through all IMU messages, and use them to move the state forward in time
     // This uses the zero'th order quat, and then constant acceleration discrete
-    if(prop_data.size() > 1) {
+    if(prop_data.size() > 1 && state->_options.use_cpi_propagation) {
+        predict_and_compute_cpi(state, prop_data, Phi_summed, Qd_summed);
+        dt_summed = prop_data.at(prop_data.size()-1).timestamp-prop_data.at(0).timestamp;
+    } else if(prop_data.size() > 1) {
+
+        // The orientation change -w_hat*dt of each reading only depends on the measurements and our bias estimate (which is not propagated)
+        // Thus we can get its exponential and right Jacobian used in the state transition for all readings at once
+        Vec3Batch w_dt(3, prop_data.size()-1);
+        for(size_t i=0; i<prop_data.size()-1; i++) {
+            w_dt.col(i) = -(prop_data.at(i).wm - state->_imu->bias_g())*(prop_data.at(i+1).timestamp-prop_data.at(i).timestamp);
+        }
+        Mat3Batch exp_w_dt, Jr_w_dt;
+        exp_so3_batch(w_dt, exp_w_dt);
+        Jr_so3_batch(w_dt, Jr_w_dt);
+
         for(size_t i=0; i<prop_data.size()-1; i++) {
 
             // Get the next state Jacobian and noise Jacobian for this IMU reading
             Eigen::Matrix<double, 15, 15> F = Eigen::Matrix<double, 15, 15>::Zero();
             Eigen::Matrix<double, 15, 15> Qdi = Eigen::Matrix<double, 15, 15>::Zero();
-            predict_and_compute(state, prop_data.at(i), prop_data.at(i+1), F, Qdi);
+            predict_and_compute(state, prop_data.at(i), prop_data.at(i+1), mat3_from_batch(exp_w_dt,(int)i), mat3_from_batch(Jr_w_dt,(int)i), F, Qdi);
 
             // Next we should propagate our IMU covariance
             // Pii' = F*Pii*F.transpose() + G*Q*G.transpose()
@@ -285,6 +300,7 @@ std::vector<Propagator::IMUDATA> Propagator::select_imu_readings(const std::vect
 
 
 void Propagator::predict_and_compute(State *state, const IMUDATA data_minus, const IMUDATA data_plus,
+                                     const Eigen::Matrix<double,3,3> &exp_w_dt, const Eigen::Matrix<double,3,3> &Jr_w_dt,
                                      Eigen::Matrix<double,15,15> &F, Eigen::Matrix<double,15,15> &Qd) {
 
     // Set them to zero
@@ -329,7 +345,7 @@ void Propagator::predict_and_compute(State *state, const IMUDATA data_minus, con
         Eigen::Matrix<double,3,1> p_fej = state->_imu->pos_fej();
 
         F.block(th_id, th_id, 3, 3) = dR;
-        F.block(th_id, bg_id, 3, 3).noalias() = -dR * Jr_so3(-w_hat * dt) * dt;
+        F.block(th_id, bg_id, 3, 3).noalias() = -dR * Jr_w_dt * dt;
         //F.block(th_id, bg_id, 3, 3).noalias() = -dR * Jr_so3(-log_so3(dR)) * dt;
         F.block(bg_id, bg_id, 3, 3).setIdentity();
         F.block(v_id, th_id, 3, 3).noalias() = -skew_x(new_v-v_fej+_gravity*dt)*Rfej.transpose();
@@ -343,7 +359,7 @@ void Propagator::predict_and_compute(State *state, const IMUDATA data_minus, con
         F.block(p_id, ba_id, 3, 3) = -0.5 * Rfej.transpose() * dt * dt;
         F.block(p_id, p_id, 3, 3).setIdentity();
 
-        G.block(th_id, 0, 3, 3) = -dR * Jr_so3(-w_hat * dt) * dt;
+        G.block(th_id, 0, 3, 3) = -dR * Jr_w_dt * dt;
         //G.block(th_id, 0, 3, 3) = -dR * Jr_so3(-log_so3(dR)) * dt;
         G.block(v_id, 3, 3, 3) = -Rfej.transpose() * dt;
         G.block(p_id, 3, 3, 3) = -0.5 * Rfej.transpose() * dt * dt;
@@ -354,8 +370,8 @@ void Propagator::predict_and_compute(State *state, const IMUDATA data_minus, con
 
         Eigen::Matrix<double,3,3> R_Gtoi = state->_imu->Rot();
 
-        F.block(th_id, th_id, 3, 3) = exp_so3(-w_hat * dt);
-        F.block(th_id, bg_id, 3, 3).noalias() = -exp_so3(-w_hat * dt) * Jr_so3(-w_hat * dt) * dt;
+        F.block(th_id, th_id, 3, 3) = exp_w_dt;
+        F.block(th_id, bg_id, 3, 3).noalias() = -exp_w_dt * Jr_w_dt * dt;
         F.block(bg_id, bg_id, 3, 3).setIdentity();
         F.block(v_id, th_id, 3, 3).noalias() = -R_Gtoi.transpose() * skew_x(a_hat * dt);
         F.block(v_id, v_id, 3, 3).setIdentity();
@@ -366,7 +382,7 @@ void Propagator::predict_and_compute(State *state, const IMUDATA data_minus, con
         F.block(p_id, ba_id, 3, 3) = -0.5 * R_Gtoi.transpose() * dt * dt;
         F.block(p_id, p_id, 3, 3).setIdentity();
 
-        G.block(th_id, 0, 3, 3) = -exp_so3(-w_hat * dt) * Jr_so3(-w_hat * dt) * dt;
+        G.block(th_id, 0, 3, 3) = -exp_w_dt * Jr_w_dt * dt;
         G.block(v_id, 3, 3, 3) = -R_Gtoi.transpose() * dt;
         G.block(p_id, 3, 3, 3) = -0.5 * R_Gtoi.transpose() * dt * dt;
         G.block(bg_id, 6, 3, 3) = dt*Eigen::Matrix<double,3,3>::Identity();
@@ -397,6 +413,75 @@ void Propagator::predict_and_compute(State *state, const IMUDATA data_minus, con
 }
 
 
+void Propagator::predict_and_compute_cpi(State *state, const std::vector<IMUDATA> &prop_data,
+                                         Eigen::Matrix<double,15,15> &F, Eigen::Matrix<double,15,15> &Qd) {
+
+    // Preintegrate all our readings about the current bias estimate
+    CpiV1 preinteg(_noises.sigma_w, _noises.sigma_wb, _noises.sigma_a, _noises.sigma_ab, state->_options.imu_avg);
+    preinteg.setLinearizationPoints(state->_imu->bias_g(), state->_imu->bias_a());
+    for(size_t i=0; i<prop_data.size()-1; i++) {
+        preinteg.feed_IMU(prop_data.at(i).timestamp, prop_data.at(i+1).timestamp,
+                          prop_data.at(i).wm, prop_data.at(i).am, prop_data.at(i+1).wm, prop_data.at(i+1).am);
+    }
+    double DT = preinteg.DT;
+
+    // Compute the new state mean value
+    Eigen::Matrix<double,3,3> R_Gtok = state->_imu->Rot();
+    Eigen::Vector4d new_q = rot_2_quat(preinteg.R_k2tau*R_Gtok);
+    Eigen::Vector3d new_v = state->_imu->vel() + R_Gtok.transpose()*preinteg.beta_tau - _gravity*DT;
+    Eigen::Vector3d new_p = state->_imu->pos() + state->_imu->vel()*DT + R_Gtok.transpose()*preinteg.alpha_tau - 0.5*_gravity*DT*DT;
+
+    // Get the locations of each entry of the imu state
+    int th_id = state->_imu->q()->id()-state->_imu->id();
+    int p_id = state->_imu->p()->id()-state->_imu->id();
+    int v_id = state->_imu->v()->id()-state->_imu->id();
+    int bg_id = state->_imu->bg()->id()-state->_imu->id();
+    int ba_id = state->_imu->ba()->id()-state->_imu->id();
+
+    // What we linearize about (first estimate if we are doing FEJ)
+    // Note that if we are not doing FEJ then the orientation and position/velocity changes are just the preintegrated measurements
+    Eigen::Matrix<double,3,3> R_lin = (state->_options.do_fej)? state->_imu->Rot_fej() : R_Gtok;
+    Eigen::Matrix<double,3,1> v_lin = (state->_options.do_fej)? state->_imu->vel_fej() : state->_imu->vel();
+    Eigen::Matrix<double,3,1> p_lin = (state->_options.do_fej)? state->_imu->pos_fej() : state->_imu->pos();
+
+    // Now compute Jacobian of new state wrt old state
+    F.setZero();
+    F.block(th_id, th_id, 3, 3).noalias() = quat_2_Rot(new_q)*R_lin.transpose();
+    F.block(th_id, bg_id, 3, 3) = -preinteg.J_q;
+    F.block(bg_id, bg_id, 3, 3).setIdentity();
+    F.block(v_id, th_id, 3, 3).noalias() = -skew_x(new_v-v_lin+_gravity*DT)*R_lin.transpose();
+    F.block(v_id, v_id, 3, 3).setIdentity();
+    F.block(v_id, bg_id, 3, 3).noalias() = R_lin.transpose()*preinteg.J_b;
+    F.block(v_id, ba_id, 3, 3).noalias() = R_lin.transpose()*preinteg.H_b;
+    F.block(ba_id, ba_id, 3, 3).setIdentity();
+    F.block(p_id, th_id, 3, 3).noalias() = -skew_x(new_p-p_lin-v_lin*DT+0.5*_gravity*DT*DT)*R_lin.transpose();
+    F.block(p_id, v_id, 3, 3) = Eigen::Matrix<double,3,3>::Identity()*DT;
+    F.block(p_id, bg_id, 3, 3).noalias() = R_lin.transpose()*preinteg.J_a;
+    F.block(p_id, ba_id, 3, 3).noalias() = R_lin.transpose()*preinteg.H_a;
+    F.block(p_id, p_id, 3, 3).setIdentity();
+
+    // The preintegrated covariance is ordered (theta, bg, beta, ba, alpha) with beta and alpha in the k frame
+    // Thus we need to reorder it and rotate the velocity and position noise into the global frame
+    Eigen::Matrix<double,15,15> G = Eigen::Matrix<double,15,15>::Zero();
+    G.block(th_id, 0, 3, 3).setIdentity();
+    G.block(bg_id, 3, 3, 3).setIdentity();
+    G.block(v_id, 6, 3, 3) = R_lin.transpose();
+    G.block(ba_id, 9, 3, 3).setIdentity();
+    G.block(p_id, 12, 3, 3) = R_lin.transpose();
+    Qd.noalias() = G*preinteg.P_meas*G.transpose();
+    Qd = 0.5*(Qd+Qd.transpose());
+
+    //Now replace imu estimate and fej with propagated values
+    Eigen::Matrix<double,16,1> imu_x = state->_imu->value();
+    imu_x.block(0,0,4,1) = new_q;
+    imu_x.block(4,0,3,1) = new_p;
+    imu_x.block(7,0,3,1) = new_v;
+    state->_imu->set_value(imu_x);
+    state->_imu->set_fej(imu_x);
+
+}
+
+
 void Propagator::predict_mean_discrete(State *state, double dt,
                                         const Eigen::Vector3d &w_hat1, const Eigen::Vector3d &a_hat1,
                                         const Eigen::Vector3d &w_hat2, const Eigen::Vector3d &a_hat2,
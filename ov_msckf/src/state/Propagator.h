@@ -23,6 +23,7 @@
 
 
 #include "state/StateHelper.h"
+#include "cpi/CpiV1.h"
 #include "utils/quat_ops.h"
 
 
@@ -151,6 +152,32 @@ namespace ov_msckf {
         }
 
 
+        /**
+         * @brief Gets the buffered inertial readings and the time offset used in the last propagation
+         * @param data IMU readings we currently have stored
+         * @param time_offset Estimate of the time offset at the last propagation
+         * @return True if we have propagated at least once (i.e. the time offset is valid)
+         */
+        bool get_imu_buffer(std::vector<IMUDATA> &data, double &time_offset) {
+            data = imu_data;
+            time_offset = last_prop_time_offset;
+            return have_last_prop_time_offset;
+        }
+
+
+        /**
+         * @brief Overwrites the buffered inertial readings (i.e. when restoring from a snapshot)
+         * @param data IMU readings we should store (should be sorted in time)
+         * @param time_offset Estimate of the time offset at the last propagation
+         * @param have_time_offset If we have propagated at least once
+         */
+        void set_imu_buffer(const std::vector<IMUDATA> &data, double time_offset, bool have_time_offset) {
+            imu_data = data;
+            last_prop_time_offset = time_offset;
+            have_last_prop_time_offset = have_time_offset;
+        }
+
+
         /**
          * @brief Propagate state up to given timestamp and then clone
          *
@@ -236,12 +263,37 @@ namespace ov_msckf {
          * @param state Pointer to state
          * @param data_minus imu readings at beginning of interval
          * @param data_plus imu readings at end of interval
+         * @param exp_w_dt Exponential of the bias corrected orientation change, exp_so3(-w_hat*dt)
+         * @param Jr_w_dt Right Jacobian of the bias corrected orientation change, Jr_so3(-w_hat*dt)
          * @param F State-transition matrix over the interval
          * @param Qd Discrete-time noise covariance over the interval
          */
         void predict_and_compute(State *state, const IMUDATA data_minus, const IMUDATA data_plus,
+                                 const Eigen::Matrix<double, 3, 3> &exp_w_dt, const Eigen::Matrix<double, 3, 3> &Jr_w_dt,
                                  Eigen::Matrix<double, 15, 15> &F, Eigen::Matrix<double, 15, 15> &Qd);
 
+        /**
+         * @brief Propagates the state forward over all imu readings using continuous preintegration.
+         *
+         * Instead of chaining a state transition and noise covariance for every reading, we preintegrate all readings
+         * with CpiV1 about our current bias estimate, and then compute the state transition and noise of the whole interval in closed form.
+         * Using the preintegrated measurements (in the frame of the IMU at the start of the interval, k) we have:
+         * \f{align*}{
+         * \text{}^{I_{k+1}}_{G}\hat{\mathbf{R}} &= \text{}^{I_{k+1}}_{I_{k}}\hat{\mathbf{R}}~\text{}^{I_{k}}_{G}\hat{\mathbf{R}} \\
+         * ^G\hat{\mathbf{v}}_{k+1} &= \text{}^G\hat{\mathbf{v}}_{k} - {}^G\mathbf{g}\Delta T + \text{}^{I_k}_G\hat{\mathbf{R}}^\top\boldsymbol{\beta} \\
+         * ^G\hat{\mathbf{p}}_{k+1} &= \text{}^G\hat{\mathbf{p}}_{k} + {}^G\hat{\mathbf{v}}_{k}\Delta T - \frac{1}{2}{}^G\mathbf{g}\Delta T^2 + \text{}^{I_k}_G\hat{\mathbf{R}}^\top\boldsymbol{\alpha}
+         * \f}
+         * The bias Jacobians of the preintegrated measurements give the state transition in respect to the biases,
+         * while the preintegrated measurement covariance is rotated into the global frame to get the noise of the interval.
+         *
+         * @param state Pointer to state
+         * @param prop_data imu readings we will integrate over (at least two)
+         * @param F State-transition matrix over the interval
+         * @param Qd Discrete-time noise covariance over the interval
+         */
+        void predict_and_compute_cpi(State *state, const std::vector<IMUDATA> &prop_data,
+                                     Eigen::Matrix<double, 15, 15> &F, Eigen::Matrix<double, 15, 15> &Qd);
+
         /**
          * @brief Discrete imu mean propagation.
          *
@@ -19,6 +19,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "State.h"
+#include "StateHelper.h"
 
 
 using namespace ov_core;
@@ -94,5 +95,9 @@ State::State(StateOptions &options) {
             _Cov.block(_cam_intrinsics.at(i)->id()+4,_cam_intrinsics.at(i)->id()+4,4,4) = std::pow(0.005,2)*Eigen::MatrixXd::Identity(4,4);
         }
     }
+
+    // Cache which of our variables are Schmidt consider states
+    StateHelper::update_consider_variables(this);
+
 }
 
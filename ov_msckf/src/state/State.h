@@ -119,12 +119,18 @@ namespace ov_msckf {
         // This prevents a developer from thinking that the "insert clone" will actually correctly add it to the covariance
         friend class StateHelper;
 
+        // Snapshots need to save and restore the full covariance and variable ordering
+        friend class VioSnapshot;
+
         /// Covariance of all active variables
         Eigen::MatrixXd _Cov;
 
         /// Vector of variables
         std::vector<Type*> _variables;
 
+        /// Variables which are updated, and those which are Schmidt "consider" states (see StateHelper::update_consider_variables())
+        std::vector<Type*> _variables_active, _variables_consider;
+
 
     };
 
@@ -35,14 +35,17 @@ void StateHelper::EKFPropagation(State *state, const std::vector<Type*> &order_N
         std::exit(EXIT_FAILURE);
     }
 
-    // Loop through our Phi order and ensure that they are continuous in memory
+    // Loop through our Phi order and check if they are continuous in memory
+    // If they are not, then they need to at least be in the same order as the state
     int size_order_NEW = order_NEW.at(0)->size();
+    bool is_contiguous = true;
     for(size_t i=0; i<order_NEW.size()-1; i++) {
-        if(order_NEW.at(i)->id()+order_NEW.at(i)->size()!=order_NEW.at(i+1)->id()) {
-            printf(RED "StateHelper::EKFPropagation() - Called with non-contiguous state elements!\n" RESET);
+        if(order_NEW.at(i)->id()+order_NEW.at(i)->size()>order_NEW.at(i+1)->id()) {
+            printf(RED "StateHelper::EKFPropagation() - Called with state elements that are not increasing!\n" RESET);
             printf(RED "StateHelper::EKFPropagation() - This code only support a state transition which is in the same order as the state\n" RESET);
             std::exit(EXIT_FAILURE);
         }
+        is_contiguous = is_contiguous && (order_NEW.at(i)->id()+order_NEW.at(i)->size()==order_NEW.at(i+1)->id());
         size_order_NEW += order_NEW.at(i+1)->size();
     }
 
@@ -85,12 +88,30 @@ void StateHelper::EKFPropagation(State *state, const std::vector<Type*> &order_N
     }
 
     // We are good to go!
-    int start_id = order_NEW.at(0)->id();
-    int phi_size = Phi.rows();
     int total_size = state->_Cov.rows();
-    state->_Cov.block(start_id,0,phi_size,total_size) = Cov_PhiT.transpose();
-    state->_Cov.block(0,start_id,total_size,phi_size) = Cov_PhiT;
-    state->_Cov.block(start_id,start_id,phi_size,phi_size) = Phi_Cov_PhiT;
+    if(is_contiguous) {
+        int start_id = order_NEW.at(0)->id();
+        int phi_size = Phi.rows();
+        state->_Cov.block(start_id,0,phi_size,total_size) = Cov_PhiT.transpose();
+        state->_Cov.block(0,start_id,total_size,phi_size) = Cov_PhiT;
+        state->_Cov.block(start_id,start_id,phi_size,phi_size) = Phi_Cov_PhiT;
+    } else {
+        // Sparse set of new variables, we first overwrite their crossterms and then their own blocks
+        std::vector<int> Phi_new_id;
+        current_it = 0;
+        for (Type *var: order_NEW) {
+            Phi_new_id.push_back(current_it);
+            state->_Cov.block(var->id(),0,var->size(),total_size) = Cov_PhiT.block(0,current_it,total_size,var->size()).transpose();
+            state->_Cov.block(0,var->id(),total_size,var->size()) = Cov_PhiT.block(0,current_it,total_size,var->size());
+            current_it += var->size();
+        }
+        for (size_t i=0; i<order_NEW.size(); i++) {
+            for (size_t j=0; j<order_NEW.size(); j++) {
+                state->_Cov.block(order_NEW.at(i)->id(),order_NEW.at(j)->id(),order_NEW.at(i)->size(),order_NEW.at(j)->size())
+                        = Phi_Cov_PhiT.block(Phi_new_id.at(i),Phi_new_id.at(j),order_NEW.at(i)->size(),order_NEW.at(j)->size());
+            }
+        }
+    }
 
     // We should check if we are not positive semi-definitate (i.e. negative diagionals is not s.p.d)
     Eigen::VectorXd diags = state->_Cov.diagonal();
@@ -106,8 +127,8 @@ void StateHelper::EKFPropagation(State *state, const std::vector<Type*> &order_N
 }
 
 
-void StateHelper::EKFUpdate(State *state, const std::vector<Type *> &H_order, const Eigen::MatrixXd &H,
-                            const Eigen::VectorXd &res, const Eigen::MatrixXd &R) {
+void StateHelper::EKFUpdate(State *state, const std::vector<Type *> &H_order, const Eigen::Ref<const Eigen::MatrixXd> &H,
+                            const Eigen::Ref<const Eigen::VectorXd> &res, const Eigen::Ref<const Eigen::MatrixXd> &R) {
 
     //==========================================================
     //==========================================================
@@ -152,14 +173,65 @@ void StateHelper::EKFUpdate(State *state, const std::vector<Type *> &H_order, co
     // Invert our S (should we use a more stable method here??)
     Eigen::MatrixXd Sinv = Eigen::MatrixXd::Identity(R.rows(), R.rows());
     S.selfadjointView<Eigen::Upper>().llt().solveInPlace(Sinv);
-    Eigen::MatrixXd K = M_a * Sinv.selfadjointView<Eigen::Upper>();
-    //Eigen::MatrixXd K = M_a * S.inverse();
+
+    // Gain of the variables we update, and the row of each of those variables in it
+    Eigen::MatrixXd K;
+    std::vector<int> K_id;
+    const std::vector<Type*> &vars_a = state->_variables_active;
+    const std::vector<Type*> &vars_c = state->_variables_consider;
 
     // Update Covariance
-    state->_Cov.triangularView<Eigen::Upper>() -= K * M_a.transpose();
-    state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
-    //Cov -= K * M_a.transpose();
-    //Cov = 0.5*(Cov+Cov.transpose());
+    if(vars_c.empty()) {
+        K = M_a * Sinv.selfadjointView<Eigen::Upper>();
+        //Eigen::MatrixXd K = M_a * S.inverse();
+        state->_Cov.triangularView<Eigen::Upper>() -= K * M_a.transpose();
+        state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
+        //Cov -= K * M_a.transpose();
+        //Cov = 0.5*(Cov+Cov.transpose());
+        for (Type *var: vars_a) {
+            K_id.push_back(var->id());
+        }
+    } else {
+        // With a Schmidt gain K = [K_a; 0] we have P_aa -= K_a*M_a', P_ac -= K_a*M_c' and P_cc is unchanged
+        // Thus we only compute the gain of the active rows, and never touch the consider-consider blocks
+        // First gather the active and consider rows of M into small contiguous matrices
+        int size_a = 0, size_c = 0;
+        for (Type *var: vars_a) size_a += var->size();
+        for (Type *var: vars_c) size_c += var->size();
+        Eigen::MatrixXd M_act(size_a, res.rows()), M_con(size_c, res.rows());
+        int ct_a = 0, ct_c = 0;
+        for (Type *var: vars_a) {
+            K_id.push_back(ct_a);
+            M_act.block(ct_a, 0, var->size(), res.rows()) = M_a.block(var->id(), 0, var->size(), res.rows());
+            ct_a += var->size();
+        }
+        for (Type *var: vars_c) {
+            M_con.block(ct_c, 0, var->size(), res.rows()) = M_a.block(var->id(), 0, var->size(), res.rows());
+            ct_c += var->size();
+        }
+        K = M_act * Sinv.selfadjointView<Eigen::Upper>();
+
+        // Change of the active-active (only the upper triangular since it is symmetric) and active-consider covariance
+        Eigen::MatrixXd dP_aa = Eigen::MatrixXd::Zero(size_a, size_a);
+        dP_aa.triangularView<Eigen::Upper>() = K * M_act.transpose();
+        dP_aa = dP_aa.selfadjointView<Eigen::Upper>();
+        Eigen::MatrixXd dP_ac = K * M_con.transpose();
+
+        // Update the active-active and active-consider blocks, and mirror the active-consider ones to the consider-active
+        for (size_t i = 0; i < vars_a.size(); i++) {
+            Type *var_a = vars_a.at(i);
+            for (size_t j = 0; j < vars_a.size(); j++) {
+                Type *var_b = vars_a.at(j);
+                state->_Cov.block(var_a->id(), var_b->id(), var_a->size(), var_b->size()) -= dP_aa.block(K_id.at(i), K_id.at(j), var_a->size(), var_b->size());
+            }
+            ct_c = 0;
+            for (Type *var_c: vars_c) {
+                state->_Cov.block(var_a->id(), var_c->id(), var_a->size(), var_c->size()) -= dP_ac.block(K_id.at(i), ct_c, var_a->size(), var_c->size());
+                state->_Cov.block(var_c->id(), var_a->id(), var_c->size(), var_a->size()) = state->_Cov.block(var_a->id(), var_c->id(), var_a->size(), var_c->size()).transpose();
+                ct_c += var_c->size();
+            }
+        }
+    }
 
     // We should check if we are not positive semi-definitate (i.e. negative diagionals is not s.p.d)
     Eigen::VectorXd diags = state->_Cov.diagonal();
@@ -173,16 +245,60 @@ void StateHelper::EKFUpdate(State *state, const std::vector<Type *> &H_order, co
     assert(!found_neg);
 
     // Calculate our delta and update all our active states
+    // Note that the Schmidt consider states keep their current mean
     Eigen::VectorXd dx = K*res;
-    for (size_t i = 0; i < state->_variables.size(); i++) {
-        state->_variables.at(i)->update(dx.block(state->_variables.at(i)->id(), 0, state->_variables.at(i)->size(), 1));
+    for (size_t i = 0; i < vars_a.size(); i++) {
+        vars_a.at(i)->update(dx.block(K_id.at(i), 0, vars_a.at(i)->size(), 1));
+    }
+
+}
+
+
+
+void StateHelper::update_consider_variables(State *state) {
+    state->_variables_active.clear();
+    state->_variables_consider.clear();
+    for (Type *var: state->_variables) {
+        if(is_consider_variable(state, var)) state->_variables_consider.push_back(var);
+        else state->_variables_active.push_back(var);
+    }
+}
+
+
+
+bool StateHelper::is_consider_variable(State *state, Type *var) {
+
+    // Calibration variables
+    if(state->_options.do_schmidt_calibration) {
+        if(var == state->_calib_dt_CAMtoIMU)
+            return true;
+        for(const auto& calib : state->_calib_IMUtoCAM) {
+            if(var == calib.second) return true;
+        }
+        for(const auto& calib : state->_cam_intrinsics) {
+            if(var == calib.second) return true;
+        }
     }
 
+    // SLAM features (these are the only landmarks in our state)
+    if(state->_options.do_schmidt_slam && dynamic_cast<Landmark*>(var) != nullptr) {
+        return true;
+    }
+    return false;
+
 }
 
 
 
 Eigen::MatrixXd StateHelper::get_marginal_covariance(State *state, const std::vector<Type *> &small_variables) {
+    Eigen::MatrixXd Small_cov;
+    get_marginal_covariance(state, small_variables, Small_cov);
+    return Small_cov;
+}
+
+
+
+void StateHelper::get_marginal_covariance(State *state, const std::vector<Type *> &small_variables, Eigen::MatrixXd &Small_cov) {
 
     // Calculate the marginal covariance size we need to make our matrix
     int cov_size = 0;
@@ -191,7 +307,7 @@ Eigen::MatrixXd StateHelper::get_marginal_covariance(State *state, const std::ve
     }
 
     // Construct our return covariance
-    Eigen::MatrixXd Small_cov = Eigen::MatrixXd::Zero(cov_size, cov_size);
+    Small_cov.setZero(cov_size, cov_size);
 
     // For each variable, lets copy over all other variable cross terms
     // Note: this copies over itself to when i_index=k_index
@@ -208,7 +324,6 @@ Eigen::MatrixXd StateHelper::get_marginal_covariance(State *state, const std::ve
 
     // Return the covariance
     //Small_cov = 0.5*(Small_cov+Small_cov.transpose());
-    return Small_cov;
 }
 
 
@@ -297,10 +412,36 @@ void StateHelper::marginalize(State *state, Type *marg) {
 
     // Now set variables as the remaining ones
     state->_variables = remaining_variables;
+    update_consider_variables(state);
 
 }
 
 
+void StateHelper::insert_variable(State *state, Type *new_variable, const Eigen::MatrixXd &cov) {
+
+    // Check that this new variable is not already in our state
+    if (std::find(state->_variables.begin(), state->_variables.end(), new_variable) != state->_variables.end()) {
+        printf(RED "StateHelper::insert_variable() - Called on variable that is already in the state\n" RESET);
+        std::exit(EXIT_FAILURE);
+    }
+    assert(cov.rows() == new_variable->size());
+    assert(cov.cols() == new_variable->size());
+
+    // Resize our covariance (new crossterms are zero) and append the prior
+    int old_size = (int)state->_Cov.rows();
+    int total_size = new_variable->size();
+    state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(old_size + total_size, old_size + total_size));
+    state->_Cov.block(old_size, old_size, total_size, total_size) = cov;
+
+    // Add to variable list
+    new_variable->set_local_id(old_size);
+    state->_variables.push_back(new_variable);
+    update_consider_variables(state);
+
+}
+
+
+
 Type* StateHelper::clone(State *state, Type *variable_to_clone) {
 
     //Get total size of new cloned variables, and the old covariance size
@@ -337,6 +478,7 @@ Type* StateHelper::clone(State *state, Type *variable_to_clone) {
 
         // Add to variable list
         state->_variables.push_back(new_clone);
+        update_consider_variables(state);
         break;
 
     }
@@ -536,6 +678,7 @@ void StateHelper::initialize_invertible(State *state, Type *new_variable, const
     // Now collect results, and add it to the state variables
     new_variable->set_local_id(oldSize);
     state->_variables.push_back(new_variable);
+    update_consider_variables(state);
     //std::cout << new_variable->id() <<  " init dx = " << (H_Linv * res).transpose() << std::endl;
 
 }
@@ -50,7 +50,9 @@ namespace ov_msckf {
          * @brief Performs EKF propagation of the state covariance.
          *
          * The mean of the state should already have been propagated, thus just moves the covariance forward in time.
-         * The new states that we are propagating the old covariance into, should be **contiguous** in memory.
+         * The new states that we are propagating the old covariance into, should be in the same order as in the covariance.
+         * If they are **contiguous** in memory, we can directly write the new covariance as a single block.
+         * Otherwise (for example a sparse set of landmarks), each new variable block and its crossterms are written separately.
          * The user only needs to specify the sub-variables that this block is a function of.
          * \f[
          * \tilde{\mathbf{x}}' =
@@ -79,14 +81,43 @@ namespace ov_msckf {
 
         /**
          * @brief Performs EKF update of the state (see @ref linear-meas page)
+         *
+         * If any variables are Schmidt "consider" states (see is_consider_variable()), then their uncertainty is still used
+         * in the gain, but their mean and their own covariance block are not updated. Only the cross-covariance between
+         * the active and considered variables is changed. Thus only the gain of the active variables is computed, and only the
+         * active-active and active-consider blocks of the covariance are updated (the consider-consider block is never touched).
+         * The split into active and consider variables is cached in the state (see update_consider_variables()).
+         *
          * @param state Pointer to state
          * @param H_order Variable ordering used in the compressed Jacobian
          * @param H Condensed Jacobian of updating measurement
          * @param res residual of updating measurement
          * @param R updating measurement covariance
          */
-        static void EKFUpdate(State *state, const std::vector<Type *> &H_order, const Eigen::MatrixXd &H,
-                              const Eigen::VectorXd &res, const Eigen::MatrixXd &R);
+        static void EKFUpdate(State *state, const std::vector<Type *> &H_order, const Eigen::Ref<const Eigen::MatrixXd> &H,
+                              const Eigen::Ref<const Eigen::VectorXd> &res, const Eigen::Ref<const Eigen::MatrixXd> &R);
+
+        /**
+         * @brief Checks if a variable should be treated as a Schmidt "consider" state
+         *
+         * This is the case for the calibration variables if StateOptions::do_schmidt_calibration is set,
+         * and for the SLAM features if StateOptions::do_schmidt_slam is set.
+         *
+         * @param state Pointer to state
+         * @param var Variable we want to check
+         * @return True if we should not update this variable
+         */
+        static bool is_consider_variable(State *state, Type *var);
+
+        /**
+         * @brief Recomputes which of the state variables are active and which are Schmidt "consider" states
+         *
+         * This needs to be called whenever the set of variables in the state changes (this is done by all functions here
+         * which add or remove variables), so that EKFUpdate() does not need to check each variable on every update.
+         *
+         * @param state Pointer to state
+         */
+        static void update_consider_variables(State *state);
 
         /**
         * @brief For a given set of variables, this will this will calculate a smaller covariance.
@@ -101,6 +132,17 @@ namespace ov_msckf {
         */
         static Eigen::MatrixXd get_marginal_covariance(State *state, const std::vector<Type *> &small_variables);
 
+        /**
+        * @brief For a given set of variables, this will calculate a smaller covariance into an existing matrix.
+        *
+        * Same as get_marginal_covariance(), but the passed matrix is only reallocated if its size changes.
+        *
+        * @param state Pointer to state
+        * @param small_variables Vector of variables whose marginal covariance is desired
+        * @param Small_cov Marginal covariance of the passed variables
+        */
+        static void get_marginal_covariance(State *state, const std::vector<Type *> &small_variables, Eigen::MatrixXd &Small_cov);
+
 
         /**
          * @brief This gets the full covariance matrix.
@@ -129,6 +171,19 @@ namespace ov_msckf {
         static void marginalize(State *state, Type *marg);
 
 
+        /**
+         * @brief Inserts a new variable at the end of the covariance with the given prior
+         *
+         * The new variable is assumed to be uncorrelated with the current state (i.e. zero cross-covariance).
+         * This is used to re-enable estimation of a variable which was previously marginalized, and is now a fixed parameter.
+         *
+         * @param state Pointer to state
+         * @param new_variable Pointer to variable to be inserted (should not be in the state)
+         * @param cov Prior covariance of this variable (size of the new variable)
+         */
+        static void insert_variable(State *state, Type *new_variable, const Eigen::MatrixXd &cov);
+
+
         /**
          * @brief Clones "variable to clone" and places it at end of covariance
          * @param state Pointer to state
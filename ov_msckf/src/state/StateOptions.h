@@ -42,6 +42,9 @@ namespace ov_msckf {
         /// Bool to determine if we should use Rk4 imu integration
         bool use_rk4_integration = true;
 
+        /// Bool to determine if we should propagate with continuous preintegration (CpiV1) instead of per reading state transitions
+        bool use_cpi_propagation = false;
+
         /// Bool to determine whether or not to calibrate imu-to-camera pose
         bool do_calib_camera_pose = false;
 
@@ -51,6 +54,21 @@ namespace ov_msckf {
         /// Bool to determine whether or not to calibrate camera to IMU time offset
         bool do_calib_camera_timeoffset = false;
 
+        /// Bool to determine if the enabled calibration states are treated as Schmidt "consider" states (not updated)
+        bool do_schmidt_calibration = false;
+
+        /// Bool to determine if our SLAM features are treated as Schmidt "consider" states (not updated after initialization)
+        bool do_schmidt_slam = false;
+
+        /// Bool to determine if we should marginalize out the calibration once it has converged (keeping it as fixed parameters)
+        bool do_calib_freeze = false;
+
+        /// Number of consecutive updates that the calibration needs to be stable for before it is frozen
+        int calib_freeze_window = 50;
+
+        /// Max relative change of the calibration std (and mean change relative to its std) for an update to be stable
+        double calib_freeze_rel_change = 0.01;
+
         /// Max clone size of sliding window
         int max_clone_size = 11;
 
@@ -83,9 +101,15 @@ namespace ov_msckf {
             printf("\t- use_fej: %d\n", do_fej);
             printf("\t- use_imuavg: %d\n", imu_avg);
             printf("\t- use_rk4int: %d\n", use_rk4_integration);
+            printf("\t- use_cpiprop: %d\n", use_cpi_propagation);
             printf("\t- calib_cam_extrinsics: %d\n", do_calib_camera_pose);
             printf("\t- calib_cam_intrinsics: %d\n", do_calib_camera_intrinsics);
             printf("\t- calib_cam_timeoffset: %d\n", do_calib_camera_timeoffset);
+            printf("\t- schmidt_calibration: %d\n", do_schmidt_calibration);
+            printf("\t- schmidt_slam: %d\n", do_schmidt_slam);
+            printf("\t- calib_freeze: %d\n", do_calib_freeze);
+            printf("\t- calib_freeze_window: %d\n", calib_freeze_window);
+            printf("\t- calib_freeze_rel_change: %.4f\n", calib_freeze_rel_change);
             printf("\t- max_clones: %d\n", max_clone_size);
             printf("\t- max_slam: %d\n", max_slam_features);
             printf("\t- max_slam_in_update: %d\n", max_slam_in_update);
@@ -0,0 +1,125 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_STATE_SNAPSHOT_H
+#define OV_MSCKF_STATE_SNAPSHOT_H
+
+
+#include <map>
+#include <vector>
+#include <Eigen/Eigen>
+#include <Eigen/StdVector>
+
+
+namespace ov_msckf {
+
+
+    /**
+     * @brief Immutable copy of the estimator output at a single update
+     *
+     * The VioManager publishes a new one of these after each update through an atomic pointer swap.
+     * Readers (e.g. visualization or pose consumers on other threads) can thus hold on to a snapshot
+     * for as long as they want without locking, and without racing the filter which continues to change the State.
+     * All landmarks are already converted into the global frame so readers do not need to recompute them.
+     */
+    struct StateSnapshot {
+
+        /// If the estimator was initialized when this was published
+        bool initialized = false;
+
+        /// Timestamp of the state (in the camera clock)
+        double timestamp = -1;
+
+        /// Timestamp of the state in the imu clock
+        double timestamp_inI = -1;
+
+        /// IMU state [q_GtoI,p_IinG,v_IinG,b_gyro,b_accel]
+        Eigen::Matrix<double,16,1> imu = Eigen::Matrix<double,16,1>::Zero();
+
+        /// Marginal covariance of the IMU in its error state ordering (q_GtoI,p_IinG,v_IinG,b_gyro,b_accel)
+        Eigen::Matrix<double,15,15> cov_imu = Eigen::Matrix<double,15,15>::Zero();
+
+        /// Time offset base IMU to camera (t_imu = t_cam + t_off)
+        double calib_dt_CAMtoIMU = 0;
+
+        /// Calibration poses for each camera [q_ItoC,p_IinC]
+        std::map<size_t, Eigen::VectorXd> calib_IMUtoCAM;
+
+        /// Camera intrinsics for each camera
+        std::map<size_t, Eigen::VectorXd> cam_intrinsics;
+
+        /// Clone poses in our sliding window [q_GtoIi,p_IiinG] (mapped by their camera timestamp)
+        std::map<double, Eigen::Matrix<double,7,1>> clones_IMU;
+
+        /// Marginal pose covariance (q_GtoIi,p_IiinG) of each clone (mapped by their camera timestamp)
+        std::map<double, Eigen::Matrix<double,6,6>, std::less<double>, Eigen::aligned_allocator<std::pair<const double, Eigen::Matrix<double,6,6>>>> clones_cov;
+
+        /// 3d MSCKF features used in the last update in the global frame
+        std::vector<Eigen::Vector3d> features_MSCKF;
+
+        /// 3d SLAM features in the global frame
+        std::vector<Eigen::Vector3d> features_SLAM;
+
+        /// 3d ARUCO features in the global frame
+        std::vector<Eigen::Vector3d> features_ARUCO;
+
+        /// Rotation from global to IMU (JPL quaternion)
+        Eigen::Matrix<double,4,1> quat() const {
+            return imu.block(0,0,4,1);
+        }
+
+        /// Position of the IMU in the global
+        Eigen::Matrix<double,3,1> pos() const {
+            return imu.block(4,0,3,1);
+        }
+
+        /// Velocity of the IMU in the global
+        Eigen::Matrix<double,3,1> vel() const {
+            return imu.block(7,0,3,1);
+        }
+
+        /// Gyroscope bias
+        Eigen::Matrix<double,3,1> bias_g() const {
+            return imu.block(10,0,3,1);
+        }
+
+        /// Accelerometer bias
+        Eigen::Matrix<double,3,1> bias_a() const {
+            return imu.block(13,0,3,1);
+        }
+
+        /// Marginal covariance of the IMU pose in the order position then orientation (as per ros convention)
+        Eigen::Matrix<double,6,6> cov_posori() const {
+            Eigen::Matrix<double,6,6> cov;
+            cov.block(0,0,3,3) = cov_imu.block(3,3,3,3);
+            cov.block(0,3,3,3) = cov_imu.block(3,0,3,3);
+            cov.block(3,0,3,3) = cov_imu.block(0,3,3,3);
+            cov.block(3,3,3,3) = cov_imu.block(0,0,3,3);
+            return cov;
+        }
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    };
+
+
+}
+
+#endif //OV_MSCKF_STATE_SNAPSHOT_H
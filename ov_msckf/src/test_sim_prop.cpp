@@ -0,0 +1,167 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Kevin Eckenhoff
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <cmath>
+#include <vector>
+#include <iomanip>
+#include <unistd.h>
+#include <csignal>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#ifdef ROS_AVAILABLE
+#include <ros/ros.h>
+#include "utils/parse_ros.h"
+#endif
+
+#include "core/VioManagerOptions.h"
+#include "sim/Simulator.h"
+#include "state/State.h"
+#include "state/StateHelper.h"
+#include "state/Propagator.h"
+#include "utils/quat_ops.h"
+#include "utils/parse_cmd.h"
+
+using namespace ov_msckf;
+
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) {
+    std::exit(signum);
+}
+
+
+// Main function
+// This will propagate two states between simulated camera times, one with the discrete propagator and one with CPI
+// Both are reset to the groundtruth at the start of each interval, so the error is the propagation error of that interval alone
+int main(int argc, char** argv)
+{
+
+    // Read in our paramters
+    VioManagerOptions params;
+#ifdef ROS_AVAILABLE
+    ros::init(argc, argv, "test_sim_prop");
+    ros::NodeHandle nh("~");
+    params = parse_ros_nodehandler(nh);
+#else
+    params = parse_command_line_arguments(argc, argv);
+#endif
+
+    // Create the simulator
+    Simulator sim(params);
+    double calib_dt = sim.get_true_paramters().calib_camimu_dt;
+
+    // Create our two states and propagators (discrete uses rk4 based on the passed options)
+    const size_t num_methods = 2;
+    const std::string names[num_methods] = {"discrete", "cpi"};
+    StateOptions options[num_methods] = {params.state_options, params.state_options};
+    options[0].use_cpi_propagation = false;
+    options[1].use_cpi_propagation = true;
+    std::vector<State*> states;
+    std::vector<Propagator*> propagators;
+    for(size_t m=0; m<num_methods; m++) {
+        states.push_back(new State(options[m]));
+        states.at(m)->_calib_dt_CAMtoIMU->set_value(Eigen::Matrix<double,1,1>::Constant(calib_dt));
+        states.at(m)->_calib_dt_CAMtoIMU->set_fej(Eigen::Matrix<double,1,1>::Constant(calib_dt));
+        propagators.push_back(new Propagator(params.imu_noises, params.gravity));
+    }
+
+    // Timing and error statistics for each method
+    std::vector<double> sum_time(num_methods,0.0), sum_ori(num_methods,0.0), sum_pos(num_methods,0.0);
+    size_t count = 0;
+    bool initialized = false;
+
+    // Continue to simulate until we have processed all the measurements
+    signal(SIGINT, signal_callback_handler);
+    while(sim.ok()) {
+
+        // IMU: get the next simulated IMU measurement if we have it
+        double time_imu;
+        Eigen::Vector3d wm, am;
+        bool hasimu = sim.get_next_imu(time_imu, wm, am);
+        if(hasimu) {
+            for(size_t m=0; m<num_methods; m++) {
+                propagators.at(m)->feed_imu(time_imu, wm, am);
+            }
+        }
+
+        // CAM: get the next simulated camera uv measurements if we have them
+        double time_cam;
+        std::vector<int> camids;
+        std::vector<std::vector<std::pair<size_t,Eigen::VectorXf>>> feats;
+        bool hascam = sim.get_next_cam(time_cam, camids, feats);
+        if(!hascam) {
+            continue;
+        }
+
+        // Groundtruth at this camera time (in the imu clock)
+        Eigen::Matrix<double,17,1> gt_new;
+        if(!sim.get_state(time_cam+calib_dt, gt_new)) {
+            continue;
+        }
+
+        // Propagate each state from the groundtruth at the last camera time
+        for(size_t m=0; m<num_methods && initialized; m++) {
+            State* state = states.at(m);
+            Eigen::Matrix<double,17,1> gt_old;
+            if(!sim.get_state(state->_timestamp+calib_dt, gt_old)) {
+                continue;
+            }
+            state->_imu->set_value(gt_old.block(1,0,16,1));
+            state->_imu->set_fej(gt_old.block(1,0,16,1));
+            boost::posix_time::ptime rT1 = boost::posix_time::microsec_clock::local_time();
+            propagators.at(m)->propagate_and_clone(state, time_cam);
+            boost::posix_time::ptime rT2 = boost::posix_time::microsec_clock::local_time();
+            StateHelper::marginalize_old_clone(state);
+            Eigen::Matrix3d R_err = state->_imu->Rot()*ov_core::quat_2_Rot(gt_new.block(1,0,4,1)).transpose();
+            sum_time.at(m) += (rT2-rT1).total_microseconds();
+            sum_ori.at(m) += 180.0/M_PI*ov_core::log_so3(R_err).norm();
+            sum_pos.at(m) += (state->_imu->pos()-gt_new.block(5,0,3,1)).norm();
+        }
+        if(initialized) {
+            count++;
+        }
+
+        // Start all states at the first camera time
+        if(!initialized) {
+            for(size_t m=0; m<num_methods; m++) {
+                states.at(m)->_timestamp = time_cam;
+            }
+            initialized = true;
+        }
+
+    }
+
+    // Print the average of each method
+    printf("propagated %d intervals with imu at %.1f hz and camera at %.1f hz\n", (int)count, params.sim_freq_imu, params.sim_freq_cam);
+    for(size_t m=0; m<num_methods && count>0; m++) {
+        printf("%-10s | %8.2f us/prop | ori err %.6f deg | pos err %.6f m\n", names[m].c_str(),
+               sum_time.at(m)/count, sum_ori.at(m)/count, sum_pos.at(m)/count);
+    }
+
+    // Done!
+    for(size_t m=0; m<num_methods; m++) {
+        delete states.at(m);
+        delete propagators.at(m);
+    }
+    return EXIT_SUCCESS;
+
+
+}
@@ -25,44 +25,100 @@ using namespace ov_core;
 using namespace ov_msckf;
 
 
-void UpdaterHelper::get_feature_jacobian_representation(State* state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
-                                                        std::vector<Eigen::MatrixXd> &H_x, std::vector<Type*> &x_order) {
+template<>
+void UpdaterHelper::get_representation_jacobian<LandmarkRepresentation::Representation::GLOBAL_3D>(const Eigen::Vector3d &p_FinX, Eigen::Matrix<double,3,3> &dpf_dlambda) {
+    dpf_dlambda.setIdentity();
+}
+
+
+template<>
+void UpdaterHelper::get_representation_jacobian<LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH>(const Eigen::Vector3d &p_FinX, Eigen::Matrix<double,3,3> &dpf_dlambda) {
+
+    // Get inverse depth representation (should match what is in Landmark.cpp)
+    double rho = 1/p_FinX.norm();
+    double phi = std::acos(rho*p_FinX(2));
+    //double theta = std::asin(rho*p_FinX(1)/std::sin(phi));
+    double theta = std::atan2(p_FinX(1),p_FinX(0));
+
+    // Get inverse depth bearings
+    double sin_th = std::sin(theta);
+    double cos_th = std::cos(theta);
+    double sin_phi = std::sin(phi);
+    double cos_phi = std::cos(phi);
+
+    // Construct the Jacobian
+    dpf_dlambda << -(1.0/rho)*sin_th*sin_phi, (1.0/rho)*cos_th*cos_phi, -(1.0/(rho*rho))*cos_th*sin_phi,
+            (1.0/rho)*cos_th*sin_phi, (1.0/rho)*sin_th*cos_phi, -(1.0/(rho*rho))*sin_th*sin_phi,
+            0.0, -(1.0/rho)*sin_phi, -(1.0/(rho*rho))*cos_phi;
+
+}
+
+
+template<>
+void UpdaterHelper::get_representation_jacobian<LandmarkRepresentation::Representation::ANCHORED_3D>(const Eigen::Vector3d &p_FinX, Eigen::Matrix<double,3,3> &dpf_dlambda) {
+    dpf_dlambda.setIdentity();
+}
+
+
+template<>
+void UpdaterHelper::get_representation_jacobian<LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH>(const Eigen::Vector3d &p_FinX, Eigen::Matrix<double,3,3> &dpf_dlambda) {
+    // Same as the global version, just in our anchor frame
+    get_representation_jacobian<LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH>(p_FinX, dpf_dlambda);
+}
+
+
+template<>
+void UpdaterHelper::get_representation_jacobian<LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH>(const Eigen::Vector3d &p_FinX, Eigen::Matrix<double,3,3> &dpf_dlambda) {
+
+    // Get inverse depth representation (should match what is in Landmark.cpp)
+    double alpha = p_FinX(0)/p_FinX(2);
+    double beta = p_FinX(1)/p_FinX(2);
+    double rho = 1/p_FinX(2);
+
+    // Jacobian of anchored 3D position wrt inverse depth parameters
+    dpf_dlambda << (1.0/rho), 0.0, -(1.0/(rho*rho))*alpha,
+            0.0, (1.0/rho), -(1.0/(rho*rho))*beta,
+            0.0, 0.0, -(1.0/(rho*rho));
+
+}
+
+
+template<>
+void UpdaterHelper::get_representation_jacobian<LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE>(const Eigen::Vector3d &p_FinX, Eigen::Matrix<double,3,3> &dpf_dlambda) {
+
+    // Get inverse depth representation (should match what is in Landmark.cpp)
+    double rho = 1.0/p_FinX(2);
+    Eigen::Vector3d bearing = rho*p_FinX;
+
+    // Jacobian of anchored 3D position wrt the single inverse depth (only the first column is used)
+    dpf_dlambda.setZero();
+    dpf_dlambda.col(0) = -(1.0/(rho*rho))*bearing;
+
+}
+
+
+
+template<LandmarkRepresentation::Representation rep>
+void UpdaterHelper::get_feature_jacobian_representation(State* state, UpdaterHelperFeature &feature, FeatureRepresentationJacobian &jacobian) {
+
+    // The feature needs to be in the representation we have been specialized for
+    assert(feature.feat_representation == rep);
+
+    // Our feature Jacobian size
+    jacobian.num_x = 0;
+    jacobian.size_f = (rep!=LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) ? 3 : 1;
 
     // Global XYZ representation
-    if (feature.feat_representation == LandmarkRepresentation::Representation::GLOBAL_3D) {
-        H_f.resize(3,3);
-        H_f.setIdentity();
+    if (rep == LandmarkRepresentation::Representation::GLOBAL_3D) {
+        get_representation_jacobian<LandmarkRepresentation::Representation::GLOBAL_3D>(feature.p_FinG, jacobian.H_f);
         return;
     }
 
     // Global inverse depth representation
-    if (feature.feat_representation == LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH) {
-
+    if (rep == LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH) {
         // Get the feature linearization point
         Eigen::Matrix<double,3,1> p_FinG = (state->_options.do_fej)? feature.p_FinG_fej : feature.p_FinG;
-
-        // Get inverse depth representation (should match what is in Landmark.cpp)
-        double g_rho = 1/p_FinG.norm();
-        double g_phi = std::acos(g_rho*p_FinG(2));
-        //double g_theta = std::asin(g_rho*p_FinG(1)/std::sin(g_phi));
-        double g_theta = std::atan2(p_FinG(1),p_FinG(0));
-        Eigen::Matrix<double,3,1> p_invFinG;
-        p_invFinG(0) = g_theta;
-        p_invFinG(1) = g_phi;
-        p_invFinG(2) = g_rho;
-
-        // Get inverse depth bearings
-        double sin_th = std::sin(p_invFinG(0,0));
-        double cos_th = std::cos(p_invFinG(0,0));
-        double sin_phi = std::sin(p_invFinG(1,0));
-        double cos_phi = std::cos(p_invFinG(1,0));
-        double rho = p_invFinG(2,0);
-
-        // Construct the Jacobian
-        H_f.resize(3,3);
-        H_f << -(1.0/rho)*sin_th*sin_phi, (1.0/rho)*cos_th*cos_phi, -(1.0/(rho*rho))*cos_th*sin_phi,
-                (1.0/rho)*cos_th*sin_phi, (1.0/rho)*sin_th*cos_phi, -(1.0/(rho*rho))*sin_th*sin_phi,
-                0.0, -(1.0/rho)*sin_phi, -(1.0/(rho*rho))*cos_phi;
+        get_representation_jacobian<LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH>(p_FinG, jacobian.H_f);
         return;
     }
 
@@ -76,10 +132,12 @@ void UpdaterHelper::get_feature_jacobian_representation(State* state, UpdaterHel
     assert(feature.anchor_cam_id!=-1);
 
     // Anchor pose orientation and position, and camera calibration for our anchor camera
-    Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(feature.anchor_cam_id)->Rot();
-    Eigen::Vector3d p_IinC = state->_calib_IMUtoCAM.at(feature.anchor_cam_id)->pos();
-    Eigen::Matrix3d R_GtoI = state->_clones_IMU.at(feature.anchor_clone_timestamp)->Rot();
-    Eigen::Vector3d p_IinG = state->_clones_IMU.at(feature.anchor_clone_timestamp)->pos();
+    PoseJPL* calibration = state->_calib_IMUtoCAM.at(feature.anchor_cam_id);
+    PoseJPL* clone_Ai = state->_clones_IMU.at(feature.anchor_clone_timestamp);
+    Eigen::Matrix3d R_ItoC = calibration->Rot();
+    Eigen::Vector3d p_IinC = calibration->pos();
+    Eigen::Matrix3d R_GtoI = clone_Ai->Rot();
+    Eigen::Vector3d p_IinG = clone_Ai->pos();
     Eigen::Vector3d p_FinA = feature.p_FinA;
 
     // If I am doing FEJ, I should FEJ the anchor states (should we fej calibration???)
@@ -88,105 +146,87 @@ void UpdaterHelper::get_feature_jacobian_representation(State* state, UpdaterHel
         // "Best" feature in the global frame
         Eigen::Vector3d p_FinG_best = R_GtoI.transpose() * R_ItoC.transpose()*(feature.p_FinA - p_IinC) + p_IinG;
         // Transform the best into our anchor frame using FEJ
-        R_GtoI = state->_clones_IMU.at(feature.anchor_clone_timestamp)->Rot_fej();
-        p_IinG = state->_clones_IMU.at(feature.anchor_clone_timestamp)->pos_fej();
+        R_GtoI = clone_Ai->Rot_fej();
+        p_IinG = clone_Ai->pos_fej();
         p_FinA = (R_GtoI.transpose()*R_ItoC.transpose()).transpose()*(p_FinG_best - p_IinG) + p_IinC;
     }
     Eigen::Matrix3d R_CtoG = R_GtoI.transpose()*R_ItoC.transpose();
 
     // Jacobian for our anchor pose
-    Eigen::Matrix<double,3,6> H_anc;
-    H_anc.block(0,0,3,3).noalias() = -R_GtoI.transpose()*skew_x(R_ItoC.transpose()*(p_FinA-p_IinC));
-    H_anc.block(0,3,3,3).setIdentity();
-
-    // Add anchor Jacobians to our return vector
-    x_order.push_back(state->_clones_IMU.at(feature.anchor_clone_timestamp));
-    H_x.push_back(H_anc);
+    jacobian.H_x[0].block(0,0,3,3).noalias() = -R_GtoI.transpose()*skew_x(R_ItoC.transpose()*(p_FinA-p_IinC));
+    jacobian.H_x[0].block(0,3,3,3).setIdentity();
+    jacobian.x_order[0] = clone_Ai;
+    jacobian.num_x = 1;
 
     // Get calibration Jacobians (for anchor clone)
     if (state->_options.do_calib_camera_pose) {
-        Eigen::Matrix<double,3,6> H_calib;
-        H_calib.block(0,0,3,3).noalias() = -R_CtoG*skew_x(p_FinA-p_IinC);
-        H_calib.block(0,3,3,3) = -R_CtoG;
-        x_order.push_back(state->_calib_IMUtoCAM.at(feature.anchor_cam_id));
-        H_x.push_back(H_calib);
+        jacobian.H_x[1].block(0,0,3,3).noalias() = -R_CtoG*skew_x(p_FinA-p_IinC);
+        jacobian.H_x[1].block(0,3,3,3) = -R_CtoG;
+        jacobian.x_order[1] = calibration;
+        jacobian.num_x = 2;
     }
 
-    // If we are doing anchored XYZ feature
-    if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_3D) {
-        H_f = R_CtoG;
-        return;
-    }
+    // Jacobian of the anchored position in respect to our representation
+    Eigen::Matrix<double,3,3> dpfa_dlambda;
+    get_representation_jacobian<rep>(p_FinA, dpfa_dlambda);
+    jacobian.H_f.noalias() = R_CtoG*dpfa_dlambda;
 
-    // If we are doing full inverse depth
-    if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH) {
-
-        // Get inverse depth representation (should match what is in Landmark.cpp)
-        double a_rho = 1/p_FinA.norm();
-        double a_phi = std::acos(a_rho*p_FinA(2));
-        double a_theta = std::atan2(p_FinA(1),p_FinA(0));
-        Eigen::Matrix<double,3,1> p_invFinA;
-        p_invFinA(0) = a_theta;
-        p_invFinA(1) = a_phi;
-        p_invFinA(2) = a_rho;
-
-        // Using anchored inverse depth
-        double sin_th = std::sin(p_invFinA(0,0));
-        double cos_th = std::cos(p_invFinA(0,0));
-        double sin_phi = std::sin(p_invFinA(1,0));
-        double cos_phi = std::cos(p_invFinA(1,0));
-        double rho = p_invFinA(2,0);
-        //assert(p_invFinA(2,0)>=0.0);
-
-        // Jacobian of anchored 3D position wrt inverse depth parameters
-        Eigen::Matrix<double,3,3> d_pfinA_dpinv;
-        d_pfinA_dpinv << -(1.0/rho)*sin_th*sin_phi, (1.0/rho)*cos_th*cos_phi, -(1.0/(rho*rho))*cos_th*sin_phi,
-                (1.0/rho)*cos_th*sin_phi, (1.0/rho)*sin_th*cos_phi, -(1.0/(rho*rho))*sin_th*sin_phi,
-                0.0, -(1.0/rho)*sin_phi, -(1.0/(rho*rho))*cos_phi;
-        H_f = R_CtoG*d_pfinA_dpinv;
-        return;
-    }
+}
 
-    // If we are doing the MSCKF version of inverse depth
-    if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH) {
-
-        // Get inverse depth representation (should match what is in Landmark.cpp)
-        Eigen::Matrix<double,3,1> p_invFinA_MSCKF;
-        p_invFinA_MSCKF(0) = p_FinA(0)/p_FinA(2);
-        p_invFinA_MSCKF(1) = p_FinA(1)/p_FinA(2);
-        p_invFinA_MSCKF(2) = 1/p_FinA(2);
-
-        // Using the MSCKF version of inverse depth
-        double alpha = p_invFinA_MSCKF(0,0);
-        double beta = p_invFinA_MSCKF(1,0);
-        double rho = p_invFinA_MSCKF(2,0);
-
-        // Jacobian of anchored 3D position wrt inverse depth parameters
-        Eigen::Matrix<double,3,3> d_pfinA_dpinv;
-        d_pfinA_dpinv << (1.0/rho), 0.0, -(1.0/(rho*rho))*alpha,
-                0.0, (1.0/rho), -(1.0/(rho*rho))*beta,
-                0.0, 0.0, -(1.0/(rho*rho));
-        H_f = R_CtoG*d_pfinA_dpinv;
-        return;
+
+
+template<>
+void UpdaterHelper::get_feature_jacobian_representation<LandmarkRepresentation::Representation::UNKNOWN>(State* state, UpdaterHelperFeature &feature, FeatureRepresentationJacobian &jacobian) {
+
+    // Call the version which has been specialized for the representation of this feature
+    switch(feature.feat_representation) {
+        case LandmarkRepresentation::Representation::GLOBAL_3D:
+            get_feature_jacobian_representation<LandmarkRepresentation::Representation::GLOBAL_3D>(state, feature, jacobian);
+            break;
+        case LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH:
+            get_feature_jacobian_representation<LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH>(state, feature, jacobian);
+            break;
+        case LandmarkRepresentation::Representation::ANCHORED_3D:
+            get_feature_jacobian_representation<LandmarkRepresentation::Representation::ANCHORED_3D>(state, feature, jacobian);
+            break;
+        case LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH:
+            get_feature_jacobian_representation<LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH>(state, feature, jacobian);
+            break;
+        case LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH:
+            get_feature_jacobian_representation<LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH>(state, feature, jacobian);
+            break;
+        case LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE:
+            get_feature_jacobian_representation<LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE>(state, feature, jacobian);
+            break;
+        default:
+            // Failure, invalid representation that is not programmed
+            assert(false);
+            return;
     }
 
-    /// CASE: Estimate single depth of the feature using the initial bearing
-    if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) {
+}
 
-        // Get inverse depth representation (should match what is in Landmark.cpp)
-        double rho = 1.0/p_FinA(2);
-        Eigen::Vector3d bearing = rho*p_FinA;
 
-        // Jacobian of anchored 3D position wrt inverse depth parameters
-        Eigen::Vector3d d_pfinA_drho;
-        d_pfinA_drho << -(1.0/(rho*rho))*bearing;
-        H_f = R_CtoG*d_pfinA_drho;
-        return;
 
-    }
+void UpdaterHelper::get_feature_jacobian_representation(State* state, UpdaterHelperFeature &feature, FeatureRepresentationJacobian &jacobian) {
+    get_feature_jacobian_representation<LandmarkRepresentation::Representation::UNKNOWN>(state, feature, jacobian);
+}
 
-    // Failure, invalid representation that is not programmed
-    assert(false);
+
+
+void UpdaterHelper::get_feature_jacobian_representation(State* state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+                                                        std::vector<Eigen::MatrixXd> &H_x, std::vector<Type*> &x_order) {
+
+    // Compute our fixed size Jacobians
+    FeatureRepresentationJacobian jacobian;
+    get_feature_jacobian_representation(state, feature, jacobian);
+
+    // Copy them into the dynamic ones
+    H_f = jacobian.H_f.block(0,0,3,jacobian.size_f);
+    for(int i=0; i<jacobian.num_x; i++) {
+        H_x.push_back(jacobian.H_x[i]);
+        x_order.push_back(jacobian.x_order[i]);
+    }
 
 }
 
@@ -305,62 +345,118 @@ void UpdaterHelper::get_feature_jacobian_intrinsics(State* state, const Eigen::V
 
 
 
+namespace {
+
+    /**
+     * @brief Calls the given function with the measurement times of each camera a feature has been seen from
+     *
+     * If the number of cameras is known at compile time, this loops over the passed array (indexed by camera id) in camera order.
+     * Otherwise this loops over the cameras in the feature itself.
+     *
+     * @param feature Feature we are looping over the cameras of
+     * @param cam_timestamps Measurement times of each camera (nullptr if not seen), only used if the number of cameras is known
+     * @param func Function which is called with the camera id and its measurement times
+     */
+    template<int NumCams, typename Func>
+    inline void for_each_camera(const UpdaterHelper::UpdaterHelperFeature &feature, const std::vector<double>* const *cam_timestamps, Func func) {
+        if(NumCams > 0) {
+            for(int cam_id = 0; cam_id < NumCams; cam_id++) {
+                if(cam_timestamps[cam_id] != nullptr) func((size_t)cam_id, *cam_timestamps[cam_id]);
+            }
+        } else {
+            for(const auto &pair : feature.timestamps) {
+                func(pair.first, pair.second);
+            }
+        }
+    }
+
+}
+
+
+template<int NumCams, LandmarkRepresentation::Representation rep>
 void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res, std::vector<Type*> &x_order) {
 
+    // The feature needs to be in the representation we have been specialized for
+    assert(rep == LandmarkRepresentation::Representation::UNKNOWN || feature.feat_representation == rep);
+
+    // If the representation is known, these are all resolved at compile time
+    const bool is_relative = (rep == LandmarkRepresentation::Representation::UNKNOWN)?
+            LandmarkRepresentation::is_relative_representation(feature.feat_representation) : LandmarkRepresentation::is_relative_representation(rep);
+
+    // If the number of cameras is known at compile time, we look up the measurements of each camera once into a small array
+    // This is indexed by camera id, so our loops over the cameras below have a fixed trip count
+    // If this feature has been seen from a camera id we have not been specialized for, then we fall back to the generic version
+    const std::vector<double>* cam_timestamps[(NumCams > 0)? NumCams : 1] = {nullptr};
+    if(NumCams > 0) {
+        for(const auto &pair : feature.timestamps) {
+            if(pair.first >= (size_t)NumCams) {
+                get_feature_jacobian_full<-1, LandmarkRepresentation::Representation::UNKNOWN>(state, feature, H_f, H_x, res, x_order);
+                return;
+            }
+            cam_timestamps[pair.first] = &pair.second;
+        }
+    }
+
     // Total number of measurements for this feature
     int total_meas = 0;
-    for (auto const& pair : feature.timestamps) {
-        total_meas += (int)pair.second.size();
-    }
+    for_each_camera<NumCams>(feature, cam_timestamps, [&](size_t cam_id, const std::vector<double> &timestamps) {
+        total_meas += (int)timestamps.size();
+    });
 
     // Compute the size of the states involved with this feature
+    // NOTE: only a handful of variables are involved, so we look up their column in H_x with a linear search of our order
+    // NOTE: this avoids allocating a hash map node for every variable of every feature
     int total_hx = 0;
-    std::unordered_map<Type*,size_t> map_hx;
-    for (auto const& pair : feature.timestamps) {
+    x_order.clear();
+    auto map_hx = [&x_order](Type* var) -> int {
+        int col = 0;
+        for(const auto &type : x_order) {
+            if(type == var) return col;
+            col += type->size();
+        }
+        return -1;
+    };
+    for_each_camera<NumCams>(feature, cam_timestamps, [&](size_t cam_id, const std::vector<double> &timestamps) {
 
         // Our extrinsics and intrinsics
-        PoseJPL *calibration = state->_calib_IMUtoCAM.at(pair.first);
-        Vec *distortion = state->_cam_intrinsics.at(pair.first);
+        PoseJPL *calibration = state->_calib_IMUtoCAM.at(cam_id);
+        Vec *distortion = state->_cam_intrinsics.at(cam_id);
 
         // If doing calibration extrinsics
         if(state->_options.do_calib_camera_pose) {
-            map_hx.insert({calibration,total_hx});
             x_order.push_back(calibration);
             total_hx += calibration->size();
         }
 
         // If doing calibration intrinsics
         if(state->_options.do_calib_camera_intrinsics) {
-            map_hx.insert({distortion,total_hx});
             x_order.push_back(distortion);
             total_hx += distortion->size();
         }
 
         // Loop through all measurements for this specific camera
-        for (size_t m = 0; m < feature.timestamps[pair.first].size(); m++) {
+        for (const double &timestamp : timestamps) {
 
             // Add this clone if it is not added already
-            PoseJPL *clone_Ci = state->_clones_IMU.at(feature.timestamps[pair.first].at(m));
-            if(map_hx.find(clone_Ci) == map_hx.end()) {
-                map_hx.insert({clone_Ci,total_hx});
+            PoseJPL *clone_Ci = state->_clones_IMU.at(timestamp);
+            if(map_hx(clone_Ci) == -1) {
                 x_order.push_back(clone_Ci);
                 total_hx += clone_Ci->size();
             }
 
         }
 
-    }
+    });
 
     // If we are using an anchored representation, make sure that the anchor is also added
-    if (LandmarkRepresentation::is_relative_representation(feature.feat_representation)) {
+    if (is_relative) {
 
         // Assert we have a clone
         assert(feature.anchor_cam_id != -1);
 
         // Add this anchor if it is not added already
         PoseJPL *clone_Ai = state->_clones_IMU.at(feature.anchor_clone_timestamp);
-        if(map_hx.find(clone_Ai) == map_hx.end()) {
-            map_hx.insert({clone_Ai,total_hx});
+        if(map_hx(clone_Ai) == -1) {
             x_order.push_back(clone_Ai);
             total_hx += clone_Ai->size();
         }
@@ -369,8 +465,7 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
         if(state->_options.do_calib_camera_pose) {
             // Add this anchor if it is not added already
             PoseJPL *clone_calib = state->_calib_IMUtoCAM.at(feature.anchor_cam_id);
-            if(map_hx.find(clone_calib) == map_hx.end()) {
-                map_hx.insert({clone_calib,total_hx});
+            if(map_hx(clone_calib) == -1) {
                 x_order.push_back(clone_calib);
                 total_hx += clone_calib->size();
             }
@@ -384,7 +479,7 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
     // Calculate the position of this feature in the global frame
     // If anchored, then we need to calculate the position of the feature in the global
     Eigen::Vector3d p_FinG = feature.p_FinG;
-    if(LandmarkRepresentation::is_relative_representation(feature.feat_representation)) {
+    if(is_relative) {
         // Assert that we have an anchor pose for this feature
         assert(feature.anchor_cam_id!=-1);
         // Get calibration for our anchor camera
@@ -400,50 +495,56 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
     // Calculate the position of this feature in the global frame FEJ
     // If anchored, then we can use the "best" p_FinG since the value of p_FinA does not matter
     Eigen::Vector3d p_FinG_fej = feature.p_FinG_fej;
-    if(LandmarkRepresentation::is_relative_representation(feature.feat_representation)) {
+    if(is_relative) {
         p_FinG_fej = p_FinG;
     }
 
     //=========================================================================
     //=========================================================================
 
-    // Allocate our residual and Jacobians
-    int c = 0;
-    int jacobsize = (feature.feat_representation!=LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) ? 3 : 1;
-    res = Eigen::VectorXd::Zero(2*total_meas);
-    H_f = Eigen::MatrixXd::Zero(2*total_meas,jacobsize);
-    H_x = Eigen::MatrixXd::Zero(2*total_meas,total_hx);
-
     // Derivative of p_FinG in respect to feature representation.
     // This only needs to be computed once and thus we pull it out of the loop
-    Eigen::MatrixXd dpfg_dlambda;
-    std::vector<Eigen::MatrixXd> dpfg_dx;
-    std::vector<Type*> dpfg_dx_order;
-    UpdaterHelper::get_feature_jacobian_representation(state, feature, dpfg_dlambda, dpfg_dx, dpfg_dx_order);
-
-    // Assert that all the ones in our order are already in our local jacobian mapping
-    for(auto &type : dpfg_dx_order) {
-        assert(map_hx.find(type)!=map_hx.end());
+    FeatureRepresentationJacobian dpfg;
+    UpdaterHelper::get_feature_jacobian_representation<rep>(state, feature, dpfg);
+
+    // Column of each extra state in our Jacobian (all of them should already be in our local jacobian mapping)
+    const int size_f = (rep == LandmarkRepresentation::Representation::UNKNOWN)? dpfg.size_f :
+            ((rep != LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE)? 3 : 1);
+    int dpfg_dx_cols[2] = {-1, -1};
+    for(int i=0; i<dpfg.num_x; i++) {
+        dpfg_dx_cols[i] = map_hx(dpfg.x_order[i]);
+        assert(dpfg_dx_cols[i]!=-1);
     }
 
+    // Allocate our residual and Jacobians
+    // NOTE: if the caller reuses these between features, this will only reallocate when the size changes
+    int c = 0;
+    res.setZero(2*total_meas);
+    H_f.setZero(2*total_meas,size_f);
+    H_x.setZero(2*total_meas,total_hx);
+
     // Loop through each camera for this feature
-    for (auto const& pair : feature.timestamps) {
+    for_each_camera<NumCams>(feature, cam_timestamps, [&](size_t cam_id, const std::vector<double> &timestamps) {
 
         // Our calibration between the IMU and CAMi frames
-        Vec* distortion = state->_cam_intrinsics.at(pair.first);
-        PoseJPL* calibration = state->_calib_IMUtoCAM.at(pair.first);
+        Vec* distortion = state->_cam_intrinsics.at(cam_id);
+        PoseJPL* calibration = state->_calib_IMUtoCAM.at(cam_id);
+        int col_calib = (state->_options.do_calib_camera_pose)? map_hx(calibration) : -1;
+        int col_distortion = (state->_options.do_calib_camera_intrinsics)? map_hx(distortion) : -1;
         Eigen::Matrix<double,3,3> R_ItoC = calibration->Rot();
         Eigen::Matrix<double,3,1> p_IinC = calibration->pos();
         Eigen::Matrix<double,8,1> cam_d = distortion->value();
+        bool is_fisheye = state->_cam_intrinsics_model.at(cam_id);
+        const std::vector<Eigen::VectorXf> &uvs = feature.uvs.at(cam_id);
 
         // Loop through all measurements for this specific camera
-        for (size_t m = 0; m < feature.timestamps[pair.first].size(); m++) {
+        for (size_t m = 0; m < timestamps.size(); m++) {
 
             //=========================================================================
             //=========================================================================
 
             // Get current IMU clone state
-            PoseJPL* clone_Ii = state->_clones_IMU.at(feature.timestamps[pair.first].at(m));
+            PoseJPL* clone_Ii = state->_clones_IMU.at(timestamps.at(m));
             Eigen::Matrix<double,3,3> R_GtoIi = clone_Ii->Rot();
             Eigen::Matrix<double,3,1> p_IiinG = clone_Ii->pos();
 
@@ -459,7 +560,7 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
             Eigen::Matrix<double,2,1> uv_dist;
 
             // Calculate distortion uv and jacobian
-            if(state->_cam_intrinsics_model.at(pair.first)) {
+            if(is_fisheye) {
 
                 // Calculate distorted coordinates for fisheye
                 double r = std::sqrt(uv_norm(0)*uv_norm(0)+uv_norm(1)*uv_norm(1));
@@ -491,7 +592,7 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
 
             // Our residual
             Eigen::Matrix<double,2,1> uv_m;
-            uv_m << (double)feature.uvs[pair.first].at(m)(0), (double)feature.uvs[pair.first].at(m)(1);
+            uv_m << (double)uvs.at(m)(0), (double)uvs.at(m)(1);
             res.block(2*c,0,2,1) = uv_m - uv_dist;
 
 
@@ -507,13 +608,13 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
                 p_FinIi = R_GtoIi*(p_FinG_fej-p_IiinG);
                 p_FinCi = R_ItoC*p_FinIi+p_IinC;
                 //uv_norm << p_FinCi(0)/p_FinCi(2),p_FinCi(1)/p_FinCi(2);
-                //cam_d = state->get_intrinsics_CAM(pair.first)->fej();
+                //cam_d = state->get_intrinsics_CAM(cam_id)->fej();
             }
 
             // Compute Jacobians in respect to normalized image coordinates and possibly the camera intrinsics
             Eigen::Matrix<double,2,2> dz_dzn = Eigen::Matrix<double,2,2>::Zero();
             Eigen::Matrix<double,2,8> dz_dzeta = Eigen::Matrix<double,2,8>::Zero();
-            UpdaterHelper::get_feature_jacobian_intrinsics(state, uv_norm, state->_cam_intrinsics_model.at(pair.first), cam_d, dz_dzn, dz_dzeta);
+            UpdaterHelper::get_feature_jacobian_intrinsics(state, uv_norm, is_fisheye, cam_d, dz_dzn, dz_dzeta);
 
             // Normalized coordinates in respect to projection function
             Eigen::Matrix<double,2,3> dzn_dpfc = Eigen::Matrix<double,2,3>::Zero();
@@ -537,15 +638,16 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
             Eigen::Matrix<double,2,3> dz_dpfg = dz_dpfc*dpfc_dpfg;
 
             // CHAINRULE: get the total feature Jacobian
-            H_f.block(2*c,0,2,H_f.cols()).noalias() = dz_dpfg*dpfg_dlambda;
+            if(size_f == 3) H_f.block<2,3>(2*c,0).noalias() = dz_dpfg*dpfg.H_f;
+            else H_f.block<2,1>(2*c,0).noalias() = dz_dpfg*dpfg.H_f.col(0);
 
             // CHAINRULE: get state clone Jacobian
-            H_x.block(2*c,map_hx[clone_Ii],2,clone_Ii->size()).noalias() = dz_dpfc*dpfc_dclone;
+            H_x.block<2,6>(2*c,map_hx(clone_Ii)).noalias() = dz_dpfc*dpfc_dclone;
 
             // CHAINRULE: loop through all extra states and add their
             // NOTE: we add the Jacobian here as we might be in the anchoring pose for this measurement
-            for(size_t i=0; i<dpfg_dx_order.size(); i++) {
-                H_x.block(2*c,map_hx[dpfg_dx_order.at(i)],2,dpfg_dx_order.at(i)->size()).noalias() += dz_dpfg*dpfg_dx.at(i);
+            for(int i=0; i<dpfg.num_x; i++) {
+                H_x.block<2,6>(2*c,dpfg_dx_cols[i]).noalias() += dz_dpfg*dpfg.H_x[i];
             }
 
 
@@ -562,13 +664,13 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
                 dpfc_dcalib.block(0,3,3,3) = Eigen::Matrix<double,3,3>::Identity();
 
                 // Chainrule it and add it to the big jacobian
-                H_x.block(2*c,map_hx[calibration],2,calibration->size()).noalias() += dz_dpfc*dpfc_dcalib;
+                H_x.block<2,6>(2*c,col_calib).noalias() += dz_dpfc*dpfc_dcalib;
 
             }
 
             // Derivative of measurement in respect to distortion parameters
             if(state->_options.do_calib_camera_intrinsics) {
-                H_x.block(2*c,map_hx[distortion],2,distortion->size()) = dz_dzeta;
+                H_x.block<2,8>(2*c,col_distortion) = dz_dzeta;
             }
 
             // Move the Jacobian and residual index forward
@@ -576,9 +678,34 @@ void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature
 
         }
 
-    }
+    });
+
+
+}
 
 
+
+void UpdaterHelper::get_feature_jacobian_full(State* state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res, std::vector<Type*> &x_order) {
+    get_feature_jacobian_full<-1, LandmarkRepresentation::Representation::UNKNOWN>(state, feature, H_f, H_x, res, x_order);
+}
+
+
+
+UpdaterHelper::FeatureJacobianFunction UpdaterHelper::get_feature_jacobian_full_function(int num_cameras, LandmarkRepresentation::Representation feat_representation) {
+
+    // Our most common configurations are specialized
+    if(num_cameras == 1 && feat_representation == LandmarkRepresentation::Representation::GLOBAL_3D)
+        return &UpdaterHelper::get_feature_jacobian_full<1, LandmarkRepresentation::Representation::GLOBAL_3D>;
+    if(num_cameras == 2 && feat_representation == LandmarkRepresentation::Representation::GLOBAL_3D)
+        return &UpdaterHelper::get_feature_jacobian_full<2, LandmarkRepresentation::Representation::GLOBAL_3D>;
+    if(num_cameras == 1 && feat_representation == LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH)
+        return &UpdaterHelper::get_feature_jacobian_full<1, LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH>;
+    if(num_cameras == 2 && feat_representation == LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH)
+        return &UpdaterHelper::get_feature_jacobian_full<2, LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH>;
+
+    // Otherwise we use the generic version
+    return &UpdaterHelper::get_feature_jacobian_full<-1, LandmarkRepresentation::Representation::UNKNOWN>;
+
 }
 
 
@@ -617,10 +744,22 @@ void UpdaterHelper::nullspace_project_inplace(Eigen::MatrixXd &H_f, Eigen::Matri
 
 void UpdaterHelper::measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res) {
 
+    // Compress, and then construct the smaller jacobian and residual
+    int r = measurement_compress_inplace(Eigen::Ref<Eigen::MatrixXd>(H_x), Eigen::Ref<Eigen::VectorXd>(res));
+    assert(r<=H_x.rows());
+    H_x.conservativeResize(r, H_x.cols());
+    res.conservativeResize(r, res.cols());
+
+}
+
+
+
+int UpdaterHelper::measurement_compress_inplace(Eigen::Ref<Eigen::MatrixXd> H_x, Eigen::Ref<Eigen::VectorXd> res) {
+
 
     // Return if H_x is a fat matrix (there is no need to compress in this case)
     if(H_x.rows() <= H_x.cols())
-        return;
+        return (int)H_x.rows();
 
     // Do measurement compression through givens rotations
     // Based on "Matrix Computations 4th Edition by Golub and Van Loan"
@@ -641,14 +780,113 @@ void UpdaterHelper::measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::Ve
 
     // If H is a fat matrix, then use the rows
     // Else it should be same size as our state
-    int r = std::min(H_x.rows(),H_x.cols());
-
-    // Construct the smaller jacobian and residual after measurement compression
-    assert(r<=H_x.rows());
-    H_x.conservativeResize(r, H_x.cols());
-    res.conservativeResize(r, res.cols());
+    return (int)std::min(H_x.rows(),H_x.cols());
 
 }
 
 
 
+
+
+
+void UpdaterHelper::select_features_inplace(State* state, std::vector<Feature*> &feature_vec, int max_features) {
+
+    // Return if we already are under our budget
+    if(max_features < 1) {
+        feature_vec.clear();
+        return;
+    }
+    if((int)feature_vec.size() <= max_features)
+        return;
+
+    // Get our clone timestamps, measurements at other times will not be used in the update
+    std::vector<double> clonetimes;
+    for(const auto& clone_imu : state->_clones_IMU) {
+        clonetimes.emplace_back(clone_imu.first);
+    }
+
+    // Parallax angle (radians) after which we say a feature is fully constrained
+    const double parallax_full = 2.0*M_PI/180.0;
+
+    // Grid we bin the newest normalized coordinate into for spatial spread
+    const int grid_size = 5;
+
+    // Compute the score and newest normalized measurement for each feature
+    std::vector<double> scores(feature_vec.size(), 0.0);
+    std::vector<Eigen::Vector2d> newest(feature_vec.size(), Eigen::Vector2d::Zero());
+    Eigen::Vector2d min_uv = Eigen::Vector2d::Constant(INFINITY);
+    Eigen::Vector2d max_uv = Eigen::Vector2d::Constant(-INFINITY);
+    for(size_t i=0; i<feature_vec.size(); i++) {
+
+        // Count measurements that occur at our clone times, and track the bearing extents
+        Feature* feat = feature_vec.at(i);
+        int num_valid = 0;
+        double min_cos = 1.0;
+        double newest_time = -1;
+        for(const auto& pair : feat->timestamps) {
+            const std::vector<Eigen::VectorXf>& uvs_norm = feat->uvs_norm.at(pair.first);
+            if(uvs_norm.empty())
+                continue;
+            Eigen::Vector3d b0;
+            b0 << uvs_norm.at(0)(0), uvs_norm.at(0)(1), 1;
+            b0.normalize();
+            for(size_t m=0; m<pair.second.size(); m++) {
+                if(std::binary_search(clonetimes.begin(), clonetimes.end(), pair.second.at(m)))
+                    num_valid++;
+                Eigen::Vector3d bm;
+                bm << uvs_norm.at(m)(0), uvs_norm.at(m)(1), 1;
+                min_cos = std::min(min_cos, b0.dot(bm.normalized()));
+                if(pair.second.at(m) > newest_time) {
+                    newest_time = pair.second.at(m);
+                    newest.at(i) << uvs_norm.at(m)(0), uvs_norm.at(m)(1);
+                }
+            }
+        }
+
+        // Rows of H_x after nullspace projection, weighted by how well the depth is constrained
+        // We keep a small floor so low parallax features are still ordered by their track length
+        double parallax = std::acos(std::max(-1.0, std::min(1.0, min_cos)));
+        double rows = std::max(0, 2*num_valid-3);
+        scores.at(i) = rows*std::max(0.1, std::min(1.0, parallax/parallax_full));
+        min_uv = min_uv.cwiseMin(newest.at(i));
+        max_uv = max_uv.cwiseMax(newest.at(i));
+
+    }
+
+    // Bin each feature into our grid, cells are sorted by score (best first)
+    std::vector<std::vector<size_t>> cells(grid_size*grid_size);
+    Eigen::Vector2d range = (max_uv-min_uv).cwiseMax(1e-6);
+    for(size_t i=0; i<feature_vec.size(); i++) {
+        int cx = std::min(grid_size-1, (int)(grid_size*(newest.at(i)(0)-min_uv(0))/range(0)));
+        int cy = std::min(grid_size-1, (int)(grid_size*(newest.at(i)(1)-min_uv(1))/range(1)));
+        cells.at(cy*grid_size+cx).push_back(i);
+    }
+    for(auto& cell : cells) {
+        std::stable_sort(cell.begin(), cell.end(), [&scores](size_t a, size_t b) {
+            return scores.at(a) > scores.at(b);
+        });
+    }
+
+    // Each round we take the best remaining feature from every cell
+    // Within a round we add the better features first so the budget cuts the weakest
+    std::vector<Feature*> selected;
+    size_t round = 0;
+    while((int)selected.size() < max_features) {
+        std::vector<size_t> candidates;
+        for(const auto& cell : cells) {
+            if(round < cell.size())
+                candidates.push_back(cell.at(round));
+        }
+        if(candidates.empty())
+            break;
+        std::stable_sort(candidates.begin(), candidates.end(), [&scores](size_t a, size_t b) {
+            return scores.at(a) > scores.at(b);
+        });
+        for(size_t i=0; i<candidates.size() && (int)selected.size()<max_features; i++) {
+            selected.push_back(feature_vec.at(candidates.at(i)));
+        }
+        round++;
+    }
+    feature_vec = selected;
+
+}
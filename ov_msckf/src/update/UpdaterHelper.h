@@ -91,6 +91,45 @@ namespace ov_msckf {
         };
 
 
+        /**
+         * @brief Fixed size Jacobians of the global feature position in respect to its representation
+         *
+         * Anchored representations have at most two extra states (the anchor clone and its camera calibration),
+         * while global representations have none, thus we can store everything without allocating.
+         */
+        struct FeatureRepresentationJacobian {
+
+            /// Jacobian in respect to the feature error state (only the first size_f columns are valid)
+            Eigen::Matrix<double,3,3> H_f = Eigen::Matrix<double,3,3>::Zero();
+
+            /// Size of the feature error state (3, or 1 for single depth)
+            int size_f = 3;
+
+            /// Jacobians in respect to the extra states (only the first num_x are valid)
+            Eigen::Matrix<double,3,6> H_x[2];
+
+            /// Extra states our Jacobians are in respect to (anchor clone then its calibration)
+            Type* x_order[2] = {nullptr, nullptr};
+
+            /// Number of extra states
+            int num_x = 0;
+
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        };
+
+
+        /**
+         * @brief This gets the feature and state Jacobian in respect to the feature representation
+         *
+         * This is the allocation free version which is used when constructing the full Jacobian of a feature.
+         *
+         * @param[in] state State of the filter system
+         * @param[in] feature Feature we want to get Jacobians of (must have feature means)
+         * @param[out] jacobian Fixed size Jacobians in respect to the feature and its extra states
+         */
+        static void get_feature_jacobian_representation(State* state, UpdaterHelperFeature &feature, FeatureRepresentationJacobian &jacobian);
+
         /**
          * @brief This gets the feature and state Jacobian in respect to the feature representation
          *
@@ -119,16 +158,39 @@ namespace ov_msckf {
         /**
          * @brief Will construct the "stacked" Jacobians for a single feature from all its measurements
          *
+         * All intermediate Jacobians are fixed size, and the outputs are written into the passed matrices.
+         * Thus a caller which reuses the same outputs for each feature will only allocate when their size changes.
+         *
          * @param[in] state State of the filter system
          * @param[in] feature Feature we want to get Jacobians of (must have feature means)
          * @param[out] H_f Jacobians in respect to the feature error state
          * @param[out] H_x Extra Jacobians in respect to the state (for example anchored pose)
          * @param[out] res Measurement residual for this feature
-         * @param[out] x_order Extra variables our extra Jacobian has (for example anchored pose)
+         * @param[out] x_order Extra variables our extra Jacobian has (for example anchored pose), this will be cleared first
          */
         static void get_feature_jacobian_full(State* state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res, std::vector<Type*> &x_order);
 
 
+        /// Function which constructs the "stacked" Jacobians for a single feature (see get_feature_jacobian_full())
+        typedef void (*FeatureJacobianFunction)(State* state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res, std::vector<Type*> &x_order);
+
+        /**
+         * @brief Selects the function we should use to construct the Jacobians of features for a given configuration
+         *
+         * For our most common configurations (one or two cameras, with global xyz or anchored full inverse depth features)
+         * this returns a version of get_feature_jacobian_full() specialized at compile time.
+         * This has loops over the cameras with a fixed trip count and no checks of the representation inside of its measurement loop.
+         * If a feature has been seen from a camera id outside of [0, num_cameras), it falls back to the generic version at runtime.
+         * Otherwise the generic get_feature_jacobian_full() is returned.
+         * This should be called once at construction, and all features passed to the returned function need to be in the given representation.
+         *
+         * @param num_cameras Number of cameras we have
+         * @param feat_representation Representation the features will be in
+         * @return Function to get the feature Jacobians with
+         */
+        static FeatureJacobianFunction get_feature_jacobian_full_function(int num_cameras, LandmarkRepresentation::Representation feat_representation);
+
+
         /**
          * @brief This will project the left nullspace of H_f onto the linear system.
          *
@@ -154,6 +216,84 @@ namespace ov_msckf {
          */
         static void measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res);
 
+        /**
+         * @brief This will perform measurement compression on a view into a larger matrix
+         *
+         * Same as the other measurement_compress_inplace(), but does not resize anything.
+         * Only the top rows given by the return value are valid after the call.
+         *
+         * @param H_x State jacobian
+         * @param res Measurement residual
+         * @return Number of rows of the compressed system
+         */
+        static int measurement_compress_inplace(Eigen::Ref<Eigen::MatrixXd> H_x, Eigen::Ref<Eigen::VectorXd> res);
+
+
+        /**
+         * @brief Selects the most informative subset of features for an update with a limited budget
+         *
+         * We score each feature using cheap proxies which can be computed before triangulation.
+         * The number of measurements at current clone times gives the rows of the feature H_x after nullspace projection (2m-3),
+         * which we scale by the maximum parallax angle of the bearings seen in the track (low parallax gives poor depth and thus weak constraints).
+         * To keep good spatial spread, the newest normalized measurement of each feature is binned into a grid and we
+         * pick features round-robin from each cell in order of their score.
+         * Features which are not selected are left untouched in the feature database so they can be used in a later update.
+         *
+         * @param state State of the filter system
+         * @param feature_vec Features that can be used for update (will be reduced to the selected ones)
+         * @param max_features Maximum number of features we will keep
+         */
+        static void select_features_inplace(State* state, std::vector<Feature*> &feature_vec, int max_features);
+
+
+    protected:
+
+
+        /**
+         * @brief Jacobian of the feature position in respect to a given representation
+         *
+         * Each representation has its own specialization so this compiles down to a fixed size kernel.
+         * The position is in the global frame for global representations, and in the anchor camera frame otherwise.
+         *
+         * @tparam rep Representation of the feature
+         * @param[in] p_FinX Position of the feature we linearize about
+         * @param[out] dpf_dlambda Jacobian of the position in respect to the representation (only first column for single depth)
+         */
+        template<LandmarkRepresentation::Representation rep>
+        static void get_representation_jacobian(const Eigen::Vector3d &p_FinX, Eigen::Matrix<double,3,3> &dpf_dlambda);
+
+        /**
+         * @brief This gets the feature and state Jacobian in respect to a representation known at compile time
+         *
+         * The UNKNOWN representation will use the representation of the feature.
+         *
+         * @tparam rep Representation of the feature
+         * @param[in] state State of the filter system
+         * @param[in] feature Feature we want to get Jacobians of (must have feature means)
+         * @param[out] jacobian Fixed size Jacobians in respect to the feature and its extra states
+         */
+        template<LandmarkRepresentation::Representation rep>
+        static void get_feature_jacobian_representation(State* state, UpdaterHelperFeature &feature, FeatureRepresentationJacobian &jacobian);
+
+        /**
+         * @brief Will construct the "stacked" Jacobians for a single feature for a number of cameras and representation known at compile time
+         *
+         * A number of cameras of -1 and the UNKNOWN representation are the generic version, which uses the number of cameras
+         * in our state options and the representation of the feature.
+         * Otherwise the camera loops have a fixed trip count and the representation checks are resolved at compile time.
+         *
+         * @tparam NumCams Number of cameras (-1 if unknown)
+         * @tparam rep Representation of the feature (UNKNOWN if not known)
+         * @param[in] state State of the filter system
+         * @param[in] feature Feature we want to get Jacobians of (must have feature means)
+         * @param[out] H_f Jacobians in respect to the feature error state
+         * @param[out] H_x Extra Jacobians in respect to the state (for example anchored pose)
+         * @param[out] res Measurement residual for this feature
+         * @param[out] x_order Extra variables our extra Jacobian has (for example anchored pose), this will be cleared first
+         */
+        template<int NumCams, LandmarkRepresentation::Representation rep>
+        static void get_feature_jacobian_full(State* state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res, std::vector<Type*> &x_order);
+
 
 
     };
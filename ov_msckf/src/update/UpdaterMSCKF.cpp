@@ -39,12 +39,9 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
     boost::posix_time::ptime rT0, rT1, rT2, rT3, rT4, rT5, rT6, rT7;
     rT0 =  boost::posix_time::microsec_clock::local_time();
 
-    // 0. Get all timestamps our clones are at (and thus valid measurement times)
-    std::vector<double> clonetimes;
-    for(const auto& clone_imu : state->_clones_IMU) {
-        clonetimes.emplace_back(clone_imu.first);
-    }
-
+    // 0. Get all timestamps our clones are at (and thus valid measurement times), and their camera poses
+    workspace.reset_clones(state);
+    const std::vector<double> &clonetimes = workspace.clonetimes;
 
     // 1. Clean all feature measurements and make sure they all have valid clone times
     auto it0 = feature_vec.begin();
@@ -70,27 +67,8 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
     }
     rT1 =  boost::posix_time::microsec_clock::local_time();
 
-    // 2. Create vector of cloned *CAMERA* poses at each of our clone timesteps
-    std::unordered_map<size_t, std::unordered_map<double, FeatureInitializer::ClonePose>> clones_cam;
-    for(const auto &clone_calib : state->_calib_IMUtoCAM) {
-
-        // For this camera, create the vector of camera poses
-        std::unordered_map<double, FeatureInitializer::ClonePose> clones_cami;
-        for(const auto &clone_imu : state->_clones_IMU) {
-
-            // Get current camera pose
-            Eigen::Matrix<double,3,3> R_GtoCi = clone_calib.second->Rot()*clone_imu.second->Rot();
-            Eigen::Matrix<double,3,1> p_CioinG = clone_imu.second->pos() - R_GtoCi.transpose()*clone_calib.second->pos();
-
-            // Append to our map
-            clones_cami.insert({clone_imu.first,FeatureInitializer::ClonePose(R_GtoCi,p_CioinG)});
-
-        }
-
-        // Append to our map
-        clones_cam.insert({clone_calib.first,clones_cami});
-
-    }
+    // 2. Our cloned *CAMERA* poses at each of our clone timesteps
+    auto &clones_cam = workspace.clones_cam;
 
     // 3. Try to triangulate all MSCKF or new SLAM features that have measurements
     auto it1 = feature_vec.begin();
@@ -133,12 +111,10 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
     }
 
     // Large Jacobian and residual of *all* features for this update
-    Eigen::VectorXd res_big = Eigen::VectorXd::Zero(max_meas_size);
-    Eigen::MatrixXd Hx_big = Eigen::MatrixXd::Zero(max_meas_size, max_hx_size);
-    std::unordered_map<Type*,size_t> Hx_mapping;
-    std::vector<Type*> Hx_order_big;
-    size_t ct_jacob = 0;
-    size_t ct_meas = 0;
+    workspace.reset_system(state, max_meas_size, max_hx_size);
+
+    // Marginal covariance of the clones and calibration which all features share (used for our chi2 check)
+    workspace.cache_marginal_covariance(state, false);
 
 
     // 4. Compute linear system for each feature, nullspace project, and reject
@@ -146,7 +122,7 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
     while(it2 != feature_vec.end()) {
 
         // Convert our feature into our current format
-        UpdaterHelper::UpdaterHelperFeature feat;
+        UpdaterHelper::UpdaterHelperFeature &feat = workspace.feat;
         feat.featid = (*it2)->featid;
         feat.uvs = (*it2)->uvs;
         feat.uvs_norm = (*it2)->uvs_norm;
@@ -170,22 +146,19 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
         }
 
         // Our return values (feature jacobian, state jacobian, residual, and order of state jacobian)
-        Eigen::MatrixXd H_f;
-        Eigen::MatrixXd H_x;
-        Eigen::VectorXd res;
-        std::vector<Type*> Hx_order;
+        Eigen::MatrixXd &H_f = workspace.H_f;
+        Eigen::MatrixXd &H_x = workspace.H_x;
+        Eigen::VectorXd &res = workspace.res;
+        std::vector<Type*> &Hx_order = workspace.Hx_order;
 
         // Get the Jacobian for this feature
-        UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
+        get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
 
         // Nullspace project
         UpdaterHelper::nullspace_project_inplace(H_f, H_x, res);
 
         /// Chi2 distance check
-        Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, Hx_order);
-        Eigen::MatrixXd S = H_x*P_marg*H_x.transpose();
-        S.diagonal() += _options.sigma_pix_sq*Eigen::VectorXd::Ones(S.rows());
-        double chi2 = res.dot(S.llt().solve(res));
+        double chi2 = workspace.chi2_distance(state, Hx_order, H_x, res, _options.sigma_pix_sq);
 
         // Get our threshold (we precompute up to 500 but handle the case that it is more)
         double chi2_check;
@@ -208,25 +181,7 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
         }
 
         // We are good!!! Append to our large H vector
-        size_t ct_hx = 0;
-        for(const auto &var : Hx_order) {
-
-            // Ensure that this variable is in our Jacobian
-            if(Hx_mapping.find(var)==Hx_mapping.end()) {
-                Hx_mapping.insert({var,ct_jacob});
-                Hx_order_big.push_back(var);
-                ct_jacob += var->size();
-            }
-
-            // Append to our large Jacobian
-            Hx_big.block(ct_meas,Hx_mapping[var],H_x.rows(),var->size()) = H_x.block(0,ct_hx,H_x.rows(),var->size());
-            ct_hx += var->size();
-
-        }
-
-        // Append our residual and move forward
-        res_big.block(ct_meas,0,res.rows(),1) = res;
-        ct_meas += res.rows();
+        workspace.append(Hx_order, H_x, res, _options.sigma_pix_sq);
         it2++;
 
     }
@@ -238,29 +193,30 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
         feature_vec[f]->to_delete = true;
     }
 
-    // Return if we don't have anything and resize our matrices
+    // Return if we don't have anything
+    size_t ct_meas = workspace.ct_meas;
+    size_t ct_jacob = workspace.ct_jacob;
     if(ct_meas < 1) {
         return;
     }
     assert(ct_meas<=max_meas_size);
     assert(ct_jacob<=max_hx_size);
-    res_big.conservativeResize(ct_meas,1);
-    Hx_big.conservativeResize(ct_meas,ct_jacob);
 
 
-    // 5. Perform measurement compression
-    UpdaterHelper::measurement_compress_inplace(Hx_big, res_big);
-    if(Hx_big.rows() < 1) {
+    // 5. Perform measurement compression (only on the part of our stacked system that we used)
+    int ct_compressed = UpdaterHelper::measurement_compress_inplace(workspace.Hx_big.topLeftCorner(ct_meas,ct_jacob), workspace.res_big.head(ct_meas));
+    if(ct_compressed < 1) {
         return;
     }
     rT4 =  boost::posix_time::microsec_clock::local_time();
 
 
     // Our noise is isotropic, so make it here after our compression
-    Eigen::MatrixXd R_big = _options.sigma_pix_sq*Eigen::MatrixXd::Identity(res_big.rows(),res_big.rows());
+    auto R_big = workspace.get_noise((size_t)ct_compressed);
+    R_big.diagonal().setConstant(_options.sigma_pix_sq);
 
     // 6. With all good features update the state
-    StateHelper::EKFUpdate(state, Hx_order_big, Hx_big, res_big, R_big);
+    StateHelper::EKFUpdate(state, workspace.Hx_order_big, workspace.Hx_big.topLeftCorner(ct_compressed,ct_jacob), workspace.res_big.head(ct_compressed), R_big);
     rT5 =  boost::posix_time::microsec_clock::local_time();
 
     // Debug print timing information
@@ -268,7 +224,7 @@ void UpdaterMSCKF::update(State *state, std::vector<Feature*>& feature_vec) {
     //printf("[MSCKF-UP]: %.4f seconds to triangulate\n",(rT2-rT1).total_microseconds() * 1e-6);
     //printf("[MSCKF-UP]: %.4f seconds create system (%d features)\n",(rT3-rT2).total_microseconds() * 1e-6, (int)feature_vec.size());
     //printf("[MSCKF-UP]: %.4f seconds compress system\n",(rT4-rT3).total_microseconds() * 1e-6);
-    //printf("[MSCKF-UP]: %.4f seconds update state (%d size)\n",(rT5-rT4).total_microseconds() * 1e-6, (int)res_big.rows());
+    //printf("[MSCKF-UP]: %.4f seconds update state (%d size)\n",(rT5-rT4).total_microseconds() * 1e-6, ct_compressed);
     //printf("[MSCKF-UP]: %.4f seconds total\n",(rT5-rT1).total_microseconds() * 1e-6);
 
 }
@@ -34,6 +34,7 @@
 
 #include "UpdaterHelper.h"
 #include "UpdaterOptions.h"
+#include "UpdaterWorkspace.h"
 
 #include <boost/math/distributions/chi_squared.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -63,12 +64,16 @@ namespace ov_msckf {
          *
          * @param options Updater options (include measurement noise value)
          * @param feat_init_options Feature initializer options
+         * @param state_options State options (number of cameras and feature representation)
          */
-        UpdaterMSCKF(UpdaterOptions &options, FeatureInitializerOptions &feat_init_options) : _options(options) {
+        UpdaterMSCKF(UpdaterOptions &options, FeatureInitializerOptions &feat_init_options, StateOptions &state_options) : _options(options) {
 
             // Save our raw pixel noise squared
             _options.sigma_pix_sq = std::pow(_options.sigma_pix,2);
 
+            // Select the feature Jacobian function specialized for our configuration
+            get_feature_jacobian_full = UpdaterHelper::get_feature_jacobian_full_function(state_options.num_cameras, state_options.feat_rep_msckf);
+
             // Save our feature initializer
             initializer_feat = new FeatureInitializer(feat_init_options);
 
@@ -104,6 +109,12 @@ namespace ov_msckf {
         /// Chi squared 95th percentile table (lookup would be size of residual)
         std::map<int, double> chi_squared_table;
 
+        /// Reusable buffers for the temporaries of each update
+        UpdaterWorkspace workspace;
+
+        /// Function to compute the Jacobians of our features with
+        UpdaterHelper::FeatureJacobianFunction get_feature_jacobian_full;
+
 
     };
 
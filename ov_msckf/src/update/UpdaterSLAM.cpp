@@ -37,11 +37,9 @@ void UpdaterSLAM::delayed_init(State *state, std::vector<Feature*>& feature_vec)
     boost::posix_time::ptime rT0, rT1, rT2, rT3, rT4, rT5, rT6, rT7;
     rT0 =  boost::posix_time::microsec_clock::local_time();
 
-    // 0. Get all timestamps our clones are at (and thus valid measurement times)
-    std::vector<double> clonetimes;
-    for(const auto& clone_imu : state->_clones_IMU) {
-        clonetimes.emplace_back(clone_imu.first);
-    }
+    // 0. Get all timestamps our clones are at (and thus valid measurement times), and their camera poses
+    workspace.reset_clones(state);
+    const std::vector<double> &clonetimes = workspace.clonetimes;
 
     // 1. Clean all feature measurements and make sure they all have valid clone times
     auto it0 = feature_vec.begin();
@@ -67,27 +65,8 @@ void UpdaterSLAM::delayed_init(State *state, std::vector<Feature*>& feature_vec)
     }
     rT1 =  boost::posix_time::microsec_clock::local_time();
 
-    // 2. Create vector of cloned *CAMERA* poses at each of our clone timesteps
-    std::unordered_map<size_t, std::unordered_map<double, FeatureInitializer::ClonePose>> clones_cam;
-    for(const auto &clone_calib : state->_calib_IMUtoCAM) {
-
-        // For this camera, create the vector of camera poses
-        std::unordered_map<double, FeatureInitializer::ClonePose> clones_cami;
-        for(const auto &clone_imu : state->_clones_IMU) {
-
-            // Get current camera pose
-            Eigen::Matrix<double,3,3> R_GtoCi = clone_calib.second->Rot()*clone_imu.second->Rot();
-            Eigen::Matrix<double,3,1> p_CioinG = clone_imu.second->pos() - R_GtoCi.transpose()*clone_calib.second->pos();
-
-            // Append to our map
-            clones_cami.insert({clone_imu.first,FeatureInitializer::ClonePose(R_GtoCi,p_CioinG)});
-
-        }
-
-        // Append to our map
-        clones_cam.insert({clone_calib.first,clones_cami});
-
-    }
+    // 2. Our cloned *CAMERA* poses at each of our clone timesteps
+    auto &clones_cam = workspace.clones_cam;
 
     // 3. Try to triangulate all MSCKF or new SLAM features that have measurements
     auto it1 = feature_vec.begin();
@@ -119,7 +98,7 @@ void UpdaterSLAM::delayed_init(State *state, std::vector<Feature*>& feature_vec)
 
 
         // Convert our feature into our current format
-        UpdaterHelper::UpdaterHelperFeature feat;
+        UpdaterHelper::UpdaterHelperFeature &feat = workspace.feat;
         feat.featid = (*it2)->featid;
         feat.uvs = (*it2)->uvs;
         feat.uvs_norm = (*it2)->uvs_norm;
@@ -144,13 +123,14 @@ void UpdaterSLAM::delayed_init(State *state, std::vector<Feature*>& feature_vec)
         }
 
         // Our return values (feature jacobian, state jacobian, residual, and order of state jacobian)
-        Eigen::MatrixXd H_f;
-        Eigen::MatrixXd H_x;
-        Eigen::VectorXd res;
-        std::vector<Type*> Hx_order;
+        Eigen::MatrixXd &H_f = workspace.H_f;
+        Eigen::MatrixXd &H_x = workspace.H_x;
+        Eigen::VectorXd &res = workspace.res;
+        std::vector<Type*> &Hx_order = workspace.Hx_order;
 
         // Get the Jacobian for this feature
-        UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
+        auto get_feature_jacobian_full = ((int)feat.featid < state->_options.max_aruco_features)? get_feature_jacobian_full_aruco : get_feature_jacobian_full_slam;
+        get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
 
         // If we are doing the single feature representation, then we need to remove the bearing portion
         // To do so, we project the bearing portion onto the state and depth Jacobians and the residual.
@@ -158,8 +138,9 @@ void UpdaterSLAM::delayed_init(State *state, std::vector<Feature*>& feature_vec)
         if(feat_rep==LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) {
 
             // Append the Jacobian in respect to the depth of the feature
-            Eigen::MatrixXd H_xf = H_x;
-            H_xf.conservativeResize(H_x.rows(), H_x.cols()+1);
+            Eigen::MatrixXd &H_xf = workspace.H_xf;
+            H_xf.resize(H_x.rows(), H_x.cols()+1);
+            H_xf.block(0, 0, H_x.rows(), H_x.cols()) = H_x;
             H_xf.block(0, H_x.cols(), H_x.rows(), 1) = H_f.block(0,H_f.cols()-1,H_f.rows(),1);
             H_f.conservativeResize(H_f.rows(), H_f.cols()-1);
 
@@ -191,7 +172,9 @@ void UpdaterSLAM::delayed_init(State *state, std::vector<Feature*>& feature_vec)
 
         // Measurement noise matrix
         double sigma_pix_sq = ((int)feat.featid < state->_options.max_aruco_features)? _options_aruco.sigma_pix_sq : _options_slam.sigma_pix_sq;
-        Eigen::MatrixXd R = sigma_pix_sq*Eigen::MatrixXd::Identity(res.rows(), res.rows());
+        Eigen::MatrixXd &R = workspace.R;
+        R.setIdentity(res.rows(), res.rows());
+        R *= sigma_pix_sq;
 
         // Try to initialize, delete new pointer if we failed
         double chi2_multipler = ((int)feat.featid < state->_options.max_aruco_features)? _options_aruco.chi2_multipler : _options_slam.chi2_multipler;
@@ -231,11 +214,9 @@ void UpdaterSLAM::update(State *state, std::vector<Feature*>& feature_vec) {
     boost::posix_time::ptime rT0, rT1, rT2, rT3, rT4, rT5, rT6, rT7;
     rT0 =  boost::posix_time::microsec_clock::local_time();
 
-    // 0. Get all timestamps our clones are at (and thus valid measurement times)
-    std::vector<double> clonetimes;
-    for(const auto& clone_imu : state->_clones_IMU) {
-        clonetimes.emplace_back(clone_imu.first);
-    }
+    // 0. Get all timestamps our clones are at (and thus valid measurement times), and their camera poses
+    workspace.reset_clones(state);
+    const std::vector<double> &clonetimes = workspace.clonetimes;
 
 
     // 1. Clean all feature measurements and make sure they all have valid clone times
@@ -282,13 +263,10 @@ void UpdaterSLAM::update(State *state, std::vector<Feature*>& feature_vec) {
     size_t max_hx_size = state->max_covariance_size();
 
     // Large Jacobian, residual, and measurement noise of *all* features for this update
-    Eigen::VectorXd res_big = Eigen::VectorXd::Zero(max_meas_size);
-    Eigen::MatrixXd Hx_big = Eigen::MatrixXd::Zero(max_meas_size, max_hx_size);
-    Eigen::MatrixXd R_big = Eigen::MatrixXd::Identity(max_meas_size,max_meas_size);
-    std::unordered_map<Type*,size_t> Hx_mapping;
-    std::vector<Type*> Hx_order_big;
-    size_t ct_jacob = 0;
-    size_t ct_meas = 0;
+    workspace.reset_system(state, max_meas_size, max_hx_size);
+
+    // Marginal covariance of the clones, calibration, and SLAM features (used for our chi2 check)
+    workspace.cache_marginal_covariance(state, true);
 
     // 4. Compute linear system for each feature, nullspace project, and reject
     auto it2 = feature_vec.begin();
@@ -302,7 +280,7 @@ void UpdaterSLAM::update(State *state, std::vector<Feature*>& feature_vec) {
         Landmark* landmark = state->_features_SLAM.at((*it2)->featid);
 
         // Convert the state landmark into our current format
-        UpdaterHelper::UpdaterHelperFeature feat;
+        UpdaterHelper::UpdaterHelperFeature &feat = workspace.feat;
         feat.featid = (*it2)->featid;
         feat.uvs = (*it2)->uvs;
         feat.uvs_norm = (*it2)->uvs_norm;
@@ -326,20 +304,22 @@ void UpdaterSLAM::update(State *state, std::vector<Feature*>& feature_vec) {
         }
 
         // Our return values (feature jacobian, state jacobian, residual, and order of state jacobian)
-        Eigen::MatrixXd H_f;
-        Eigen::MatrixXd H_x;
-        Eigen::VectorXd res;
-        std::vector<Type*> Hx_order;
+        Eigen::MatrixXd &H_f = workspace.H_f;
+        Eigen::MatrixXd &H_x = workspace.H_x;
+        Eigen::VectorXd &res = workspace.res;
+        std::vector<Type*> &Hx_order = workspace.Hx_order;
 
         // Get the Jacobian for this feature
-        UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
+        auto get_feature_jacobian_full = ((int)feat.featid < state->_options.max_aruco_features)? get_feature_jacobian_full_aruco : get_feature_jacobian_full_slam;
+        get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
 
         // Place Jacobians in one big Jacobian, since the landmark is already in our state vector
-        Eigen::MatrixXd H_xf = H_x;
+        Eigen::MatrixXd &H_xf = workspace.H_xf;
         if(landmark->_feat_representation==LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) {
 
             // Append the Jacobian in respect to the depth of the feature
-            H_xf.conservativeResize(H_x.rows(), H_x.cols()+1);
+            H_xf.resize(H_x.rows(), H_x.cols()+1);
+            H_xf.block(0, 0, H_x.rows(), H_x.cols()) = H_x;
             H_xf.block(0, H_x.cols(), H_x.rows(), 1) = H_f.block(0,H_f.cols()-1,H_f.rows(),1);
             H_f.conservativeResize(H_f.rows(), H_f.cols()-1);
 
@@ -351,21 +331,20 @@ void UpdaterSLAM::update(State *state, std::vector<Feature*>& feature_vec) {
         } else {
 
             // Else we have the full feature in our state, so just append it
-            H_xf.conservativeResize(H_x.rows(), H_x.cols()+H_f.cols());
+            H_xf.resize(H_x.rows(), H_x.cols()+H_f.cols());
+            H_xf.block(0, 0, H_x.rows(), H_x.cols()) = H_x;
             H_xf.block(0, H_x.cols(), H_x.rows(), H_f.cols()) = H_f;
 
         }
 
         // Append to our Jacobian order vector
-        std::vector<Type*> Hxf_order = Hx_order;
+        std::vector<Type*> &Hxf_order = workspace.Hxf_order;
+        Hxf_order = Hx_order;
         Hxf_order.push_back(landmark);
 
         /// Chi2 distance check
-        Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, Hxf_order);
-        Eigen::MatrixXd S = H_xf*P_marg*H_xf.transpose();
         double sigma_pix_sq = ((int)feat.featid < state->_options.max_aruco_features)? _options_aruco.sigma_pix_sq : _options_slam.sigma_pix_sq;
-        S.diagonal() += sigma_pix_sq*Eigen::VectorXd::Ones(S.rows());
-        double chi2 = res.dot(S.llt().solve(res));
+        double chi2 = workspace.chi2_distance(state, Hxf_order, H_xf, res, sigma_pix_sq);
 
         // Get our threshold (we precompute up to 500 but handle the case that it is more)
         double chi2_check;
@@ -391,29 +370,8 @@ void UpdaterSLAM::update(State *state, std::vector<Feature*>& feature_vec) {
         if((int)feat.featid < state->_options.max_aruco_features)
             printf("[SLAM-UP]: accepted aruco tag %d for chi2 thresh (%.3f < %.3f)\n",(int)feat.featid,chi2,chi2_multipler*chi2_check);
 
-        // We are good!!! Append to our large H vector
-        size_t ct_hx = 0;
-        for(const auto &var : Hxf_order) {
-
-            // Ensure that this variable is in our Jacobian
-            if(Hx_mapping.find(var)==Hx_mapping.end()) {
-                Hx_mapping.insert({var,ct_jacob});
-                Hx_order_big.push_back(var);
-                ct_jacob += var->size();
-            }
-
-            // Append to our large Jacobian
-            Hx_big.block(ct_meas,Hx_mapping[var],H_xf.rows(),var->size()) = H_xf.block(0,ct_hx,H_xf.rows(),var->size());
-            ct_hx += var->size();
-
-        }
-
-        // Our isotropic measurement noise
-        R_big.block(ct_meas,ct_meas,res.rows(),res.rows()) *= sigma_pix_sq;
-
-        // Append our residual and move forward
-        res_big.block(ct_meas,0,res.rows(),1) = res;
-        ct_meas += res.rows();
+        // We are good!!! Append to our large H vector (with our isotropic measurement noise)
+        workspace.append(Hxf_order, H_xf, res, sigma_pix_sq);
         it2++;
 
     }
@@ -425,24 +383,28 @@ void UpdaterSLAM::update(State *state, std::vector<Feature*>& feature_vec) {
         feature_vec[f]->to_delete = true;
     }
 
-    // Return if we don't have anything and resize our matrices
+    // Return if we don't have anything
+    size_t ct_meas = workspace.ct_meas;
+    size_t ct_jacob = workspace.ct_jacob;
     if(ct_meas < 1) {
         return;
     }
     assert(ct_meas<=max_meas_size);
     assert(ct_jacob<=max_hx_size);
-    res_big.conservativeResize(ct_meas,1);
-    Hx_big.conservativeResize(ct_meas,ct_jacob);
-    R_big.conservativeResize(ct_meas,ct_meas);
 
-    // 5. With all good SLAM features update the state
-    StateHelper::EKFUpdate(state, Hx_order_big, Hx_big, res_big, R_big);
+    // Our noise is diagonal (but differs between aruco and normal SLAM features), so make it at the size we actually used
+    auto R_big = workspace.get_noise(ct_meas);
+    R_big.diagonal() = workspace.R_diag_big.head(ct_meas);
+
+    // 5. With all good SLAM features update the state (only the part of our stacked system that we used)
+    StateHelper::EKFUpdate(state, workspace.Hx_order_big, workspace.Hx_big.topLeftCorner(ct_meas,ct_jacob),
+                           workspace.res_big.head(ct_meas), R_big);
     rT3 =  boost::posix_time::microsec_clock::local_time();
 
     // Debug print timing information
     //printf("[SLAM-UP]: %.4f seconds to clean\n",(rT1-rT0).total_microseconds() * 1e-6);
     //printf("[SLAM-UP]: %.4f seconds creating linear system\n",(rT2-rT1).total_microseconds() * 1e-6);
-    //printf("[SLAM-UP]: %.4f seconds to update (%d feats of %d size)\n",(rT3-rT2).total_microseconds() * 1e-6, (int)feature_vec.size(), (int)Hx_big.rows());
+    //printf("[SLAM-UP]: %.4f seconds to update (%d feats of %d size)\n",(rT3-rT2).total_microseconds() * 1e-6, (int)feature_vec.size(), (int)ct_meas);
     //printf("[SLAM-UP]: %.4f seconds total\n",(rT3-rT1).total_microseconds() * 1e-6);
 
 }
@@ -462,6 +424,9 @@ void UpdaterSLAM::change_anchors(State* state) {
     // NOTE: for now we have anchor the feature in the same camera as it is before
     // NOTE: this also does not change the representation of the feature at all right now
     double marg_timestep = state->margtimestep();
+    std::vector<Landmark*> landmarks_changed;
+    std::vector<Eigen::MatrixXd> Phi_changed;
+    std::vector<std::vector<Type*>> order_changed;
     for (auto &f : state->_features_SLAM) {
         // Skip any features that are in the global frame
         if(f.second->_feat_representation == LandmarkRepresentation::Representation::GLOBAL_3D
@@ -470,16 +435,68 @@ void UpdaterSLAM::change_anchors(State* state) {
         // Else lets see if it is anchored in the clone that will be marginalized
         assert(marg_timestep <= f.second->_anchor_clone_timestamp);
         if (f.second->_anchor_clone_timestamp == marg_timestep) {
-            perform_anchor_change(state, f.second, state->_timestamp, f.second->_anchor_cam_id);
+            Eigen::MatrixXd Phi;
+            std::vector<Type*> phi_order_OLD;
+            perform_anchor_change(state, f.second, state->_timestamp, f.second->_anchor_cam_id, Phi, phi_order_OLD);
+            landmarks_changed.push_back(f.second);
+            Phi_changed.push_back(Phi);
+            order_changed.push_back(phi_order_OLD);
+        }
+    }
+
+    // Return if no features changed anchors
+    if(landmarks_changed.empty())
+        return;
+
+    // Each anchor change is only a function of its own landmark and the clones/calibration
+    // Thus we can stack all of them and do a single propagation of the covariance
+    // The landmarks are sorted by their location in the covariance so each Phi row block matches the new order
+    std::vector<size_t> sorted(landmarks_changed.size());
+    for(size_t i=0; i<sorted.size(); i++)
+        sorted.at(i) = i;
+    std::sort(sorted.begin(), sorted.end(), [&landmarks_changed](size_t a, size_t b) {
+        return landmarks_changed.at(a)->id() < landmarks_changed.at(b)->id();
+    });
+
+    // Get the union of all the old variables, and the location of each in our stacked Phi
+    std::vector<Type*> phi_order_NEW, phi_order_OLD;
+    std::map<Type*, int> Phi_id_map;
+    int rows = 0, cols = 0;
+    for(size_t i : sorted) {
+        phi_order_NEW.push_back(landmarks_changed.at(i));
+        rows += landmarks_changed.at(i)->size();
+        for(Type* var : order_changed.at(i)) {
+            if(Phi_id_map.find(var) == Phi_id_map.end()) {
+                Phi_id_map.insert({var,cols});
+                phi_order_OLD.push_back(var);
+                cols += var->size();
+            }
+        }
+    }
+
+    // Stack the sparse Phi of each landmark
+    Eigen::MatrixXd Phi = Eigen::MatrixXd::Zero(rows, cols);
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Zero(rows, rows);
+    int row_id = 0;
+    for(size_t i : sorted) {
+        int local_id = 0;
+        for(Type* var : order_changed.at(i)) {
+            Phi.block(row_id,Phi_id_map.at(var),Phi_changed.at(i).rows(),var->size()) = Phi_changed.at(i).block(0,local_id,Phi_changed.at(i).rows(),var->size());
+            local_id += var->size();
         }
+        row_id += (int)Phi_changed.at(i).rows();
     }
 
+    // Perform covariance propagation
+    StateHelper::EKFPropagation(state, phi_order_NEW, phi_order_OLD, Phi, Q);
+
 }
 
 
 
 
-void UpdaterSLAM::perform_anchor_change(State* state, Landmark* landmark, double new_anchor_timestamp, size_t new_cam_id) {
+void UpdaterSLAM::perform_anchor_change(State* state, Landmark* landmark, double new_anchor_timestamp, size_t new_cam_id,
+                                        Eigen::MatrixXd &Phi, std::vector<Type*> &phi_order_OLD) {
 
     // Assert that this is an anchored representation
     assert(LandmarkRepresentation::is_relative_representation(landmark->_feat_representation));
@@ -552,12 +569,8 @@ void UpdaterSLAM::perform_anchor_change(State* state, Landmark* landmark, double
     //==========================================================================
     //==========================================================================
 
-    // New phi order is just the landmark
-    std::vector<Type*> phi_order_NEW;
-    phi_order_NEW.push_back(landmark);
-
     // Loop through all our orders and append them
-    std::vector<Type*> phi_order_OLD;
+    phi_order_OLD.clear();
     int current_it = 0;
     std::map<Type*, int> Phi_id_map;
     for (const auto &var: x_order_old) {
@@ -580,8 +593,7 @@ void UpdaterSLAM::perform_anchor_change(State* state, Landmark* landmark, double
 
     // Anchor change Jacobian
     int phisize = (new_feat.feat_representation!=LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) ? 3 : 1;
-    Eigen::MatrixXd Phi = Eigen::MatrixXd::Zero(phisize, current_it);
-    Eigen::MatrixXd Q = Eigen::MatrixXd::Zero(phisize, phisize);
+    Phi = Eigen::MatrixXd::Zero(phisize, current_it);
 
     // Inverse of our new representation
     // pf_new_error = Hfnew^{-1}*(Hfold*pf_olderror+Hxold*x_olderror-Hxnew*x_newerror)
@@ -605,10 +617,8 @@ void UpdaterSLAM::perform_anchor_change(State* state, Landmark* landmark, double
         Phi.block(0,Phi_id_map.at(x_order_new[i]),phisize,x_order_new[i]->size()).noalias() -= H_f_new_inv*H_x_new[i];
     }
 
-    // Perform covariance propagation
-    StateHelper::EKFPropagation(state, phi_order_NEW, phi_order_OLD, Phi, Q);
-
     // Set state from new feature
+    // Note the covariance is not a function of the means, thus the caller can propagate it after
     landmark->_featid = new_feat.featid;
     landmark->_feat_representation = new_feat.feat_representation;
     landmark->_anchor_cam_id = new_feat.anchor_cam_id;
@@ -35,6 +35,7 @@
 
 #include "UpdaterHelper.h"
 #include "UpdaterOptions.h"
+#include "UpdaterWorkspace.h"
 
 #include <boost/math/distributions/chi_squared.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -64,14 +65,24 @@ namespace ov_msckf {
          * @param options_slam Updater options (include measurement noise value) for SLAM features
          * @param options_aruco Updater options (include measurement noise value) for ARUCO features
          * @param feat_init_options Feature initializer options
+         * @param state_options State options (number of cameras and feature representations)
          */
-        UpdaterSLAM(UpdaterOptions &options_slam, UpdaterOptions &options_aruco, FeatureInitializerOptions &feat_init_options)
+        UpdaterSLAM(UpdaterOptions &options_slam, UpdaterOptions &options_aruco, FeatureInitializerOptions &feat_init_options, StateOptions &state_options)
                     : _options_slam(options_slam), _options_aruco(options_aruco) {
 
             // Save our raw pixel noise squared
             _options_slam.sigma_pix_sq = std::pow(_options_slam.sigma_pix,2);
             _options_aruco.sigma_pix_sq = std::pow(_options_aruco.sigma_pix,2);
 
+            // Select the feature Jacobian functions specialized for our configuration
+            // NOTE: the single inverse depth features are treated as msckf inverse depth features for their Jacobians
+            auto jacobian_representation = [](LandmarkRepresentation::Representation feat_rep) {
+                return (feat_rep==LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE)?
+                        LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH : feat_rep;
+            };
+            get_feature_jacobian_full_slam = UpdaterHelper::get_feature_jacobian_full_function(state_options.num_cameras, jacobian_representation(state_options.feat_rep_slam));
+            get_feature_jacobian_full_aruco = UpdaterHelper::get_feature_jacobian_full_function(state_options.num_cameras, jacobian_representation(state_options.feat_rep_aruco));
+
             // Save our feature initializer
             initializer_feat = new FeatureInitializer(feat_init_options);
 
@@ -118,12 +129,20 @@ namespace ov_msckf {
 
         /**
          * @brief Shifts landmark anchor to new clone
+         *
+         * This will change the mean of the landmark, and return the linear transform of its error state.
+         * The covariance is not changed, the caller should propagate it with StateHelper::EKFPropagation().
+         * This allows for all anchor changes at a given timestep to be done with a single propagation.
+         *
          * @param state State of filter
          * @param landmark landmark whose anchor is being shifter
          * @param new_anchor_timestamp Clone timestamp we want to move to
          * @param new_cam_id Which camera frame we want to move to
+         * @param Phi Jacobian of the new landmark error state in respect to the old variables
+         * @param phi_order_OLD Variable ordering used in the Phi Jacobian (includes the landmark itself)
          */
-        void perform_anchor_change(State* state, Landmark* landmark, double new_anchor_timestamp, size_t new_cam_id);
+        void perform_anchor_change(State* state, Landmark* landmark, double new_anchor_timestamp, size_t new_cam_id,
+                                   Eigen::MatrixXd &Phi, std::vector<Type*> &phi_order_OLD);
 
 
         /// Options used during update for slam features
@@ -138,6 +157,15 @@ namespace ov_msckf {
         /// Chi squared 95th percentile table (lookup would be size of residual)
         std::map<int, double> chi_squared_table;
 
+        /// Reusable buffers for the temporaries of each update
+        UpdaterWorkspace workspace;
+
+        /// Function to compute the Jacobians of our SLAM features with
+        UpdaterHelper::FeatureJacobianFunction get_feature_jacobian_full_slam;
+
+        /// Function to compute the Jacobians of our ARUCO features with
+        UpdaterHelper::FeatureJacobianFunction get_feature_jacobian_full_aruco;
+
 
 
     };
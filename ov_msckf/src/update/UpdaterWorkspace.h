@@ -0,0 +1,301 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2019 Patrick Geneva
+ * Copyright (C) 2019 Guoquan Huang
+ * Copyright (C) 2019 OpenVINS Contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_UPDATER_WORKSPACE_H
+#define OV_MSCKF_UPDATER_WORKSPACE_H
+
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <Eigen/Eigen>
+
+#include "state/State.h"
+#include "state/StateHelper.h"
+#include "feat/FeatureInitializer.h"
+#include "UpdaterHelper.h"
+
+
+namespace ov_msckf {
+
+
+    /**
+     * @brief Reusable buffers for the temporaries of a single update
+     *
+     * Each updater owns one of these and resets it at the start of every update, instead of constructing and
+     * discarding all of its matrices on every call. The large stacked system only ever grows, and we work on its top left
+     * corner, so after the first few frames no memory is allocated for it. The per-feature buffers are reused between features,
+     * and Eigen will only reallocate them when a feature's system has a different size than the last one.
+     * This keeps malloc out of the update, which otherwise shows up as jitter in the filter time.
+     */
+    class UpdaterWorkspace {
+
+    public:
+
+        /**
+         * @brief Will update the camera poses of all clones for this update
+         *
+         * Poses are overwritten in place, and only clones which have been marginalized are removed.
+         * @param state State of the filter
+         */
+        void reset_clones(State *state) {
+
+            // The state will have changed since our last update
+            P_union_order.clear();
+
+            // All timestamps our clones are at (and thus valid measurement times)
+            clonetimes.clear();
+            for(const auto &clone_imu : state->_clones_IMU) {
+                clonetimes.push_back(clone_imu.first);
+            }
+
+            // Create the cloned *CAMERA* poses at each of our clone timesteps
+            for(const auto &clone_calib : state->_calib_IMUtoCAM) {
+                std::unordered_map<double, FeatureInitializer::ClonePose> &clones_cami = clones_cam[clone_calib.first];
+                for(auto it = clones_cami.begin(); it != clones_cami.end();) {
+                    if(state->_clones_IMU.find(it->first) == state->_clones_IMU.end()) it = clones_cami.erase(it);
+                    else it++;
+                }
+                for(const auto &clone_imu : state->_clones_IMU) {
+                    FeatureInitializer::ClonePose &pose = clones_cami[clone_imu.first];
+                    pose._Rot.noalias() = clone_calib.second->Rot()*clone_imu.second->Rot();
+                    pose._pos.noalias() = clone_imu.second->pos() - pose._Rot.transpose()*clone_calib.second->pos();
+                }
+            }
+
+        }
+
+        /**
+         * @brief Will reset the stacked system so it can hold the given max size
+         * @param state State of the filter
+         * @param max_meas_size Max number of measurement rows we will append
+         * @param max_hx_size Max size of the state Jacobian
+         */
+        void reset_system(State *state, size_t max_meas_size, size_t max_hx_size) {
+
+            // Grow our buffers if needed
+            if((size_t)Hx_big.rows() < max_meas_size || (size_t)Hx_big.cols() < max_hx_size) {
+                Hx_big.resize(std::max((size_t)Hx_big.rows(),max_meas_size), std::max((size_t)Hx_big.cols(),max_hx_size));
+            }
+            if((size_t)res_big.rows() < max_meas_size) {
+                res_big.resize(max_meas_size);
+                R_diag_big.resize(max_meas_size);
+            }
+
+            // Zero the part we will use (the dense noise is only made once we know the final size, see get_noise())
+            Hx_big.topLeftCorner(max_meas_size, max_hx_size).setZero();
+            res_big.head(max_meas_size).setZero();
+
+            // Our variables and where they are in our stacked Jacobian (looked up by their covariance location)
+            Hx_order_big.clear();
+            if(Hx_cols.size() < (size_t)state->max_covariance_size()) {
+                Hx_cols.resize((size_t)state->max_covariance_size());
+            }
+            std::fill(Hx_cols.begin(), Hx_cols.end(), -1);
+            ct_jacob = 0;
+            ct_meas = 0;
+
+        }
+
+        /**
+         * @brief Appends the system of a single feature to our stacked system
+         * @param H_order Variable ordering of the feature Jacobian
+         * @param H Jacobian of the feature measurements in respect to the state
+         * @param res Residual of the feature measurements
+         * @param sigma_pix_sq Isotropic noise of each measurement
+         */
+        void append(const std::vector<Type*> &H_order, const Eigen::MatrixXd &H, const Eigen::VectorXd &res, double sigma_pix_sq) {
+
+            // Append to our large Jacobian, adding variables that are not yet in it
+            int ct_hx = 0;
+            for(const auto &var : H_order) {
+                if(Hx_cols.at(var->id()) == -1) {
+                    Hx_cols.at(var->id()) = (int)ct_jacob;
+                    Hx_order_big.push_back(var);
+                    ct_jacob += var->size();
+                }
+                Hx_big.block(ct_meas,Hx_cols.at(var->id()),H.rows(),var->size()) = H.block(0,ct_hx,H.rows(),var->size());
+                ct_hx += var->size();
+            }
+
+            // Our isotropic measurement noise and residual
+            R_diag_big.segment(ct_meas,res.rows()).setConstant(sigma_pix_sq);
+            res_big.segment(ct_meas,res.rows()) = res;
+            ct_meas += res.rows();
+
+        }
+
+        /**
+         * @brief Gets a zeroed dense noise matrix for the first rows of our stacked system
+         *
+         * This should be called right before the update, after any measurement compression, so that we only allocate and
+         * zero the rows x rows block that is actually used (instead of the worst case size of the uncompressed system).
+         * The caller is expected to set its diagonal (e.g. from R_diag_big if the rows have not been compressed).
+         * @param rows Number of measurement rows of the final system
+         * @return Top left rows x rows block of our noise buffer
+         */
+        Eigen::Block<Eigen::MatrixXd> get_noise(size_t rows) {
+            if((size_t)R_big.rows() < rows) {
+                R_big.resize(rows, rows);
+            }
+            Eigen::Block<Eigen::MatrixXd> R = R_big.topLeftCorner(rows, rows);
+            R.setZero();
+            return R;
+        }
+
+        /**
+         * @brief Will cache the marginal covariance of all variables that a feature's Jacobian can be in respect to
+         *
+         * This is all clones and the camera calibration being estimated (and optionally the SLAM features).
+         * Most features share the same clones and calibration, so instead of copying the same covariance blocks for every feature,
+         * we copy the union once and then chi2_distance() works directly on blocks of it.
+         * This is only valid until the state is changed, and is cleared on the next reset_clones().
+         *
+         * @param state State of the filter
+         * @param with_slam If we should also include all SLAM features
+         */
+        void cache_marginal_covariance(State *state, bool with_slam) {
+
+            // All variables that a feature can be a function of
+            P_union_order.clear();
+            for(const auto &clone_imu : state->_clones_IMU) {
+                P_union_order.push_back(clone_imu.second);
+            }
+            for(int i=0; i<state->_options.num_cameras; i++) {
+                if(state->_options.do_calib_camera_pose) P_union_order.push_back(state->_calib_IMUtoCAM.at(i));
+                if(state->_options.do_calib_camera_intrinsics) P_union_order.push_back(state->_cam_intrinsics.at(i));
+            }
+            if(with_slam) {
+                for(const auto &landmark : state->_features_SLAM) {
+                    P_union_order.push_back(landmark.second);
+                }
+            }
+
+            // Their marginal covariance and where each is in it (indexed by their location in the covariance)
+            StateHelper::get_marginal_covariance(state, P_union_order, P_union);
+            if(P_union_ids.size() < (size_t)state->max_covariance_size()) {
+                P_union_ids.resize((size_t)state->max_covariance_size());
+            }
+            std::fill(P_union_ids.begin(), P_union_ids.end(), -1);
+            int ct = 0;
+            for(const auto &var : P_union_order) {
+                P_union_ids.at(var->id()) = ct;
+                ct += var->size();
+            }
+
+        }
+
+        /**
+         * @brief Will compute the chi2 distance of a feature's system (using our per-feature buffers)
+         *
+         * If all variables are in our cached marginal (see cache_marginal_covariance()), then we compute S = H*P*H^T one variable
+         * block at a time directly from it. Otherwise we fall back to getting the marginal covariance from the state.
+         *
+         * @param state State of the filter
+         * @param H_order Variable ordering of the feature Jacobian
+         * @param H Jacobian of the feature measurements in respect to the state
+         * @param res Residual of the feature measurements
+         * @param sigma_pix_sq Isotropic noise of each measurement
+         * @return Mahalanobis distance of the residual
+         */
+        double chi2_distance(State *state, const std::vector<Type*> &H_order, const Eigen::MatrixXd &H, const Eigen::VectorXd &res, double sigma_pix_sq) {
+
+            // Check if our cached marginal has all variables
+            bool is_cached = !P_union_order.empty();
+            for(size_t i=0; i<H_order.size() && is_cached; i++) {
+                is_cached = (P_union_ids.at(H_order.at(i)->id()) != -1);
+            }
+
+            // Residual covariance S = H*P*H^T + R
+            if(is_cached) {
+                S.setZero(H.rows(), H.rows());
+                int col_j = 0;
+                for(const auto &var_j : H_order) {
+                    HP.setZero(H.rows(), var_j->size());
+                    int col_i = 0;
+                    for(const auto &var_i : H_order) {
+                        HP.noalias() += H.middleCols(col_i,var_i->size())*P_union.block(P_union_ids.at(var_i->id()),P_union_ids.at(var_j->id()),var_i->size(),var_j->size());
+                        col_i += var_i->size();
+                    }
+                    S.noalias() += HP*H.middleCols(col_j,var_j->size()).transpose();
+                    col_j += var_j->size();
+                }
+            } else {
+                StateHelper::get_marginal_covariance(state, H_order, P_marg);
+                HP.noalias() = H*P_marg;
+                S.noalias() = HP*H.transpose();
+            }
+            S.diagonal().array() += sigma_pix_sq;
+            llt.compute(S);
+            S_inv_res = llt.solve(res);
+            return res.dot(S_inv_res);
+        }
+
+        /// Timestamps of our clones
+        std::vector<double> clonetimes;
+
+        /// Camera pose of each clone for each camera
+        std::unordered_map<size_t, std::unordered_map<double, FeatureInitializer::ClonePose>> clones_cam;
+
+        /// Stacked Jacobian and residual of all features (only the top left ct_meas x ct_jacob is valid)
+        Eigen::MatrixXd Hx_big;
+        Eigen::VectorXd res_big;
+
+        /// Noise of each row of our stacked system (only the first ct_meas are valid)
+        Eigen::VectorXd R_diag_big;
+
+        /// Dense noise buffer, only sized and zeroed to the final system size in get_noise()
+        Eigen::MatrixXd R_big;
+
+        /// Variables in our stacked Jacobian
+        std::vector<Type*> Hx_order_big;
+
+        /// Column of each variable in our stacked Jacobian, indexed by its location in the covariance (-1 if not added)
+        std::vector<int> Hx_cols;
+
+        /// Current size of our stacked system
+        size_t ct_jacob = 0, ct_meas = 0;
+
+        /// Per-feature buffers
+        UpdaterHelper::UpdaterHelperFeature feat;
+        Eigen::MatrixXd H_f, H_x, H_xf, R;
+        Eigen::VectorXd res;
+        std::vector<Type*> Hx_order, Hxf_order;
+
+        /// Cached marginal covariance of all variables features can be a function of
+        Eigen::MatrixXd P_union;
+
+        /// Variables in our cached marginal (empty if not cached)
+        std::vector<Type*> P_union_order;
+
+        /// Location of each variable in our cached marginal, indexed by its location in the covariance (-1 if not in it)
+        std::vector<int> P_union_ids;
+
+        /// Per-feature chi2 buffers
+        Eigen::MatrixXd P_marg, HP, S;
+        Eigen::VectorXd S_inv_res;
+        Eigen::LLT<Eigen::MatrixXd> llt;
+
+    };
+
+
+}
+
+#endif //OV_MSCKF_UPDATER_WORKSPACE_H
@@ -52,9 +52,15 @@ namespace ov_msckf {
         app1.add_option("--use_fej", params.state_options.do_fej, "");
         app1.add_option("--use_imuavg", params.state_options.imu_avg, "");
         app1.add_option("--use_rk4int", params.state_options.use_rk4_integration, "");
+        app1.add_option("--use_cpiprop", params.state_options.use_cpi_propagation, "");
         app1.add_option("--calib_cam_extrinsics", params.state_options.do_calib_camera_pose, "");
         app1.add_option("--calib_cam_intrinsics", params.state_options.do_calib_camera_intrinsics, "");
         app1.add_option("--calib_cam_timeoffset", params.state_options.do_calib_camera_timeoffset, "");
+        app1.add_option("--schmidt_calibration", params.state_options.do_schmidt_calibration, "");
+        app1.add_option("--schmidt_slam", params.state_options.do_schmidt_slam, "");
+        app1.add_option("--calib_freeze", params.state_options.do_calib_freeze, "");
+        app1.add_option("--calib_freeze_window", params.state_options.calib_freeze_window, "");
+        app1.add_option("--calib_freeze_rel_change", params.state_options.calib_freeze_rel_change, "");
         app1.add_option("--max_clones", params.state_options.max_clone_size, "");
         app1.add_option("--max_slam", params.state_options.max_slam_features, "");
         app1.add_option("--max_slam_in_update", params.state_options.max_slam_in_update, "");
@@ -79,6 +85,14 @@ namespace ov_msckf {
         app1.add_option("--record_timing_information", params.record_timing_information, "");
         app1.add_option("--record_timing_filepath", params.record_timing_filepath, "");
 
+        // Snapshots of the estimator for warm restarts
+        app1.add_option("--snapshot_path", params.snapshot_path, "");
+        app1.add_option("--snapshot_interval", params.snapshot_interval, "");
+
+        // History of poses for timestamp queries
+        app1.add_option("--pose_history_size", params.pose_history_size, "");
+        app1.add_option("--pose_history_propagate", params.pose_history_propagate, "");
+
         // NOISE ======================================================================
 
         // Our noise values for inertial sensor
@@ -113,6 +127,7 @@ namespace ov_msckf {
         app1.add_option("--use_klt", params.use_klt, "");
         app1.add_option("--use_aruco", params.use_aruco, "");
         app1.add_option("--downsize_aruco", params.downsize_aruco, "");
+        app1.add_option("--aruco_detect_interval", params.aruco_detect_interval, "");
 
         // General parameters
         app1.add_option("--num_pts", params.num_pts, "");
@@ -121,6 +136,12 @@ namespace ov_msckf {
         app1.add_option("--grid_y", params.grid_y, "");
         app1.add_option("--min_px_dist", params.min_px_dist, "");
         app1.add_option("--knn_ratio", params.knn_ratio, "");
+        app1.add_option("--knn_window", params.knn_window, "");
+
+        // Threading parameters
+        app1.add_option("--num_threads", params.num_threads, "");
+        app1.add_option("--pin_threads", params.pin_threads, "");
+        app1.add_option("--num_opencv_threads", params.num_opencv_threads, "");
 
         // Feature initializer parameters
         app1.add_option("--fi_max_runs", params.featinit_options.max_runs, "");
@@ -151,6 +172,9 @@ namespace ov_msckf {
         app1.add_option("--sim_seed_preturb", params.sim_seed_preturb, "");
         app1.add_option("--sim_seed_measurements", params.sim_seed_measurements, "");
 
+        // Binary recording of the measurements we can replay
+        app1.add_option("--sim_stream_path", params.sim_stream_path, "");
+
 
         // CMD PARSE ==============================================================================
 
@@ -48,9 +48,15 @@ namespace ov_msckf {
         nh.param<bool>("use_fej", params.state_options.do_fej, params.state_options.do_fej);
         nh.param<bool>("use_imuavg", params.state_options.imu_avg, params.state_options.imu_avg);
         nh.param<bool>("use_rk4int", params.state_options.use_rk4_integration, params.state_options.use_rk4_integration);
+        nh.param<bool>("use_cpiprop", params.state_options.use_cpi_propagation, params.state_options.use_cpi_propagation);
         nh.param<bool>("calib_cam_extrinsics", params.state_options.do_calib_camera_pose, params.state_options.do_calib_camera_pose);
         nh.param<bool>("calib_cam_intrinsics", params.state_options.do_calib_camera_intrinsics, params.state_options.do_calib_camera_intrinsics);
         nh.param<bool>("calib_cam_timeoffset", params.state_options.do_calib_camera_timeoffset, params.state_options.do_calib_camera_timeoffset);
+        nh.param<bool>("schmidt_calibration", params.state_options.do_schmidt_calibration, params.state_options.do_schmidt_calibration);
+        nh.param<bool>("schmidt_slam", params.state_options.do_schmidt_slam, params.state_options.do_schmidt_slam);
+        nh.param<bool>("calib_freeze", params.state_options.do_calib_freeze, params.state_options.do_calib_freeze);
+        nh.param<int>("calib_freeze_window", params.state_options.calib_freeze_window, params.state_options.calib_freeze_window);
+        nh.param<double>("calib_freeze_rel_change", params.state_options.calib_freeze_rel_change, params.state_options.calib_freeze_rel_change);
         nh.param<int>("max_clones", params.state_options.max_clone_size, params.state_options.max_clone_size);
         nh.param<int>("max_slam", params.state_options.max_slam_features, params.state_options.max_slam_features);
         nh.param<int>("max_slam_in_update", params.state_options.max_slam_in_update, params.state_options.max_slam_in_update);
@@ -102,6 +108,14 @@ namespace ov_msckf {
         nh.param<bool>("record_timing_information", params.record_timing_information, params.record_timing_information);
         nh.param<std::string>("record_timing_filepath", params.record_timing_filepath, params.record_timing_filepath);
 
+        // Snapshots of the estimator for warm restarts
+        nh.param<std::string>("snapshot_path", params.snapshot_path, params.snapshot_path);
+        nh.param<double>("snapshot_interval", params.snapshot_interval, params.snapshot_interval);
+
+        // History of poses for timestamp queries
+        nh.param<int>("pose_history_size", params.pose_history_size, params.pose_history_size);
+        nh.param<bool>("pose_history_propagate", params.pose_history_propagate, params.pose_history_propagate);
+
 
         // NOISE ======================================================================
 
@@ -139,6 +153,7 @@ namespace ov_msckf {
         nh.param<bool>("use_klt", params.use_klt, params.use_klt);
         nh.param<bool>("use_aruco", params.use_aruco, params.use_aruco);
         nh.param<bool>("downsize_aruco", params.downsize_aruco, params.downsize_aruco);
+        nh.param<int>("aruco_detect_interval", params.aruco_detect_interval, params.aruco_detect_interval);
 
         // General parameters
         nh.param<int>("num_pts", params.num_pts, params.num_pts);
@@ -147,6 +162,12 @@ namespace ov_msckf {
         nh.param<int>("grid_y", params.grid_y, params.grid_y);
         nh.param<int>("min_px_dist", params.min_px_dist, params.min_px_dist);
         nh.param<double>("knn_ratio", params.knn_ratio, params.knn_ratio);
+        nh.param<int>("knn_window", params.knn_window, params.knn_window);
+
+        // Threading parameters
+        nh.param<int>("num_threads", params.num_threads, params.num_threads);
+        nh.param<bool>("pin_threads", params.pin_threads, params.pin_threads);
+        nh.param<int>("num_opencv_threads", params.num_opencv_threads, params.num_opencv_threads);
 
         // Feature initializer parameters
         nh.param<int>("fi_max_runs", params.featinit_options.max_runs, params.featinit_options.max_runs);
@@ -178,6 +199,9 @@ namespace ov_msckf {
         nh.param<int>("sim_seed_preturb", params.sim_seed_preturb, params.sim_seed_preturb);
         nh.param<int>("sim_seed_measurements", params.sim_seed_measurements, params.sim_seed_measurements);
 
+        // Binary recording of the measurements we can replay
+        nh.param<std::string>("sim_stream_path", params.sim_stream_path, params.sim_stream_path);
+
 
 
         //====================================================================================